@@ -37,6 +37,7 @@
 #include <osg/Timer>
 #include <osgDB/ReadFile>
 
+#include <atomic>
 #include <iomanip>
 #include <algorithm>
 #include <iterator>
@@ -68,8 +69,8 @@ int usage(char** argv)
 // Visitor that converts image tiles
 struct ImageLayerTileCopy : public TileHandler
 {
-    ImageLayerTileCopy(ImageLayer* source, ImageLayer* dest, bool overwrite, bool compress)
-        : _source(source), _dest(dest), _overwrite(overwrite), _compress(compress)
+    ImageLayerTileCopy(ImageLayer* source, ImageLayer* dest, bool overwrite, bool compress, std::atomic_uint& written)
+        : _source(source), _dest(dest), _overwrite(overwrite), _compress(compress), _written(written)
     {
         //nop
     }
@@ -97,7 +98,11 @@ struct ImageLayerTileCopy : public TileHandler
 
             Status status = _dest->writeImage(key, imageToWrite.get(), 0L);
             ok = status.isOK();
-            if (!ok)
+            if (ok)
+            {
+                ++_written;
+            }
+            else
             {
                 OE_WARN << key.str() << ": " << status.message() << std::endl;
             }
@@ -132,13 +137,14 @@ struct ImageLayerTileCopy : public TileHandler
     osg::ref_ptr<ImageLayer> _dest;
     bool _overwrite;
     bool _compress;
+    std::atomic_uint& _written;
 };
 
 // Visitor that converts elevation tiles
 struct ElevationLayerTileCopy : public TileHandler
 {
-    ElevationLayerTileCopy(ElevationLayer* source, ElevationLayer* dest, bool overwrite)
-        : _source(source), _dest(dest), _overwrite(overwrite)
+    ElevationLayerTileCopy(ElevationLayer* source, ElevationLayer* dest, bool overwrite, std::atomic_uint& written)
+        : _source(source), _dest(dest), _overwrite(overwrite), _written(written)
     {
         //nop
     }
@@ -162,7 +168,11 @@ struct ElevationLayerTileCopy : public TileHandler
         {
             Status s = _dest->writeHeightField(key, hf.getHeightField(), 0L);
             ok = s.isOK();
-            if (!ok)
+            if (ok)
+            {
+                ++_written;
+            }
+            else
             {
                 OE_WARN << key.str() << ": " << s.message() << std::endl;
             }
@@ -199,6 +209,7 @@ struct ElevationLayerTileCopy : public TileHandler
     osg::ref_ptr<ElevationLayer> _source;
     osg::ref_ptr<ElevationLayer> _dest;
     bool _overwrite;
+    std::atomic_uint& _written;
 };
 
 
@@ -501,20 +512,24 @@ main(int argc, char** argv)
     if (args.read("--no-overwrite"))
         overwrite = false;
 
+    std::atomic_uint tilesWritten(0u);
+
     if (dynamic_cast<ImageLayer*>(input.get()) && dynamic_cast<ImageLayer*>(output.get()))
     {
         visitor->setTileHandler(new ImageLayerTileCopy(
             dynamic_cast<ImageLayer*>(input.get()),
             dynamic_cast<ImageLayer*>(output.get()),
             overwrite,
-            compress));
+            compress,
+            tilesWritten));
     }
     else if (dynamic_cast<ElevationLayer*>(input.get()) && dynamic_cast<ElevationLayer*>(output.get()))
     {
         visitor->setTileHandler(new ElevationLayerTileCopy(
             dynamic_cast<ElevationLayer*>(input.get()),
             dynamic_cast<ElevationLayer*>(output.get()),
-            overwrite));
+            overwrite,
+            tilesWritten));
     }
 
     // set the manual extents, if specified:
@@ -644,15 +659,23 @@ main(int argc, char** argv)
 
     visitor->run( outputProfile.get() );
 
+    // closing the output commits any writes the layer is still holding
+    output->close();
+
     osg::Timer_t t1 = osg::Timer::instance()->tick();
 
+    double seconds = osg::Timer::instance()->delta_s(t0, t1);
+
     std::cout
         << std::endl
         << "Complete. Time = "
         << std::fixed
         << std::setprecision(1)
-        << osg::Timer::instance()->delta_s(t0, t1)
-        << " seconds." << std::endl;
+        << seconds
+        << " seconds, "
+        << (unsigned)tilesWritten << " tiles written ("
+        << (seconds > 0.0 ? (double)tilesWritten / seconds : 0.0)
+        << " tiles/sec)." << std::endl;
 
     return 0;
 }
@@ -40,6 +40,7 @@ CacheOptions::getConfig() const
 {
     Config conf = ConfigOptions::getConfig();
     conf.set("enable_node_caching", enableNodeCaching());
+    conf.set("write_behind_queue_size", writeBehindQueueSize());
     return conf;
 }
 
@@ -48,6 +49,8 @@ CacheOptions::fromConfig(const Config& conf)
 {
     enableNodeCaching().setDefault(false);
     conf.get("enable_node_caching", enableNodeCaching());
+    writeBehindQueueSize().setDefault(0u);
+    conf.get("write_behind_queue_size", writeBehindQueueSize());
 }
 
 //------------------------------------------------------------------------
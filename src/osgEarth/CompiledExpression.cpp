@@ -0,0 +1,377 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/CompiledExpression>
+#include <osgEarth/FeatureBatch>
+#include <osgEarth/FilterContext>
+#include <osgEarth/ScriptEngine>
+#include <osgEarth/StringUtils>
+#include <algorithm>
+#include <cmath>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[CompiledExpression] "
+
+namespace
+{
+    bool schemaHas(const FeatureSchema& schema, const std::string& name)
+    {
+        for (auto& field : schema)
+            if (ciEquals(field.first, name))
+                return true;
+        return false;
+    }
+
+    ScriptEngine* getScriptEngine(const FilterContext* context)
+    {
+        return context && context->getSession() ?
+            context->getSession()->getScriptEngine() :
+            nullptr;
+    }
+
+    // Sized for typical expressions; larger ones fall back to the heap
+    const unsigned LOCAL_SIZE = 16u;
+}
+
+//........................................................................
+
+CompiledNumericExpression::CompiledNumericExpression(const NumericExpression& expr,
+                                                     const FeatureSchema& schema) :
+    _src(expr._src),
+    _depth(expr._depth)
+{
+    // map RPN positions of variables to slots, one slot per distinct name
+    std::vector<int> slotOf(expr._rpn.size(), -1);
+    for (auto& var : expr._vars)
+    {
+        unsigned slot = 0u;
+        while (slot < _slots.size() && _slots[slot].name != var.first)
+            ++slot;
+
+        if (slot == _slots.size())
+        {
+            Slot s;
+            s.name = var.first;
+            s.source =
+                schema.empty() ? ATTRIBUTE_OR_SCRIPT :
+                schemaHas(schema, var.first) ? ATTRIBUTE :
+                SCRIPT;
+            _slots.push_back(s);
+        }
+
+        slotOf[var.second] = slot;
+    }
+
+    _code.reserve(expr._rpn.size());
+    for (unsigned i = 0; i < expr._rpn.size(); ++i)
+    {
+        const NumericExpression::Atom& a = expr._rpn[i];
+        Instruction ins = { PUSH, 0u, a.second };
+
+        switch (a.first)
+        {
+        case NumericExpression::ADD:  ins.op = ADD; break;
+        case NumericExpression::SUB:  ins.op = SUB; break;
+        case NumericExpression::MULT: ins.op = MULT; break;
+        case NumericExpression::DIV:  ins.op = DIV; break;
+        case NumericExpression::MOD:  ins.op = MOD; break;
+        case NumericExpression::MIN:  ins.op = MIN; break;
+        case NumericExpression::MAX:  ins.op = MAX; break;
+        case NumericExpression::VARIABLE:
+            if (slotOf[i] >= 0)
+            {
+                ins.op = LOAD;
+                ins.slot = (unsigned)slotOf[i];
+            }
+            break;
+        default:
+            // OPERAND, or a stray paren that NumericExpression reads as 0
+            break;
+        }
+
+        _code.push_back(ins);
+    }
+}
+
+void
+CompiledNumericExpression::load(const Feature* feature, const FilterContext* context, double* slots) const
+{
+    const AttributeTable& attrs = feature->getAttrs();
+
+    for (unsigned i = 0; i < _slots.size(); ++i)
+    {
+        const Slot& slot = _slots[i];
+        slots[i] = 0.0;
+
+        if (slot.source != SCRIPT)
+        {
+            auto attr = attrs.find(slot.name);
+            if (attr != attrs.end())
+            {
+                slots[i] = attr->second.getDouble(0.0);
+                continue;
+            }
+        }
+
+        if (slot.source != ATTRIBUTE)
+        {
+            ScriptEngine* engine = getScriptEngine(context);
+            if (engine)
+            {
+                ScriptResult result = engine->run(slot.name, feature, context);
+                if (result.success())
+                    slots[i] = result.asDouble();
+                else
+                    OE_WARN << LC << "Feature Script error on '" << _src << "': " << result.message() << std::endl;
+            }
+        }
+    }
+}
+
+double
+CompiledNumericExpression::run(const double* slots, double* s) const
+{
+    unsigned n = 0u;
+
+    for (auto& ins : _code)
+    {
+        if (ins.op == PUSH)
+        {
+            s[n++] = ins.value;
+        }
+        else if (ins.op == LOAD)
+        {
+            s[n++] = slots[ins.slot];
+        }
+        else if (n >= 2)
+        {
+            double op2 = s[--n];
+            double& op1 = s[n - 1];
+
+            switch (ins.op)
+            {
+            case ADD:  op1 = op1 + op2; break;
+            case SUB:  op1 = op1 - op2; break;
+            case MULT: op1 = op1 * op2; break;
+            case DIV:  op1 = op1 / op2; break;
+            case MOD:  op1 = fmod(op1, op2); break;
+            case MIN:  op1 = osg::minimum(op1, op2); break;
+            case MAX:  op1 = osg::maximum(op1, op2); break;
+            default: break;
+            }
+        }
+    }
+
+    // NaN reads as 0, matching NumericExpression::eval
+    double value = n > 0 ? s[n - 1] : 0.0;
+    return !osg::isNaN(value) ? value : 0.0;
+}
+
+double
+CompiledNumericExpression::eval(const Feature* feature, const FilterContext* context) const
+{
+    OE_SOFT_ASSERT_AND_RETURN(feature != nullptr, 0.0);
+
+    double localSlots[LOCAL_SIZE], localStack[LOCAL_SIZE];
+    std::vector<double> heapSlots, heapStack;
+    double* slots = localSlots;
+    double* stack = localStack;
+
+    if (_slots.size() > LOCAL_SIZE)
+    {
+        heapSlots.resize(_slots.size());
+        slots = heapSlots.data();
+    }
+    if (_depth > LOCAL_SIZE)
+    {
+        heapStack.resize(_depth);
+        stack = heapStack.data();
+    }
+
+    load(feature, context, slots);
+    return run(slots, stack);
+}
+
+void
+CompiledNumericExpression::eval(const FeatureList& features, std::vector<double>& output, const FilterContext* context) const
+{
+    output.resize(features.size());
+
+    std::vector<double> slots(std::max((std::size_t)1u, _slots.size()));
+    std::vector<double> stack(std::max(1u, _depth));
+
+    for (unsigned i = 0; i < features.size(); ++i)
+    {
+        if (features[i].valid())
+        {
+            load(features[i].get(), context, slots.data());
+            output[i] = run(slots.data(), stack.data());
+        }
+        else
+        {
+            output[i] = 0.0;
+        }
+    }
+}
+
+void
+CompiledNumericExpression::eval(const FeatureBatch& batch, std::vector<double>& output) const
+{
+    output.resize(batch.size());
+
+    std::vector<int> columns(_slots.size());
+    for (unsigned i = 0; i < _slots.size(); ++i)
+        columns[i] = _slots[i].source != SCRIPT ? batch.getColumnIndex(_slots[i].name) : -1;
+
+    std::vector<double> slots(std::max((std::size_t)1u, _slots.size()));
+    std::vector<double> stack(std::max(1u, _depth));
+
+    for (unsigned row = 0; row < batch.size(); ++row)
+    {
+        for (unsigned i = 0; i < columns.size(); ++i)
+            slots[i] = columns[i] >= 0 ? batch.getDouble(row, columns[i], 0.0) : 0.0;
+
+        output[row] = run(slots.data(), stack.data());
+    }
+}
+
+//........................................................................
+
+CompiledStringExpression::CompiledStringExpression(const StringExpression& expr,
+                                                   const FeatureSchema& schema) :
+    _src(expr._src)
+{
+    // a variable's atom holds its last bound value, so take names from _vars
+    std::vector<const std::string*> names(expr._infix.size(), nullptr);
+    for (auto& var : expr._vars)
+        names[var.second] = &var.first;
+
+    for (unsigned i = 0; i < expr._infix.size(); ++i)
+    {
+        Part part;
+
+        if (expr._infix[i].first == StringExpression::OPERAND || names[i] == nullptr)
+        {
+            part.source = LITERAL;
+            part.text = expr._infix[i].second;
+        }
+        else
+        {
+            part.text = *names[i];
+            part.source =
+                schema.empty() ? ATTRIBUTE_OR_SCRIPT :
+                schemaHas(schema, part.text) ? ATTRIBUTE :
+                SCRIPT;
+        }
+
+        // merge adjacent literals
+        if (part.source == LITERAL && !_parts.empty() && _parts.back().source == LITERAL)
+            _parts.back().text += part.text;
+        else
+            _parts.push_back(part);
+    }
+}
+
+void
+CompiledStringExpression::eval(const Feature* feature, std::string& output, const FilterContext* context) const
+{
+    output.clear();
+
+    OE_SOFT_ASSERT_AND_RETURN(feature != nullptr, void());
+
+    const AttributeTable& attrs = feature->getAttrs();
+
+    for (auto& part : _parts)
+    {
+        if (part.source == LITERAL)
+        {
+            output.append(part.text);
+            continue;
+        }
+
+        if (part.source != SCRIPT)
+        {
+            auto attr = attrs.find(part.text);
+            if (attr != attrs.end())
+            {
+                output.append(attr->second.getString());
+                continue;
+            }
+        }
+
+        if (part.source != ATTRIBUTE)
+        {
+            ScriptEngine* engine = getScriptEngine(context);
+            if (engine)
+            {
+                ScriptResult result = engine->run(part.text, feature, context);
+                if (result.success())
+                {
+                    output.append(result.asString());
+                }
+                else
+                {
+                    // Couldn't execute it as code, just take it as a string literal.
+                    output.append(part.text);
+                    OE_DEBUG << LC << "Feature Script error on '" << _src << "': " << result.message() << std::endl;
+                }
+            }
+        }
+    }
+}
+
+void
+CompiledStringExpression::eval(const FeatureList& features, std::vector<std::string>& output, const FilterContext* context) const
+{
+    output.resize(features.size());
+
+    for (unsigned i = 0; i < features.size(); ++i)
+    {
+        if (features[i].valid())
+            eval(features[i].get(), output[i], context);
+        else
+            output[i].clear();
+    }
+}
+
+void
+CompiledStringExpression::eval(const FeatureBatch& batch, std::vector<std::string>& output) const
+{
+    output.resize(batch.size());
+
+    std::vector<int> columns(_parts.size(), -1);
+    for (unsigned i = 0; i < _parts.size(); ++i)
+        if (_parts[i].source == ATTRIBUTE || _parts[i].source == ATTRIBUTE_OR_SCRIPT)
+            columns[i] = batch.getColumnIndex(_parts[i].text);
+
+    for (unsigned row = 0; row < batch.size(); ++row)
+    {
+        std::string& out = output[row];
+        out.clear();
+
+        for (unsigned i = 0; i < _parts.size(); ++i)
+        {
+            if (_parts[i].source == LITERAL)
+                out.append(_parts[i].text);
+            else if (columns[i] >= 0)
+                out.append(batch.getString(row, columns[i]));
+        }
+    }
+}
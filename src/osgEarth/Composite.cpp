@@ -19,7 +19,10 @@
 #include <osgEarth/Composite>
 #include <osgEarth/Progress>
 #include <osgEarth/Notify>
+#include <osgEarth/Metrics>
 #include "HeightFieldUtils"
+#include <chrono>
+#include <sstream>
 
 using namespace osgEarth;
 
@@ -45,6 +48,7 @@ CompositeImageLayer::Options::getConfig() const
     conf.set("composite_function", "less", function(), FUNCTION_LESS);
     conf.set("composite_function", "greater", function(), FUNCTION_GREATER);
     conf.set("composite_function", "more", function(), FUNCTION_GREATER);
+    conf.set("parallel_fetch", parallelFetch());
     return conf;
 }
 
@@ -61,6 +65,7 @@ CompositeImageLayer::Options::fromConfig(const Config& conf)
     conf.get("composite_function", "blend", function(), FUNCTION_BLEND);
     conf.get("composite_function", "less", function(), FUNCTION_LESS);
     conf.get("composite_function", "greater", function(), FUNCTION_GREATER);
+    conf.get("parallel_fetch", parallelFetch());
 }
 
 //........................................................................
@@ -79,10 +84,23 @@ namespace osgEarth { namespace Composite
         //bool mayHaveData;
         float opacity;
         osg::ref_ptr<const osg::Image> image;
+        double fetchSeconds = 0.0;
     };
 
     // some helper types.    
     typedef std::vector<ImageInfo> ImageMixVector;   
+
+    // Pool for concurrent child fetches. Those are mostly I/O, so they
+    // get their own pool instead of competing with the tile loaders.
+    jobs::jobpool* getFetchPool(bool parallel)
+    {
+        return parallel ? jobs::get_pool("oe.composite") : nullptr;
+    }
+
+    double secondsSince(const std::chrono::steady_clock::time_point& start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
 } }
 
 REGISTER_OSGEARTH_LAYER(compositeimage, CompositeImageLayer);
@@ -312,37 +330,62 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
 {
     unsigned size = getTileSize();
 
-    Composite::ImageMixVector images;
-    images.reserve(_layers.size());
+    Composite::ImageMixVector images(_layers.size());
 
-    // Try to get an image from each of the layers for the given key.
-    for(auto& layer : _layers)
+    for (unsigned i = 0; i < _layers.size(); ++i)
     {
-        if (!layer->isOpen())
-            continue;
+        images[i].opacity = _layers[i]->getOpacity();
+    }
+
+    jobs::jobpool* pool = Composite::getFetchPool(options().parallelFetch() == true);
+
+    // Each fetch reports to its own callback, since the fetches may run
+    // at the same time; they're merged back into "progress" after the join.
+    std::vector<osg::ref_ptr<ProgressCallback>> fetchProgress(_layers.size());
+    if (progress)
+    {
+        for (auto& p : fetchProgress)
+            p = new ProgressCallback(progress);
+    }
 
-        Composite::ImageInfo imageInfo;
-        imageInfo.opacity = layer->getOpacity();
-        imageInfo.bestAvailableKey = layer->getBestAvailableTileKey(key);
-        
-        // if there is possibly actual data for this key...
-        if (imageInfo.bestAvailableKey == key)
+    // Try to get an image from each of the layers for the given key.
+    // Each child writes only to its own slot, so the mix below happens
+    // in layer order no matter which fetch finishes first.
+    Threading::parallelFor((unsigned)_layers.size(), pool, [&](unsigned i)
         {
-            GeoImage image = layer->createImage(key, progress);
-            if (image.valid())
-            {
-                imageInfo.image = image.getImage();
-            }
+            ImageLayer* layer = _layers[i].get();
+            Composite::ImageInfo& imageInfo = images[i];
+            ProgressCallback* fetchCallback = fetchProgress[i].get();
+
+            if (!layer->isOpen() || (fetchCallback && fetchCallback->isCanceled()))
+                return;
+
+            OE_PROFILING_ZONE_TEXT(layer->getName() + " " + key.str());
+            auto start = std::chrono::steady_clock::now();
 
-            // If the progress got cancelled or it needs a retry then return NULL to prevent this tile from being built and cached with incomplete or partial data.
-            if (progress && progress->isCanceled())
+            imageInfo.bestAvailableKey = layer->getBestAvailableTileKey(key);
+
+            // if there is possibly actual data for this key...
+            if (imageInfo.bestAvailableKey == key)
             {
-                OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
-                return GeoImage::INVALID;
+                GeoImage image = layer->createImage(key, fetchCallback);
+                if (image.valid())
+                {
+                    imageInfo.image = image.getImage();
+                }
             }
-        }
 
-        images.push_back(imageInfo);
+            imageInfo.fetchSeconds += Composite::secondsSince(start);
+        });
+
+    for (auto& p : fetchProgress)
+        if (p.valid()) progress->merge(p.get());
+
+    // If the progress got cancelled or it needs a retry then return NULL to prevent this tile from being built and cached with incomplete or partial data.
+    if (progress && progress->isCanceled())
+    {
+        OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
+        return GeoImage::INVALID;
     }
 
     // Compute the number of valid images
@@ -359,44 +402,67 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
     // Create fallback images if we have some valid data but not for all the layers
     if (numValidImages > 0 && numValidImages < images.size())
     {
-        for (unsigned int i = 0; i < images.size(); i++)
-        {
-            Composite::ImageInfo& info = images[i];
-            ImageLayer* layer = _layers[i].get();
-            if (info.image.valid() == false && info.bestAvailableKey.valid())
+        Threading::parallelFor((unsigned)images.size(), pool, [&](unsigned i)
             {
-                TileKey currentKey = info.bestAvailableKey; //key.createParentKey();
-
-                GeoImage image;
-                while (!image.valid() && currentKey.valid())
+                Composite::ImageInfo& info = images[i];
+                ImageLayer* layer = _layers[i].get();
+                ProgressCallback* fetchCallback = fetchProgress[i].get();
+                if (info.image.valid() == false && info.bestAvailableKey.valid())
                 {
-                    image = layer->createImage(currentKey, progress);
-                    if (image.valid())
+                    OE_PROFILING_ZONE_TEXT(layer->getName() + " " + key.str() + " fallback");
+                    auto start = std::chrono::steady_clock::now();
+
+                    TileKey currentKey = info.bestAvailableKey; //key.createParentKey();
+
+                    GeoImage image;
+                    while (!image.valid() && currentKey.valid())
                     {
-                        break;
+                        // Stop as soon as the caller cancels; the result will be discarded.
+                        if (fetchCallback && fetchCallback->isCanceled())
+                        {
+                            break;
+                        }
+
+                        image = layer->createImage(currentKey, fetchCallback);
+                        if (image.valid())
+                        {
+                            break;
+                        }
+
+                        currentKey = currentKey.createParentKey();
                     }
 
-                    // If the progress got cancelled or it needs a retry then return INVALID
-                    // to prevent this tile from being built and cached with incomplete or partial data.
-                    if (progress && progress->isCanceled())
+                    if (image.valid())
                     {
-                        OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
-                        return GeoImage::INVALID;
+                        bool bilinear = layer->isCoverage() ? false : true;
+                        GeoImage cropped = image.crop( key.getExtent(), true, size, size, bilinear);
+                        info.image = cropped.getImage();
                     }
 
-                    currentKey = currentKey.createParentKey();
+                    info.fetchSeconds += Composite::secondsSince(start);
                 }
+            });
 
-                if (image.valid())
-                {
-                    bool bilinear = layer->isCoverage() ? false : true;
-                    GeoImage cropped = image.crop( key.getExtent(), true, size, size, bilinear);
-                    info.image = cropped.getImage();
-                }                    
-            }
+        for (auto& p : fetchProgress)
+            if (p.valid()) progress->merge(p.get());
+
+        // If the progress got cancelled or it needs a retry then return INVALID
+        // to prevent this tile from being built and cached with incomplete or partial data.
+        if (progress && progress->isCanceled())
+        {
+            OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
+            return GeoImage::INVALID;
         }
     }
 
+    if (osgEarth::isNotifyEnabled(osg::DEBUG_INFO))
+    {
+        std::stringstream buf;
+        for (unsigned i = 0; i < images.size(); ++i)
+            buf << " " << _layers[i]->getName() << "=" << (int)(images[i].fetchSeconds * 1000.0) << "ms";
+        OE_DEBUG << LC << key.str() << " fetch times:" << buf.str() << std::endl;
+    }
+
     // Now finally create the output image.
     // Recompute the number of valid images and make sure they are all the correct size
     numValidImages = 0;
@@ -504,6 +570,7 @@ CompositeElevationLayer::Options::getConfig() const
         }
         conf.set(layersConf);
     }
+    conf.set("parallel_fetch", parallelFetch());
     return conf;
 }
 
@@ -515,6 +582,7 @@ CompositeElevationLayer::Options::fromConfig(const Config& conf)
     {
         _layers.push_back(ConfigOptions(conf));
     }
+    conf.get("parallel_fetch", parallelFetch());
 }
 
 
@@ -738,8 +806,10 @@ CompositeElevationLayer::createHeightFieldImplementation(const TileKey& key, Pro
     auto hf = HeightFieldUtils::createReferenceHeightField(
         key.getExtent(), getTileSize(), getTileSize(), 0, false, NO_DATA_VALUE);
 
+    jobs::jobpool* pool = Composite::getFetchPool(options().parallelFetch() == true);
+
     // Populate the heightfield and return it if it's valid
-    if (_layers.populateHeightField(hf.get(), NULL, key, 0, INTERP_BILINEAR, progress))
+    if (_layers.populateHeightField(hf.get(), NULL, key, 0, INTERP_BILINEAR, progress, pool))
     {                
         return GeoHeightField(hf.release(), key.getExtent());
     }
@@ -72,8 +72,6 @@ ElevationTexture::ElevationTexture(
     {
         _heightField = in_hf.getHeightField();
 
-        osg::Vec4 value;
-
         osg::Image* heights = new osg::Image();
         heights->allocateImage(_heightField->getNumColumns(), _heightField->getNumRows(), 1, GL_RED, GL_FLOAT);
         heights->setInternalTextureFormat(GL_R32F);
@@ -81,34 +79,79 @@ ElevationTexture::ElevationTexture(
         // Copy the float height data into the image
         memcpy(heights->data(), _heightField->getHeightList().data(), sizeof(float) * _heightField->getNumRows() * _heightField->getNumColumns());
 
-        setImage(heights);
-
-        setDataVariance(osg::Object::STATIC);
-        setInternalFormat(GL_R32F);
-        setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
-        setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
-        setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
-        setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
-        setResizeNonPowerOfTwoHint(false);
-        setMaxAnisotropy(1.0f);
+        setHeights(heights);
+    }
+}
 
-        // Pooled, so never expire them.
-        setUnRefImageDataAfterApply(false);
+ElevationTexture::ElevationTexture(
+    const TileKey& key,
+    const GeoImage& in_heights,
+    const std::vector<float>& resolutions) :
 
-        _read.setTexture(this);
-        _read.setSampleAsTexture(false);
+    _tilekey(key),
+    _extent(in_heights.getExtent()),
+    _resolutions(resolutions)
+{
+    setName(key.str() + ":elevation");
 
-        _resolution = Distance(
-            getExtent().height() / ((double)(getImage(0)->s()-1)),
-            getExtent().getSRS()->getUnits());
+    const osg::Image* image = in_heights.getImage();
+    if (image && image->getPixelFormat() == GL_RED && image->getDataType() == GL_FLOAT)
+    {
+        // the heightfield is created on demand in getHeightField()
+        setHeights(const_cast<osg::Image*>(image));
     }
 }
 
+void
+ElevationTexture::setHeights(osg::Image* heights)
+{
+    setImage(heights);
+
+    setDataVariance(osg::Object::STATIC);
+    setInternalFormat(GL_R32F);
+    setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    setResizeNonPowerOfTwoHint(false);
+    setMaxAnisotropy(1.0f);
+
+    // Pooled, so never expire them.
+    setUnRefImageDataAfterApply(false);
+
+    _read.setTexture(this);
+    _read.setSampleAsTexture(false);
+
+    _resolution = Distance(
+        getExtent().height() / ((double)(getImage(0)->s()-1)),
+        getExtent().getSRS()->getUnits());
+}
+
 ElevationTexture::~ElevationTexture()
 {
     //nop
 }
 
+const osg::HeightField*
+ElevationTexture::getHeightField() const
+{
+    std::call_once(_heightFieldOnce, [this]()
+    {
+        const osg::Image* image = getImage(0);
+        if (!_heightField.valid() && image != nullptr)
+        {
+            osg::HeightField* hf = new osg::HeightField();
+            hf->allocate(image->s(), image->t());
+            memcpy(hf->getFloatArray()->asVector().data(), image->data(), sizeof(float) * image->s() * image->t());
+            hf->setOrigin(osg::Vec3d(getExtent().xMin(), getExtent().yMin(), 0.0));
+            hf->setXInterval(getExtent().width() / (double)osg::maximum(image->s() - 1, 1));
+            hf->setYInterval(getExtent().height() / (double)osg::maximum(image->t() - 1, 1));
+            _heightField = hf;
+        }
+    });
+    return _heightField.get();
+}
+
 ElevationSample
 ElevationTexture::getElevation(double x, double y) const
 {
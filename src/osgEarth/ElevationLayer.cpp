@@ -22,7 +22,9 @@
 #include <osgEarth/MemCache>
 #include <osgEarth/Metrics>
 #include <osgEarth/NetworkMonitor>
+#include <chrono>
 #include <cinttypes>
+#include <sstream>
 
 using namespace osgEarth;
 
@@ -394,6 +396,12 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
         return result;
     }
 
+    // An earlier request for this key came back empty; don't ask again.
+    if (isKnownMissing(key))
+    {
+        return result;
+    }
+
     // Prevents more than one thread from creating the same object
     // at the same time. This helps a lot with elevation data since
     // the many queries cross tile boundaries (like calculating 
@@ -451,6 +459,7 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
         // Now attempt to read from the cache. Since the cached data is stored in the
         // map profile, we can try this first.
         bool fromCache = false;
+        bool illegal = false;
 
         osg::ref_ptr< osg::HeightField > cachedHF;
 
@@ -515,6 +524,7 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
             {
                 OE_WARN << LC << "Generated an illegal heightfield!" << std::endl;
                 hf = 0L; // to fall back on cached data if possible.
+                illegal = true;
             }
 
             // Pre-caching operations:
@@ -563,6 +573,11 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
             // No luck on any path:
             if ( !hf.valid() )
             {
+                // a bad tile may be a transient failure, so don't remember it
+                if (result.getStatus().isOK() && !illegal && !(progress && progress->isCanceled()))
+                {
+                    setKnownMissing(key);
+                }
                 return GeoHeightField::INVALID;
             }
         }
@@ -606,6 +621,25 @@ ElevationLayer::writeHeightFieldImplementation(const TileKey& key, const osg::He
     return Status::ServiceUnavailable;
 }
 
+GeoImage
+ElevationLayer::createHeightImageView(const TileKey& key) const
+{
+    osg::ref_ptr<const Profile> profile = getProfile();
+
+    // views bypass the vdatum transform and the onCreate callbacks
+    if (!isOpen() ||
+        !profile.valid() ||
+        !key.getProfile()->isHorizEquivalentTo(profile.get()) ||
+        !key.getExtent().getSRS()->isVertEquivalentTo(profile->getSRS()) ||
+        _callbacks.empty() == false) // not thread-safe but that's ok
+    {
+        return GeoImage::INVALID;
+    }
+
+    Threading::ScopedReadLock lock(inUseMutex());
+    return createHeightImageViewImplementation(key);
+}
+
 void
 ElevationLayer::invoke_onCreate(const TileKey& key, GeoHeightField& data)
 {
@@ -691,6 +725,77 @@ namespace
         std::vector<bool>  offsetFailed;
     };
     //thread_local Workspace s_per_thread_workspace;
+
+    // Samples a heightfield at a subset of the points of a regular grid
+    // (sample index = row * numColumns + column), with the same arithmetic
+    // as calling GeoHeightField::getElevation on each point. ok[k] is 0 for
+    // points that fall outside the heightfield.
+    void sampleGrid(
+        const GeoHeightField& geoHF,
+        const SpatialReference* gridSRS,
+        const std::vector<unsigned>& samples,
+        unsigned numColumns,
+        double xmin, double ymin, double dx, double dy,
+        RasterInterpolation interpolation,
+        std::vector<osg::Vec3d>& points,
+        std::vector<float>& elevations,
+        std::vector<char>& ok)
+    {
+        elevations.resize(samples.size());
+        ok.resize(samples.size());
+
+        const GeoExtent& extent = geoHF.getExtent();
+        const SpatialReference* extentSRS = extent.getSRS();
+
+        points.resize(samples.size());
+        for (unsigned k = 0; k < samples.size(); ++k)
+        {
+            unsigned c = samples[k] % numColumns, r = samples[k] / numColumns;
+            points[k].set(xmin + (dx * (double)c), ymin + (dy * (double)r), 0.0);
+        }
+
+        // Vertical datum shifts and failed transforms are rare;
+        // leave those to the point-at-a-time path.
+        bool perPoint = !extentSRS->isVertEquivalentTo(gridSRS);
+
+        if (!perPoint && gridSRS != extentSRS)
+        {
+            std::vector<osg::Vec3d> local(points);
+            if (gridSRS->transform(local, extentSRS))
+                points.swap(local);
+            else
+                perPoint = true;
+        }
+
+        if (perPoint)
+        {
+            for (unsigned k = 0; k < samples.size(); ++k)
+            {
+                ok[k] = geoHF.getElevation(gridSRS, points[k].x(), points[k].y(), interpolation, gridSRS, elevations[k]) ? 1 : 0;
+            }
+            return;
+        }
+
+        const osg::HeightField* hf = geoHF.getHeightField();
+        const double xInterval = extent.width() / (double)(hf->getNumColumns() - 1);
+        const double yInterval = extent.height() / (double)(hf->getNumRows() - 1);
+        const double llx = extent.xMin(), lly = extent.yMin();
+
+        for (unsigned k = 0; k < samples.size(); ++k)
+        {
+            if (extent.contains(points[k].x(), points[k].y()))
+            {
+                elevations[k] = HeightFieldUtils::getHeightAtLocation(
+                    hf, points[k].x(), points[k].y(), llx, lly, xInterval, yInterval, interpolation);
+                ok[k] = 1;
+            }
+            else
+            {
+                elevations[k] = 0.0f;
+                ok[k] = 0;
+            }
+        }
+    }
 }
 
 bool
@@ -700,7 +805,8 @@ ElevationLayerVector::populateHeightField(
     const TileKey&      key,
     const Profile*      haeProfile,
     RasterInterpolation interpolation,
-    ProgressCallback*   progress) const
+    ProgressCallback*   progress,
+    jobs::jobpool*      fetchPool) const
 {
     // heightfield must already exist.
     if ( !hf )
@@ -845,10 +951,6 @@ ElevationLayerVector::populateHeightField(
 
     unsigned int total = numColumns * numRows;
 
-    int nodataCount = 0;
-
-    TileKey actualKey; // Storage if a new key needs to be constructed
-
     bool requiresResample = true;
 
     // If we only have a single contender layer, and the tile is the same size as the requested
@@ -900,180 +1002,266 @@ ElevationLayerVector::populateHeightField(
             w.heightFieldActualKeys[i] = w.contenders[i].key;
         }
 
-        // The maximum number of heightfields to keep in this local cache
-        const unsigned maxHeightFields = 50;
-        unsigned numHeightFieldsInCache = 0;
-
-        for (unsigned c = 0; c < numColumns; ++c)
+        // Fetch every layer up front, concurrently. This gives up the lazy
+        // loading below (a layer may be fetched even though higher-priority
+        // layers cover the whole tile) in exchange for paying the slowest
+        // layer's latency instead of the sum of them all. Mixing still
+        // happens in priority order in the loop below.
+        if (fetchPool && w.contenders.size() + w.offsets.size() > 1)
         {
-            double x = xmin + (dx * (double)c);
+            const unsigned numContenders = w.contenders.size();
+            std::vector<char> failed(numContenders + w.offsets.size(), 0);
+            std::vector<double> seconds(failed.size(), 0.0);
+
+            // One callback per fetch; the caller's isn't safe to share
+            // between threads beyond its canceled flag.
+            std::vector<osg::ref_ptr<ProgressCallback>> fetchProgress(failed.size());
+            if (progress)
+            {
+                for (auto& p : fetchProgress)
+                    p = new ProgressCallback(progress);
+            }
+
+            Threading::parallelFor((unsigned)failed.size(), fetchPool, [&](unsigned i)
+                {
+                    ProgressCallback* fetchCallback = fetchProgress[i].get();
+                    if (fetchCallback && fetchCallback->isCanceled())
+                        return;
+
+                    auto start = std::chrono::steady_clock::now();
+
+                    if (i < numContenders)
+                    {
+                        ElevationLayer* layer = w.contenders[i].layer.get();
+                        GeoHeightField& layerHF = w.heightFields[i];
+                        TileKey& actualKey = w.heightFieldActualKeys[i];
+
+                        while (!layerHF.valid() && actualKey.valid() && layer->isKeyInLegalRange(actualKey))
+                        {
+                            layerHF = layer->createHeightField(actualKey, fetchCallback);
+                            if (!layerHF.valid())
+                            {
+                                actualKey.makeParent();
+                            }
+                        }
+                        failed[i] = layerHF.valid() ? 0 : 1;
+                    }
+                    else
+                    {
+                        unsigned o = i - numContenders;
+                        w.offsetFields[o] = w.offsets[o].layer->createHeightField(w.offsets[o].key, fetchCallback);
+                        failed[i] = w.offsetFields[o].valid() ? 0 : 1;
+                    }
+
+                    seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                });
+
+            for (auto& p : fetchProgress)
+                if (p.valid()) progress->merge(p.get());
 
-            // periodically check for cancelation
             if (progress && progress->isCanceled())
             {
                 return false;
             }
 
-            for (unsigned r = 0; r < numRows; ++r)
+            // vector<bool> is not safe to write from several threads, so
+            // record the outcomes here.
+            for (unsigned i = 0; i < numContenders; ++i)
+            {
+                w.heightFailed[i] = failed[i] != 0;
+                if (!w.heightFailed[i])
+                {
+                    w.heightFallback[i] =
+                        w.contenders[i].isFallback ||
+                        (w.heightFieldActualKeys[i] != w.contenders[i].key);
+                }
+            }
+            for (unsigned o = 0; o < w.offsets.size(); ++o)
+            {
+                w.offsetFailed[o] = failed[numContenders + o] != 0;
+            }
+
+            if (osgEarth::isNotifyEnabled(osg::DEBUG_INFO))
             {
-                double y = ymin + (dy * (double)r);
+                std::stringstream buf;
+                for (unsigned i = 0; i < failed.size(); ++i)
+                {
+                    const ElevationLayer* layer = i < numContenders ?
+                        w.contenders[i].layer.get() :
+                        w.offsets[i - numContenders].layer.get();
+                    buf << " " << layer->getName() << "=" << (int)(seconds[i] * 1000.0) << "ms";
+                }
+                OE_DEBUG << "[ElevationLayerVector] " << key.str() << " fetch times:" << buf.str() << std::endl;
+            }
+        }
 
-                // Collect elevations from each layer as necessary.
-                int resolvedIndex = -1;
+        // Composite one layer at a time: each layer is sampled at all the
+        // points that no higher-priority layer has resolved yet, rather than
+        // walking the layer list once per point. Layers are visited, fetched
+        // and applied in the same order as a point-at-a-time walk and each
+        // sample uses the same arithmetic, so the output is identical.
+        std::vector<float>& heights = hf->getFloatArray()->asVector();
+        std::vector<int> resolvedIndex(total, -1);
+        std::vector<float> sampleResolutions(total, FLT_MAX);
 
-                float resolution = FLT_MAX;
+        std::vector<unsigned> pending(total);
+        for (unsigned s = 0; s < total; ++s)
+            pending[s] = s;
 
-                osg::Vec3 normal_sum(0, 0, 0);
+        std::vector<osg::Vec3d> points;
+        std::vector<float> elevations;
+        std::vector<char> ok;
 
-                for (int i = 0; i < w.contenders.size() && resolvedIndex < 0; ++i)
-                {
-                    ElevationLayer* layer = w.contenders[i].layer.get();
-                    TileKey& contenderKey = w.contenders[i].key;
-                    int index = w.contenders[i].index;
+        for (unsigned i = 0; i < w.contenders.size() && !pending.empty(); ++i)
+        {
+            if (progress && progress->isCanceled())
+            {
+                return false;
+            }
 
-                    if (w.heightFailed[i])
-                        continue;
+            if (w.heightFailed[i])
+                continue;
 
-                    GeoHeightField& layerHF = w.heightFields[i];
-                    TileKey& actualKey = w.heightFieldActualKeys[i];
+            ElevationLayer* layer = w.contenders[i].layer.get();
+            TileKey& contenderKey = w.contenders[i].key;
+            GeoHeightField& layerHF = w.heightFields[i];
+            TileKey& actualKey = w.heightFieldActualKeys[i];
 
+            if (!layerHF.valid())
+            {
+                // We couldn't get the heightfield from the cache, so try to create it.
+                // We also fallback on parent layers to make sure that we have data at the location even if it's fallback.
+                while (!layerHF.valid() && actualKey.valid() && layer->isKeyInLegalRange(actualKey))
+                {
+                    layerHF = layer->createHeightField(actualKey, progress);
                     if (!layerHF.valid())
                     {
-                        // We couldn't get the heightfield from the cache, so try to create it.
-                        // We also fallback on parent layers to make sure that we have data at the location even if it's fallback.
-                        while (!layerHF.valid() && actualKey.valid() && layer->isKeyInLegalRange(actualKey))
-                        {
-                            layerHF = layer->createHeightField(actualKey, progress);
-                            if (!layerHF.valid())
-                            {
-                                actualKey.makeParent();
-                            }
-                        }
-
-                        // Mark this layer as fallback if necessary.
-                        if (layerHF.valid())
-                        {
-                            //TODO: check this. Should it be actualKey != keyToUse...?
-                            w.heightFallback[i] =
-                                w.contenders[i].isFallback ||
-                                (actualKey != contenderKey);
+                        actualKey.makeParent();
+                    }
+                }
 
-                            numHeightFieldsInCache++;
-                        }
-                        else
-                        {
-                            w.heightFailed[i] = true;
+                // Mark this layer as fallback if necessary.
+                if (layerHF.valid())
+                {
+                    //TODO: check this. Should it be actualKey != keyToUse...?
+                    w.heightFallback[i] =
+                        w.contenders[i].isFallback ||
+                        (actualKey != contenderKey);
+                }
+                else
+                {
+                    w.heightFailed[i] = true;
 #ifdef ANALYZE
-                            layerAnalysis[layer].failed = true;
-                            layerAnalysis[layer].actualKeyValid = actualKey->valid();
-                            if (progress) layerAnalysis[layer].message = progress->message();
+                    layerAnalysis[layer].failed = true;
+                    layerAnalysis[layer].actualKeyValid = actualKey.valid();
+                    if (progress) layerAnalysis[layer].message = progress->message();
 #endif
-                            continue;
-                        }
-                    }
+                    continue;
+                }
+            }
 
-                    if (layerHF.valid())
-                    {
-                        bool isFallback = w.heightFallback[i];
 #ifdef ANALYZE
-                        layerAnalysis[layer].fallback = isFallback;
+            layerAnalysis[layer].fallback = w.heightFallback[i];
 #endif
 
-                        // We only have real data if this is not a fallback heightfield.
-                        if (!isFallback)
-                        {
-                            realData = true;
-                        }
+            // We only have real data if this is not a fallback heightfield.
+            if (!w.heightFallback[i])
+            {
+                realData = true;
+            }
 
-                        float elevation;
-                        if (layerHF.getElevation(keySRS, x, y, interpolation, keySRS, elevation))
-                        {
-                            if (elevation != NO_DATA_VALUE)
-                            {
-                                // remember the index so we can only apply offset layers that
-                                // sit on TOP of this layer.
-                                resolvedIndex = index;
+            sampleGrid(layerHF, keySRS, pending, numColumns, xmin, ymin, dx, dy, interpolation, points, elevations, ok);
 
-                                hf->setHeight(c, r, elevation);
+            const int index = w.contenders[i].index;
+            const float resolution = actualKey.getResolution(numColumns).second;
 
-                                resolution = actualKey.getResolution(hf->getNumColumns()).second;
+            // keep the points this layer couldn't resolve for the next one
+            unsigned numPending = 0;
+            for (unsigned k = 0; k < pending.size(); ++k)
+            {
+                const unsigned s = pending[k];
+                if (ok[k] && elevations[k] != NO_DATA_VALUE)
+                {
+                    // remember the index so we can only apply offset layers that
+                    // sit on TOP of this layer.
+                    resolvedIndex[s] = index;
+                    heights[s] = elevations[k];
+                    sampleResolutions[s] = resolution;
+                }
+                else
+                {
+                    pending[numPending++] = s;
+                }
+            }
 #ifdef ANALYZE
-                                layerAnalysis[layer].samples++;
+            layerAnalysis[layer].samples += pending.size() - numPending;
 #endif
-                            }
-                            else
-                            {
-                                ++nodataCount;
-                            }
-                        }
-                    }
+            pending.resize(numPending);
+        }
 
+        std::vector<unsigned> targets;
+        targets.reserve(total);
 
-                    // Clear the heightfield cache if we have too many heightfields in the cache.
-                    if (numHeightFieldsInCache >= maxHeightFields)
-                    {
-                        //OE_NOTICE << "Clearing cache" << std::endl;
-                        for (unsigned int k = 0; k < w.heightFields.size(); k++)
-                        {
-                            w.heightFields[k] = GeoHeightField::INVALID;
-                            w.heightFallback[k] = false;
-                        }
-                        numHeightFieldsInCache = 0;
-                    }
-                }
+        for (int i = w.offsets.size() - 1; i >= 0; --i)
+        {
+            if (progress && progress->isCanceled())
+                return false;
 
-                for (int i = w.offsets.size() - 1; i >= 0; --i)
-                {
-                    if (progress && progress->isCanceled())
-                        return false;
+            if (w.offsetFailed[i] == true)
+                continue;
 
-                    // Only apply an offset layer if it sits on top of the resolved layer
-                    // (or if there was no resolved layer).
-                    if (resolvedIndex >= 0 && w.offsets[i].index < resolvedIndex)
-                        continue;
+            // Only apply an offset layer if it sits on top of the resolved layer
+            // (or if there was no resolved layer).
+            targets.clear();
+            for (unsigned s = 0; s < total; ++s)
+            {
+                if (resolvedIndex[s] < 0 || w.offsets[i].index >= resolvedIndex[s])
+                    targets.push_back(s);
+            }
 
-                    TileKey& contenderKey = w.offsets[i].key;
+            if (targets.empty())
+                continue;
 
-                    if (w.offsetFailed[i] == true)
-                        continue;
+            TileKey& contenderKey = w.offsets[i].key;
 
-                    GeoHeightField& layerHF = w.offsetFields[i];
-                    if (!layerHF.valid())
-                    {
-                        ElevationLayer* offset = w.offsets[i].layer.get();
+            GeoHeightField& layerHF = w.offsetFields[i];
+            if (!layerHF.valid())
+            {
+                ElevationLayer* offset = w.offsets[i].layer.get();
 
-                        layerHF = offset->createHeightField(contenderKey, progress);
-                        if (!layerHF.valid())
-                        {
-                            w.offsetFailed[i] = true;
-                            continue;
-                        }
-                    }
+                layerHF = offset->createHeightField(contenderKey, progress);
+                if (!layerHF.valid())
+                {
+                    w.offsetFailed[i] = true;
+                    continue;
+                }
+            }
 
-                    // If we actually got a layer then we have real data
-                    realData = true;
+            // If we actually got a layer then we have real data
+            realData = true;
 
-                    float elevation = 0.0f;
-                    if (layerHF.getElevation(keySRS, x, y, interpolation, keySRS, elevation) &&
-                        elevation != NO_DATA_VALUE &&
-                        !osg::equivalent(elevation, 0.0f) )
-                    {
-                        hf->getHeight(c, r) += elevation;
+            sampleGrid(layerHF, keySRS, targets, numColumns, xmin, ymin, dx, dy, interpolation, points, elevations, ok);
 
-                        // Technically this is correct, but the resultin normal maps
-                        // look awful and faceted.
-                        resolution = std::min(
-                            resolution,
-                            (float)contenderKey.getResolution(hf->getNumColumns()).second);
-                    }
-                }
+            // Technically this is correct, but the resultin normal maps
+            // look awful and faceted.
+            const float resolution = (float)contenderKey.getResolution(numColumns).second;
 
-                if (resolutions)
+            for (unsigned k = 0; k < targets.size(); ++k)
+            {
+                const float elevation = elevations[k];
+                if (ok[k] && elevation != NO_DATA_VALUE && !osg::equivalent(elevation, 0.0f))
                 {
-                    (*resolutions)[r*numColumns+c] = resolution;
+                    const unsigned s = targets[k];
+                    heights[s] += elevation;
+                    sampleResolutions[s] = std::min(sampleResolutions[s], resolution);
                 }
             }
         }
+
+        if (resolutions)
+        {
+            std::copy(sampleResolutions.begin(), sampleResolutions.end(), resolutions->begin());
+        }
     }
 
 #ifdef ANALYZE
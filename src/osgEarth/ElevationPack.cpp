@@ -0,0 +1,578 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ElevationPack>
+#include <osgEarth/Notify>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <map>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+using namespace osgEarth;
+
+#define LC "[ElevationPack] "
+
+// File layout (native byte order):
+//
+//   Header      64 bytes
+//   Tiles       tileSize*tileSize floats each, row 0 = south, 4K-aligned
+//   Index       numTiles IndexEntry records, sorted by (lod, y, x)
+//   Profile     ProfileOptions as JSON
+//
+// The header is written last, so a pack whose writer did not finish
+// fails the magic check.
+
+namespace
+{
+    const char MAGIC[4] = { 'O', 'E', 'E', 'P' };
+    const std::uint32_t VERSION = 1u;
+    const std::uint64_t TILE_ALIGNMENT = 4096u;
+
+    const std::uint32_t FLAG_COMPLETE = 1u; // no NO_DATA_VALUE or NaN samples
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t tileSize;
+        std::uint32_t numTiles;
+        std::uint64_t indexOffset;
+        std::uint64_t profileOffset;
+        std::uint32_t profileSize;
+        char reserved[28];
+    };
+    static_assert(sizeof(Header) == 64, "ElevationPack header must be 64 bytes");
+}
+
+static_assert(sizeof(ElevationPack::IndexEntry) == 32, "ElevationPack index entries must be 32 bytes");
+
+//........................................................................
+
+// Read-only mapping of an entire file
+class ElevationPack::MappedFile
+{
+public:
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (_data)
+            ::UnmapViewOfFile(_data);
+        if (_mapping)
+            ::CloseHandle(_mapping);
+        if (_file != INVALID_HANDLE_VALUE)
+            ::CloseHandle(_file);
+#else
+        if (_data)
+            ::munmap((void*)_data, _size);
+        if (_fd >= 0)
+            ::close(_fd);
+#endif
+    }
+
+    bool open(const std::string& path)
+    {
+#ifdef _WIN32
+        _file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (_file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+            return false;
+        _size = (std::uint64_t)size.QuadPart;
+        _mapping = ::CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (_mapping == nullptr)
+            return false;
+        _data = (const char*)::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        _fd = ::open(path.c_str(), O_RDONLY);
+        if (_fd < 0)
+            return false;
+        struct stat s;
+        if (::fstat(_fd, &s) != 0 || s.st_size == 0)
+            return false;
+        _size = (std::uint64_t)s.st_size;
+        void* ptr = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+        _data = ptr == MAP_FAILED ? nullptr : (const char*)ptr;
+        if (_data)
+            ::madvise(ptr, _size, MADV_RANDOM);
+#endif
+        return _data != nullptr;
+    }
+
+    const char* data() const { return _data; }
+    std::uint64_t size() const { return _size; }
+
+private:
+    const char* _data = nullptr;
+    std::uint64_t _size = 0u;
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+};
+
+//........................................................................
+
+ElevationPack::ElevationPack() :
+    _tileSize(0u),
+    _numTiles(0u),
+    _index(nullptr)
+{
+    //nop
+}
+
+ElevationPack::~ElevationPack()
+{
+    //nop
+}
+
+osg::ref_ptr<ElevationPack>
+ElevationPack::open(const std::string& path, Status& status)
+{
+    osg::ref_ptr<ElevationPack> pack = new ElevationPack();
+    pack->_file.reset(new MappedFile());
+
+    if (!pack->_file->open(path))
+    {
+        status = Status(Status::ResourceUnavailable, "Cannot map " + path);
+        return nullptr;
+    }
+
+    const char* base = pack->_file->data();
+    const std::uint64_t size = pack->_file->size();
+
+    Header header;
+    if (size < sizeof(Header))
+    {
+        status = Status(Status::ResourceUnavailable, path + " is not an elevation pack");
+        return nullptr;
+    }
+    memcpy(&header, base, sizeof(Header));
+
+    if (memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION)
+    {
+        status = Status(Status::ResourceUnavailable, path + " is not an elevation pack, or was not finished");
+        return nullptr;
+    }
+
+    const std::uint64_t tileBytes = (std::uint64_t)header.tileSize * header.tileSize * sizeof(float);
+
+    if (header.indexOffset + (std::uint64_t)header.numTiles * sizeof(IndexEntry) > size ||
+        header.profileOffset + header.profileSize > size ||
+        header.indexOffset % alignof(IndexEntry) != 0)
+    {
+        status = Status(Status::ResourceUnavailable, path + " is truncated");
+        return nullptr;
+    }
+
+    pack->_tileSize = header.tileSize;
+    pack->_numTiles = header.numTiles;
+    pack->_index = reinterpret_cast<const IndexEntry*>(base + header.indexOffset);
+
+    for (unsigned i = 0; i < pack->_numTiles; ++i)
+    {
+        if (pack->_index[i].offset + tileBytes > size)
+        {
+            status = Status(Status::ResourceUnavailable, path + " is truncated");
+            return nullptr;
+        }
+    }
+
+    Config conf;
+    conf.fromJSON(std::string(base + header.profileOffset, header.profileSize));
+    pack->_profile = Profile::create(ProfileOptions(ConfigOptions(conf)));
+
+    if (!pack->_profile.valid())
+    {
+        status = Status(Status::ResourceUnavailable, path + " has an invalid profile");
+        return nullptr;
+    }
+
+    status = Status::NoError;
+    return pack;
+}
+
+const ElevationPack::IndexEntry*
+ElevationPack::find(const TileKey& key) const
+{
+    if (!key.valid() || _index == nullptr ||
+        !key.getProfile()->isHorizEquivalentTo(_profile.get()))
+    {
+        return nullptr;
+    }
+
+    IndexEntry query;
+    query.lod = key.getLOD(), query.x = key.getTileX(), query.y = key.getTileY();
+
+    const IndexEntry* end = _index + _numTiles;
+    const IndexEntry* i = std::lower_bound(_index, end, query);
+
+    return (i != end && !(query < *i)) ? i : nullptr;
+}
+
+const float*
+ElevationPack::data(const IndexEntry* entry) const
+{
+    return reinterpret_cast<const float*>(_file->data() + entry->offset);
+}
+
+bool
+ElevationPack::hasTile(const TileKey& key) const
+{
+    return find(key) != nullptr;
+}
+
+bool
+ElevationPack::isComplete(const TileKey& key) const
+{
+    const IndexEntry* entry = find(key);
+    return entry != nullptr && (entry->flags & FLAG_COMPLETE) != 0;
+}
+
+bool
+ElevationPack::getHeightRange(const TileKey& key, float& minHeight, float& maxHeight) const
+{
+    const IndexEntry* entry = find(key);
+    if (entry == nullptr || (entry->flags & FLAG_COMPLETE) == 0)
+        return false;
+
+    minHeight = entry->minHeight;
+    maxHeight = entry->maxHeight;
+    return true;
+}
+
+void
+ElevationPack::getDataExtents(DataExtentList& output) const
+{
+    std::map<unsigned, GeoExtent> extents;
+
+    for (unsigned i = 0; i < _numTiles; ++i)
+    {
+        const IndexEntry& e = _index[i];
+        TileKey key(e.lod, e.x, e.y, _profile.get());
+
+        auto iter = extents.find(e.lod);
+        if (iter == extents.end())
+            extents[e.lod] = key.getExtent();
+        else
+            iter->second.expandToInclude(key.getExtent());
+    }
+
+    for (auto& e : extents)
+    {
+        output.push_back(DataExtent(e.second, e.first, e.first));
+    }
+}
+
+GeoImage
+ElevationPack::getImageView(const TileKey& key) const
+{
+    const IndexEntry* entry = find(key);
+    if (entry == nullptr)
+        return GeoImage::INVALID;
+
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+
+    // The image never writes or frees the mapped memory.
+    image->setImage(
+        _tileSize, _tileSize, 1,
+        GL_R32F, GL_RED, GL_FLOAT,
+        const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(data(entry))),
+        osg::Image::NO_DELETE);
+
+    // keeps the mapping alive as long as the image
+    image->setUserData(const_cast<ElevationPack*>(this));
+
+    return GeoImage(image.get(), key.getExtent());
+}
+
+GeoHeightField
+ElevationPack::getHeightField(const TileKey& key) const
+{
+    const IndexEntry* entry = find(key);
+    if (entry == nullptr)
+        return GeoHeightField::INVALID;
+
+    osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+    hf->allocate(_tileSize, _tileSize);
+
+    memcpy(
+        hf->getFloatArray()->asVector().data(),
+        data(entry),
+        sizeof(float) * _tileSize * _tileSize);
+
+    return GeoHeightField(hf.get(), key.getExtent());
+}
+
+//........................................................................
+
+ElevationPack::Writer::Writer() :
+    _file(nullptr),
+    _tileSize(0u),
+    _offset(0u)
+{
+    //nop
+}
+
+ElevationPack::Writer::~Writer()
+{
+    if (_file)
+    {
+        close();
+    }
+}
+
+Status
+ElevationPack::Writer::open(const std::string& path, const Profile* profile, unsigned tileSize)
+{
+    if (_file)
+        return Status(Status::AssertionFailure, "Writer is already open");
+
+    if (profile == nullptr || tileSize == 0u)
+        return Status(Status::ConfigurationError, "Missing profile or tile size");
+
+    osgDB::makeDirectoryForFile(path);
+
+    _file = std::fopen(path.c_str(), "wb");
+    if (_file == nullptr)
+        return Status(Status::ResourceUnavailable, "Cannot create " + path);
+
+    _path = path;
+    _profile = profile;
+    _tileSize = tileSize;
+    _entries.clear();
+
+    // placeholder header; the real one goes in when we finish
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    std::fwrite(&header, sizeof(Header), 1, _file);
+    _offset = sizeof(Header);
+
+    return Status::NoError;
+}
+
+Status
+ElevationPack::Writer::write(const TileKey& key, const osg::HeightField* hf)
+{
+    if (_file == nullptr)
+        return Status(Status::AssertionFailure, "Writer is not open");
+
+    if (hf == nullptr || hf->getNumColumns() != _tileSize || hf->getNumRows() != _tileSize)
+        return Status(Status::ConfigurationError, "Heightfield does not match the pack tile size");
+
+    if (!key.valid() || !key.getProfile()->isHorizEquivalentTo(_profile.get()))
+        return Status(Status::ConfigurationError, "Key is not in the pack profile");
+
+    const std::vector<float>& heights = hf->getFloatArray()->asVector();
+
+    IndexEntry entry;
+    entry.lod = key.getLOD();
+    entry.x = key.getTileX();
+    entry.y = key.getTileY();
+    entry.flags = FLAG_COMPLETE;
+    entry.minHeight = FLT_MAX;
+    entry.maxHeight = -FLT_MAX;
+    for (float h : heights)
+    {
+        if (h == NO_DATA_VALUE || osg::isNaN(h))
+        {
+            entry.flags = 0u;
+        }
+        else
+        {
+            entry.minHeight = std::min(entry.minHeight, h);
+            entry.maxHeight = std::max(entry.maxHeight, h);
+        }
+    }
+
+    // page-align each tile
+    std::uint64_t aligned = (_offset + TILE_ALIGNMENT - 1u) / TILE_ALIGNMENT * TILE_ALIGNMENT;
+    if (aligned > _offset)
+    {
+        std::vector<char> pad(aligned - _offset, 0);
+        std::fwrite(pad.data(), 1, pad.size(), _file);
+    }
+    entry.offset = aligned;
+
+    const std::size_t bytes = sizeof(float) * heights.size();
+    if (std::fwrite(heights.data(), 1, bytes, _file) != bytes)
+        return Status(Status::ResourceUnavailable, "Failed to write to " + _path);
+
+    _offset = aligned + bytes;
+    _entries.push_back(entry);
+
+    return Status::NoError;
+}
+
+Status
+ElevationPack::Writer::close()
+{
+    if (_file == nullptr)
+        return Status(Status::AssertionFailure, "Writer is not open");
+
+    std::sort(_entries.begin(), _entries.end());
+
+    for (unsigned i = 1; i < _entries.size(); ++i)
+    {
+        if (!(_entries[i - 1] < _entries[i]))
+        {
+            std::fclose(_file);
+            _file = nullptr;
+            return Status(Status::ConfigurationError, "Same tile written more than once");
+        }
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    header.tileSize = _tileSize;
+    header.numTiles = (std::uint32_t)_entries.size();
+
+    // index (8-byte aligned so it can be used in place)
+    std::uint64_t aligned = (_offset + 7u) / 8u * 8u;
+    if (aligned > _offset)
+    {
+        char pad[8] = { 0 };
+        std::fwrite(pad, 1, aligned - _offset, _file);
+    }
+    header.indexOffset = aligned;
+    for (auto& entry : _entries)
+        std::fwrite(&entry, sizeof(IndexEntry), 1, _file);
+    _offset = aligned + sizeof(IndexEntry) * _entries.size();
+
+    std::string json = _profile->toProfileOptions().getConfig().toJSON();
+    header.profileOffset = _offset;
+    header.profileSize = (std::uint32_t)json.size();
+    std::fwrite(json.data(), 1, json.size(), _file);
+
+    std::fseek(_file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(Header), 1, _file);
+
+    bool ok = std::ferror(_file) == 0;
+    ok = (std::fclose(_file) == 0) && ok;
+    _file = nullptr;
+    _entries.clear();
+
+    return ok ? Status::NoError : Status(Status::ResourceUnavailable, "Failed to write to " + _path);
+}
+
+//........................................................................
+
+Config
+ElevationPackLayer::Options::getConfig() const
+{
+    Config conf = ElevationLayer::Options::getConfig();
+    conf.set("url", url());
+    return conf;
+}
+
+void
+ElevationPackLayer::Options::fromConfig(const Config& conf)
+{
+    conf.get("url", url());
+}
+
+REGISTER_OSGEARTH_LAYER(elevationpack, ElevationPackLayer);
+
+OE_LAYER_PROPERTY_IMPL(ElevationPackLayer, URI, URL, url);
+
+void
+ElevationPackLayer::init()
+{
+    ElevationLayer::init();
+
+    // local data that is already in its final form; caching would only copy it
+    layerHints().cachePolicy() = CachePolicy::NO_CACHE;
+}
+
+Status
+ElevationPackLayer::openImplementation()
+{
+    Status parent = ElevationLayer::openImplementation();
+    if (parent.isError())
+        return parent;
+
+    Status status;
+    _pack = ElevationPack::open(options().url()->full(), status);
+    if (status.isError())
+        return status;
+
+    setProfile(_pack->getProfile());
+
+    DataExtentList dataExtents;
+    _pack->getDataExtents(dataExtents);
+    setDataExtents(dataExtents);
+
+    return Status::NoError;
+}
+
+Status
+ElevationPackLayer::closeImplementation()
+{
+    _pack = nullptr;
+    return ElevationLayer::closeImplementation();
+}
+
+GeoHeightField
+ElevationPackLayer::createHeightFieldImplementation(const TileKey& key, ProgressCallback* progress) const
+{
+    osg::ref_ptr<ElevationPack> pack = _pack;
+    if (!pack.valid())
+        return GeoHeightField(getStatus());
+
+    return pack->getHeightField(key);
+}
+
+GeoImage
+ElevationPackLayer::createHeightImageViewImplementation(const TileKey& key) const
+{
+    osg::ref_ptr<ElevationPack> pack = _pack;
+    if (!pack.valid())
+        return GeoImage::INVALID;
+
+    // Only hand out tiles that createHeightField would return unchanged;
+    // anything with values to normalize takes the copying path.
+    float minHeight, maxHeight;
+    if (!pack->getHeightRange(key, minHeight, maxHeight) ||
+        minHeight < getMinValidValue() ||
+        maxHeight > getMaxValidValue() ||
+        (getNoDataValue() >= minHeight - 1e-6f && getNoDataValue() <= maxHeight + 1e-6f))
+    {
+        return GeoImage::INVALID;
+    }
+
+    return pack->getImageView(key);
+}
@@ -26,9 +26,12 @@
 #include <osgEarth/Containers>
 #include <osgEarth/Progress>
 #include <osgEarth/Notify>
+#include <osgEarth/SIMD>
 
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <mutex>
 
 using namespace osgEarth;
 
@@ -317,6 +320,69 @@ ElevationPool::findExistingRaster(
     return output.valid();
 }
 
+osg::ref_ptr<ElevationTexture>
+ElevationPool::createRasterView(
+    const Internal::RevElevationKey& key,
+    const Map* map,
+    bool acceptLowerRes,
+    WorkingSet* ws)
+{
+    const ElevationLayerVector& layersToSample =
+        ws && !ws->_elevationLayers.empty() ? ws->_elevationLayers :
+        _elevationLayers;
+
+    // Only when populateHeightField would copy a single layer's tile
+    // verbatim; anything that needs mosaicing or resampling can't be a view.
+    if (layersToSample.size() != 1)
+        return nullptr;
+
+    ElevationLayer* layer = layersToSample.front().get();
+    if (!layer->isOpen() ||
+        layer->isOffset() ||
+        layer->getTileSize() != _tileSize ||
+        key._tilekey.getLOD() < layer->getMinLevel())
+    {
+        return nullptr;
+    }
+
+    // same loop as the populateHeightField path, in the HAE profile
+    for (TileKey keyToUse = key._tilekey;
+        keyToUse.valid();
+        keyToUse.makeParent())
+    {
+        TileKey haeKey(
+            keyToUse.getLOD(), keyToUse.getTileX(), keyToUse.getTileY(),
+            map->getProfileNoVDatum());
+
+        if (layer->getBestAvailableTileKey(haeKey) == haeKey)
+        {
+            GeoImage view = layer->createHeightImageView(haeKey);
+
+            if (view.valid() &&
+                view.getImage()->s() == (int)_tileSize &&
+                view.getImage()->t() == (int)_tileSize)
+            {
+                std::vector<float> resolutions(
+                    _tileSize * _tileSize,
+                    (float)haeKey.getResolution(_tileSize).second);
+
+                return new ElevationTexture(
+                    keyToUse,
+                    GeoImage(view.getImage(), keyToUse.getExtent()),
+                    resolutions);
+            }
+
+            // the layer has data here but can't share it
+            return nullptr;
+        }
+
+        if (acceptLowerRes == false)
+            break;
+    }
+
+    return nullptr;
+}
+
 osg::ref_ptr<ElevationTexture>
 ElevationPool::getOrCreateRaster(
     const Internal::RevElevationKey& key,
@@ -333,6 +399,12 @@ ElevationPool::getOrCreateRaster(
 
     findExistingRaster(key, ws, result, &fromWS, &fromL2, &fromLUT);
 
+    if (!result.valid())
+    {
+        // a single layer that can share its storage needs no new grid
+        result = createRasterView(key, map, acceptLowerRes, ws);
+    }
+
     if (!result.valid())
     {
         // need to build NEW data for this key
@@ -470,6 +542,254 @@ namespace
         a.BOT = a.LL * minusSmix + a.LR * smix;
         out = a.TOP * minusTmis + a.BOT * tmix;
     }
+
+    // Point count at which sampleMapCoords switches to the batch path.
+    // Below this the sort and gather overhead outweighs the savings.
+    const std::size_t BATCH_SAMPLE_THRESHOLD = 32u;
+
+    // Smallest number of points worth handing to a parallel job.
+    const std::size_t PARALLEL_MIN_CHUNK_SIZE = 2048u;
+
+    // Parallel jobs per pool thread. Cutting the work finer than one chunk
+    // per thread keeps the threads busy when some chunks are slower than others
+    // (cold tiles, denser data).
+    const std::size_t PARALLEL_CHUNKS_PER_THREAD = 8u;
+}
+
+struct ElevationPool::BatchSample
+{
+    int lod;
+    unsigned tx, ty;
+    double x, y;
+    float z;
+    unsigned index;
+
+    bool operator < (const BatchSample& rhs) const {
+        if (lod != rhs.lod) return lod < rhs.lod;
+        if (ty != rhs.ty) return ty < rhs.ty;
+        if (tx != rhs.tx) return tx < rhs.tx;
+        return index < rhs.index;
+    }
+
+    bool sameTile(const BatchSample& rhs) const {
+        return lod == rhs.lod && tx == rhs.tx && ty == rhs.ty;
+    }
+};
+
+namespace
+{
+    // Bilinear interpolation of a run of samples that all fall in one raster.
+    // The texel coordinates and weights are computed per point in double
+    // exactly like quickSample(); the blend is then done four points at a
+    // time with the same single-precision operations, so the results match
+    // the scalar path.
+    void interpolateRun(
+        const ElevationTexture* raster,
+        ElevationPool::BatchSample* samples,
+        std::size_t count)
+    {
+        using namespace osgEarth::Util::SIMD;
+
+        const ImageUtils::PixelReader& reader = raster->reader();
+        const osg::Image* image = raster->getImage(0);
+        const GeoExtent& ex = raster->getExtent();
+
+        const bool rawFloat =
+            image != nullptr &&
+            image->getPixelFormat() == GL_RED &&
+            image->getDataType() == GL_FLOAT;
+
+        const double sizeS = (double)(reader.s() - 1);
+        const double sizeT = (double)(reader.t() - 1);
+
+        alignas(16) float UL[4], UR[4], LL[4], LR[4];
+        alignas(16) float smix[4], minusSmix[4], tmix[4], minusTmix[4];
+        alignas(16) float result[4];
+        ElevationPool::Envelope::QuickSampleVars qvars;
+        osg::Vec4f elev;
+
+        for (std::size_t base = 0; base < count; base += 4)
+        {
+            const std::size_t lanes = std::min<std::size_t>(4u, count - base);
+
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                if (i >= lanes)
+                {
+                    UL[i] = UR[i] = LL[i] = LR[i] = 0.0f;
+                    smix[i] = minusSmix[i] = tmix[i] = minusTmix[i] = 0.0f;
+                    continue;
+                }
+
+                const ElevationPool::BatchSample& p = samples[base + i];
+
+                double u = (p.x - ex.xMin()) / ex.width();
+                double v = (p.y - ex.yMin()) / ex.height();
+                u = osg::clampBetween(u, 0.0, 1.0);
+                v = osg::clampBetween(v, 0.0, 1.0);
+
+                if (!rawFloat)
+                {
+                    // unusual pixel format; let the reader decode it
+                    quickSample(reader, u, v, elev, qvars);
+                    UL[i] = UR[i] = LL[i] = LR[i] = elev.r();
+                    smix[i] = tmix[i] = 0.0f;
+                    minusSmix[i] = minusTmix[i] = 1.0f;
+                    continue;
+                }
+
+                const double s = u * sizeS;
+                const double t = v * sizeT;
+
+                const double s0 = std::max(floor(s), 0.0);
+                const double s1 = std::min(s0 + 1.0, sizeS);
+                const double sm = s0 < s1 ? (s - s0) / (s1 - s0) : 0.0;
+
+                const double t0 = std::max(floor(t), 0.0);
+                const double t1 = std::min(t0 + 1.0, sizeT);
+                const double tm = t0 < t1 ? (t - t0) / (t1 - t0) : 0.0;
+
+                const float* row0 = reinterpret_cast<const float*>(reader.data(0, (int)t0));
+                const float* row1 = reinterpret_cast<const float*>(reader.data(0, (int)t1));
+
+                UL[i] = row0[(int)s0];
+                UR[i] = row0[(int)s1];
+                LL[i] = row1[(int)s0];
+                LR[i] = row1[(int)s1];
+
+                smix[i] = (float)sm;
+                minusSmix[i] = (float)(1.0 - sm);
+                tmix[i] = (float)tm;
+                minusTmix[i] = (float)(1.0 - tm);
+            }
+
+            float4 top =
+                float4::load(UL) * float4::load(minusSmix) +
+                float4::load(UR) * float4::load(smix);
+
+            float4 bot =
+                float4::load(LL) * float4::load(minusSmix) +
+                float4::load(LR) * float4::load(smix);
+
+            float4 out =
+                top * float4::load(minusTmix) +
+                bot * float4::load(tmix);
+
+            out.store(result);
+
+            for (std::size_t i = 0; i < lanes; ++i)
+            {
+                samples[base + i].z = result[i];
+            }
+        }
+    }
+}
+
+bool
+ElevationPool::makeBatchSample(
+    const osg::Vec3d& p,
+    const Distance& resolution,
+    const Profile* profile,
+    BatchSample& out) const
+{
+    auto& units = profile->getSRS()->getUnits();
+    const GeoExtent& pe = profile->getExtent();
+
+    // wrap longitudes around the antimeridian
+    double x = p.x();
+    if (profile->getSRS()->isGeographic() && (x < pe.xMin() || x > pe.xMax()))
+    {
+        x = pe.xMin() + fmod(x - pe.xMin(), pe.width());
+        if (x < pe.xMin())
+            x += pe.width();
+    }
+
+    double resolutionInMapUnits = resolution.asDistance(units, p.y());
+    int computedLOD = profile->getLevelOfDetailForHorizResolution(
+        resolutionInMapUnits,
+        ELEVATION_TILE_SIZE);
+
+    out.lod = osg::minimum(getLOD(x, p.y()), (int)computedLOD);
+
+    if (out.lod < 0)
+        return false;
+
+    unsigned tw, th;
+    profile->getNumTiles(out.lod, tw, th);
+
+    double rx = (x - pe.xMin()) / pe.width();
+    double ry = (p.y() - pe.yMin()) / pe.height();
+
+    out.tx = osg::clampBelow((unsigned)(rx * (double)tw), tw - 1u);
+    out.ty = osg::clampBelow((unsigned)((1.0 - ry) * (double)th), th - 1u);
+    out.x = x, out.y = p.y();
+    return true;
+}
+
+int
+ElevationPool::sampleBatch(
+    BatchSample* first_sample,
+    BatchSample* last_sample,
+    const Map* map,
+    WorkingSet* ws,
+    ProgressCallback* progress,
+    float failValue)
+{
+    OE_PROFILING_ZONE;
+
+    const Profile* profile = map->getProfile();
+
+    Internal::RevElevationKey key;
+    key._revision = getElevationHash(ws);
+
+    int count = 0;
+
+    for (BatchSample* first = first_sample; first != last_sample; )
+    {
+        BatchSample* last = first + 1;
+        while (last != last_sample && last->sameTile(*first))
+            ++last;
+
+        const BatchSample& head = *first;
+        key._tilekey = TileKey(head.lod, head.tx, head.ty, profile);
+
+        osg::ref_ptr<ElevationTexture> raster;
+
+        if (key._tilekey.valid())
+        {
+            raster = getOrCreateRaster(
+                key,   // key to query
+                map,   // map to query
+                true,  // fall back on lower resolution data if necessary
+                ws,    // user's workingset
+                progress);
+
+            if (progress && progress->isCanceled())
+            {
+                return -1;
+            }
+        }
+
+        if (raster.valid())
+        {
+            interpolateRun(raster.get(), first, last - first);
+
+            for (BatchSample* i = first; i != last; ++i)
+            {
+                if (i->z != failValue)
+                    ++count;
+            }
+        }
+        else
+        {
+            for (BatchSample* i = first; i != last; ++i)
+                i->z = failValue;
+        }
+
+        first = last;
+    }
+
+    return count;
 }
 
 bool
@@ -679,6 +999,54 @@ ElevationPool::sampleMapCoords(
     auto& units = map->getSRS()->getUnits();
     Distance pointRes(0.0, units);
 
+    if ((std::size_t)(end - begin) >= BATCH_SAMPLE_THRESHOLD)
+    {
+        std::vector<BatchSample> batch;
+        batch.reserve(end - begin);
+
+        for (auto iter = begin; iter != end; ++iter)
+        {
+            auto& p = *iter;
+
+            if (p.w() == FLT_MAX)
+                continue;
+
+            pointRes.set(p.w(), units);
+
+            double resolutionInMapUnits = pointRes.asDistance(units, p.y());
+
+            lod = profile->getLevelOfDetailForHorizResolution(
+                resolutionInMapUnits,
+                ELEVATION_TILE_SIZE);
+
+            profile->getNumTiles(lod, tw, th);
+
+            rx = (p.x() - pxmin) / pw, ry = (p.y() - pymin) / ph;
+
+            BatchSample b;
+            b.lod = lod;
+            b.tx = osg::clampBelow((unsigned)(rx * (double)tw), tw - 1u);
+            b.ty = osg::clampBelow((unsigned)((1.0 - ry) * (double)th), th - 1u);
+            b.x = p.x(), b.y = p.y();
+            b.index = (unsigned)(iter - begin);
+            batch.push_back(b);
+        }
+
+        // Group the points by tile so that each raster is fetched once
+        // and its samples are interpolated together.
+        std::sort(batch.begin(), batch.end());
+
+        count = sampleBatch(batch.data(), batch.data() + batch.size(), map.get(), ws, progress, failValue);
+
+        if (count >= 0)
+        {
+            for (auto& b : batch)
+                (begin + b.index)->z() = b.z;
+        }
+
+        return count;
+    }
+
     for (auto iter = begin; iter != end; ++iter)
     {
         auto& p = *iter;
@@ -819,6 +1187,42 @@ ElevationPool::sampleMapCoords(
     int lod_prev = INT_MAX;
     auto& units = map->getSRS()->getUnits();
 
+    if ((std::size_t)(end - begin) >= BATCH_SAMPLE_THRESHOLD)
+    {
+        std::vector<BatchSample> batch;
+        batch.reserve(end - begin);
+
+        for (auto iter = begin; iter != end; ++iter)
+        {
+            auto& p = *iter;
+
+            BatchSample b;
+            if (makeBatchSample(p, resolution, profile, b))
+            {
+                b.index = (unsigned)(iter - begin);
+                batch.push_back(b);
+            }
+            else
+            {
+                p.z() = failValue;
+            }
+        }
+
+        // Group the points by tile so that each raster is fetched once
+        // and its samples are interpolated together.
+        std::sort(batch.begin(), batch.end());
+
+        count = sampleBatch(batch.data(), batch.data() + batch.size(), map.get(), ws, progress, failValue);
+
+        if (count >= 0)
+        {
+            for (auto& b : batch)
+                (begin + b.index)->z() = b.z;
+        }
+
+        return count;
+    }
+
     for (auto iter = begin; iter != end; ++iter)
     {
         auto& p = *iter;
@@ -911,6 +1315,170 @@ ElevationPool::sampleMapCoords(
     return count;
 }
 
+int
+ElevationPool::sampleMapCoordsParallel(
+    std::vector<osg::Vec3d>::iterator begin,
+    std::vector<osg::Vec3d>::iterator end,
+    const Distance& resolution,
+    WorkingSet* ws,
+    ProgressCallback* progress,
+    float failValue)
+{
+    OE_PROFILING_ZONE;
+
+    if (begin == end)
+        return -1;
+
+    jobs::jobpool* pool = jobs::get_pool("oe.elevationpool");
+    const std::size_t total = end - begin;
+    const std::size_t threads = std::max(pool->concurrency(), 1u);
+
+    // not worth the overhead; sample in this thread.
+    if (threads == 1u || total < 2u * PARALLEL_MIN_CHUNK_SIZE)
+    {
+        return sampleMapCoords(begin, end, resolution, ws, progress, failValue);
+    }
+
+    osg::ref_ptr<const Map> map;
+    if (_map.lock(map) == false || map->getProfile() == NULL)
+        return -1;
+
+    sync(map.get(), ws);
+
+    const Profile* profile = map->getProfile();
+
+    const std::size_t chunkSize = std::max(
+        PARALLEL_MIN_CHUNK_SIZE,
+        total / (threads * PARALLEL_CHUNKS_PER_THREAD) + 1u);
+
+    auto canceled = [progress]() { return progress && progress->isCanceled(); };
+
+    // Note: the jobs below each take their own read lock. This thread must
+    // not hold one while it waits, or a queued writer would deadlock us.
+
+    jobs::context context;
+    context.name = "oe.elevationpool.sample";
+    context.pool = pool;
+
+    // Pass 1: compute the tile key of each point, and sort each span by tile.
+    std::vector<BatchSample> batch(total);
+    std::vector<std::size_t> bounds;
+
+    context.group = jobs::jobgroup::create();
+    for (std::size_t first = 0; first < total; first += chunkSize)
+    {
+        const std::size_t last = std::min(first + chunkSize, total);
+        bounds.push_back(first);
+
+        jobs::dispatch([&, first, last]()
+            {
+                if (canceled())
+                    return;
+
+                ScopedReadLock lk(_mutex);
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    BatchSample& b = batch[i];
+                    b.index = (unsigned)i;
+                    if (!makeBatchSample(*(begin + i), resolution, profile, b))
+                        b.lod = -1;
+                }
+                std::sort(batch.begin() + first, batch.begin() + last);
+            }, context);
+    }
+    bounds.push_back(total);
+    context.group->join();
+
+    // Pass 2: merge the sorted spans pairwise until the whole set is ordered by tile.
+    std::vector<BatchSample> scratch(total);
+    while (bounds.size() > 2u && !canceled())
+    {
+        std::vector<std::size_t> merged;
+        context.group = jobs::jobgroup::create();
+
+        for (std::size_t i = 0; i + 1 < bounds.size(); i += 2)
+        {
+            const std::size_t a = bounds[i], b = bounds[i + 1];
+            const std::size_t c = (i + 2 < bounds.size()) ? bounds[i + 2] : b;
+            merged.push_back(a);
+
+            jobs::dispatch([&, a, b, c]()
+                {
+                    std::merge(
+                        batch.begin() + a, batch.begin() + b,
+                        batch.begin() + b, batch.begin() + c,
+                        scratch.begin() + a);
+                }, context);
+        }
+        merged.push_back(total);
+        context.group->join();
+
+        batch.swap(scratch);
+        bounds.swap(merged);
+    }
+
+    if (canceled())
+        return -1;
+
+    // Points with no data sort to the front.
+    std::size_t start = 0;
+    for (; start < total && batch[start].lod < 0; ++start)
+        (begin + batch[start].index)->z() = failValue;
+
+    // Pass 3: cut the sorted set into tile-coherent chunks, and sample
+    // each chunk as a job. Results go straight back to the input points,
+    // so the output order matches the input order.
+    std::atomic_int count(0);
+    std::atomic<std::size_t> done(start);
+    std::mutex progressMutex;
+
+    context.group = jobs::jobgroup::create();
+    for (std::size_t first = start; first < total; )
+    {
+        // Prefer to end on a tile boundary, but split a very dense tile
+        // so that one hot spot doesn't serialize the whole job.
+        std::size_t last = std::min(first + chunkSize, total);
+        while (last < total && last - first < 2u * chunkSize && batch[last].sameTile(batch[last - 1]))
+            ++last;
+
+        jobs::dispatch([&, first, last]()
+            {
+                if (canceled())
+                    return;
+
+                int n;
+                {
+                    ScopedReadLock lk(_mutex);
+                    n = sampleBatch(&batch[first], &batch[first] + (last - first), map.get(), ws, progress, failValue);
+                }
+
+                if (n < 0)
+                    return;
+
+                for (std::size_t i = first; i < last; ++i)
+                    (begin + batch[i].index)->z() = batch[i].z;
+
+                count += n;
+                std::size_t sofar = (done += (last - first));
+
+                if (progress)
+                {
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    if (progress->reportProgress((double)sofar, (double)total))
+                        progress->cancel();
+                }
+            }, context);
+
+        first = last;
+    }
+    context.group->join();
+
+    if (canceled())
+        return -1;
+
+    return count;
+}
+
 ElevationSample
 ElevationPool::getSample(
     const GeoPoint& p,
@@ -29,7 +29,8 @@ using namespace osgEarth;
 
 NumericExpression::NumericExpression() :
 _value(0.0),
-_dirty(true)
+_dirty(true),
+_depth(0u)
 {
     //nop
 }
@@ -37,7 +38,8 @@ _dirty(true)
 NumericExpression::NumericExpression( const std::string& expr ) :
 _src  ( expr ),
 _value( 0.0 ),
-_dirty( true )
+_dirty( true ),
+_depth( 0u )
 {
     init();
 }
@@ -47,14 +49,16 @@ _src  ( rhs._src ),
 _rpn  ( rhs._rpn ),
 _vars ( rhs._vars ),
 _value( rhs._value ),
-_dirty( rhs._dirty )
+_dirty( rhs._dirty ),
+_depth( rhs._depth )
 {
     //nop
 }
 
 NumericExpression::NumericExpression( double staticValue ) :
 _value( staticValue ),
-_dirty( false )
+_dirty( false ),
+_depth( 0u )
 {
     _src = Stringify() << staticValue;
     init();
@@ -62,7 +66,8 @@ _dirty( false )
 
 NumericExpression::NumericExpression( const Config& conf ) :
 _value( 0.0 ),
-_dirty( true )
+_dirty( true ),
+_depth( 0u )
 {
     mergeConfig( conf );
     init();
@@ -92,6 +97,7 @@ NumericExpression::getConfig() const
 }
 
 #define IS_OPERATOR(a) ( a .first == ADD || a .first == SUB || a .first == MULT || a .first == DIV || a .first == MOD )
+#define IS_BINARY(a) ( IS_OPERATOR(a) || a .first == MIN || a .first == MAX )
 
 void
 NumericExpression::init()
@@ -263,6 +269,17 @@ NumericExpression::init()
         _rpn.push_back( s.top() );
         s.pop();
     }
+
+    // size the evaluation stack; binary operators with a short stack are skipped
+    unsigned depth = 0u;
+    _depth = 0u;
+    for( unsigned i=0; i<_rpn.size(); ++i )
+    {
+        if ( !IS_BINARY(_rpn[i]) )
+            _depth = std::max( _depth, ++depth );
+        else if ( depth >= 2 )
+            --depth;
+    }
 }
 
 void
@@ -281,82 +298,46 @@ NumericExpression::eval() const
 {
     if ( _dirty )
     {
-        std::stack<double> s;
+        // evaluate on a fixed-size stack; only unusually deep expressions allocate
+        double local[16];
+        std::vector<double> heap;
+        double* s = local;
+        if ( _depth > 16u )
+        {
+            heap.resize( _depth );
+            s = heap.data();
+        }
+        unsigned n = 0u;
 
         for( unsigned i=0; i<_rpn.size(); ++i )
         {
             const Atom& a = _rpn[i];
 
-            if ( a.first == ADD )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 + op2 );
-                }
-            }
-            else if ( a.first == SUB )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 - op2 );
-                }
-            }
-            else if ( a.first == MULT )
+            if ( !IS_BINARY(a) )
             {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 * op2 );
-                }
+                // OPERAND or VARIABLE (or a stray paren, which reads as 0)
+                s[n++] = a.second;
             }
-            else if ( a.first == DIV )
+            else if ( n >= 2 )
             {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 / op2 );
-                }
-            }
-            else if ( a.first == MOD )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( fmod(op1, op2) );
-                }
-            }
-            else if ( a.first == MIN )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( osg::minimum(op1, op2) );
-                }
-            }
-            else if ( a.first == MAX )
-            {
-                if ( s.size() >= 2 )
+                double op2 = s[--n];
+                double& op1 = s[n-1];
+
+                switch( a.first )
                 {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( osg::maximum(op1, op2) );
+                case ADD:  op1 = op1 + op2; break;
+                case SUB:  op1 = op1 - op2; break;
+                case MULT: op1 = op1 * op2; break;
+                case DIV:  op1 = op1 / op2; break;
+                case MOD:  op1 = fmod(op1, op2); break;
+                case MIN:  op1 = osg::minimum(op1, op2); break;
+                case MAX:  op1 = osg::maximum(op1, op2); break;
+                default: break;
                 }
             }
-            else // OPERAND or VARIABLE
-            {
-                s.push( a.second );
-            }
         }
 
-        const_cast<NumericExpression*>(this)->_value = s.size() > 0 ? s.top() : 0.0;
+        const_cast<NumericExpression*>(this)->_value = n > 0 ? s[n-1] : 0.0;
         const_cast<NumericExpression*>(this)->_dirty = false;
     }
 
@@ -553,11 +534,11 @@ StringExpression::eval() const
 {
     if ( _dirty )
     {
-        std::stringstream buf;
+        std::string& value = const_cast<StringExpression*>(this)->_value;
+        value.clear();
         for( AtomVector::const_iterator i = _infix.begin(); i != _infix.end(); ++i )
-            buf << i->second;
+            value.append( i->second );
 
-        const_cast<StringExpression*>(this)->_value = buf.str();
         const_cast<StringExpression*>(this)->_dirty = false;
     }
 
@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/ExtrudeGeometryFilter>
+#include <osgEarth/CompiledExpression>
 #include <osgEarth/Session>
 #include <osgEarth/FeatureSourceIndexNode>
 
@@ -1132,6 +1133,20 @@ ExtrudeGeometryFilter::addDrawable(osg::Drawable*       drawable,
 bool
 ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
 {
+    // Evaluate the height expression for all features up front, unless a
+    // symbol script might change the attributes it reads.
+    std::vector<double> heights;
+    bool precomputeHeights =
+        !_heightCallback.valid() &&
+        _heightExpr.isSet() &&
+        !(_polySymbol.valid() && _polySymbol->script().isSet()) &&
+        !_extrusionSymbol->script().isSet();
+
+    if (precomputeHeights)
+    {
+        CompiledNumericExpression(_heightExpr.get()).eval(features, heights, &context);
+    }
+
     for( FeatureList::iterator f = features.begin(); f != features.end(); ++f )
     {
         Feature* input = f->get();
@@ -1171,6 +1186,10 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
             {
                 height = _heightCallback->operator()(input, context);
             }
+            else if (precomputeHeights)
+            {
+                height = heights[f - features.begin()];
+            }
             else if (_heightExpr.isSet())
             {
                 height = input->eval(_heightExpr.mutable_value(), &context);
@@ -103,38 +103,178 @@ FeatureProfile::setTilingProfile( const osgEarth::Profile* profile )
 
 //----------------------------------------------------------------------------
 
-std::string
-AttributeValue::getString() const
+AttributeValue::AttributeValue() :
+    type(ATTRTYPE_UNSPECIFIED),
+    _stored(ATTRTYPE_UNSPECIFIED)
+{
+    //nop
+}
+
+AttributeValue::AttributeValue(const AttributeValue& rhs) :
+    type(rhs.type),
+    _stored(ATTRTYPE_UNSPECIFIED)
+{
+    copyFrom(rhs);
+}
+
+AttributeValue::AttributeValue(AttributeValue&& rhs) noexcept :
+    type(rhs.type),
+    _stored(ATTRTYPE_UNSPECIFIED)
+{
+    moveFrom(rhs);
+}
+
+AttributeValue&
+AttributeValue::operator = (const AttributeValue& rhs)
 {
-    if (!value.set)
+    if (this != &rhs)
     {
-        return "";
+        type = rhs.type;
+        copyFrom(rhs);
     }
+    return *this;
+}
+
+AttributeValue&
+AttributeValue::operator = (AttributeValue&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        type = rhs.type;
+        moveFrom(rhs);
+    }
+    return *this;
+}
 
-    switch(type) {
-        case ATTRTYPE_STRING: return value.stringValue;
-        case ATTRTYPE_DOUBLE: return osgEarth::toString(value.doubleValue);
-        case ATTRTYPE_INT:    return osgEarth::toString(value.intValue);
-        case ATTRTYPE_BOOL:   return osgEarth::toString(value.boolValue);
+AttributeValue::~AttributeValue()
+{
+    reset(ATTRTYPE_UNSPECIFIED);
+}
+
+void
+AttributeValue::reset(AttributeType stored)
+{
+    if (_stored == stored)
+        return;
+
+    if (_stored == ATTRTYPE_STRING)
+        _string.~basic_string();
+    else if (_stored == ATTRTYPE_DOUBLEARRAY)
+        _doubleArray.~vector();
+
+    _stored = stored;
+
+    if (_stored == ATTRTYPE_STRING)
+        new (&_string) std::string();
+    else if (_stored == ATTRTYPE_DOUBLEARRAY)
+        new (&_doubleArray) std::vector<double>();
+}
+
+void
+AttributeValue::copyFrom(const AttributeValue& rhs)
+{
+    reset(rhs._stored);
+    switch (_stored) {
+        case ATTRTYPE_STRING:      _string = rhs._string; break;
+        case ATTRTYPE_DOUBLE:      _double = rhs._double; break;
+        case ATTRTYPE_INT:         _int = rhs._int; break;
+        case ATTRTYPE_BOOL:        _bool = rhs._bool; break;
+        case ATTRTYPE_DOUBLEARRAY: _doubleArray = rhs._doubleArray; break;
+        case ATTRTYPE_UNSPECIFIED: break;
+    }
+}
+
+void
+AttributeValue::moveFrom(AttributeValue& rhs)
+{
+    reset(rhs._stored);
+    switch (_stored) {
+        case ATTRTYPE_STRING:      _string = std::move(rhs._string); break;
+        case ATTRTYPE_DOUBLE:      _double = rhs._double; break;
+        case ATTRTYPE_INT:         _int = rhs._int; break;
+        case ATTRTYPE_BOOL:        _bool = rhs._bool; break;
+        case ATTRTYPE_DOUBLEARRAY: _doubleArray = std::move(rhs._doubleArray); break;
         case ATTRTYPE_UNSPECIFIED: break;
     }
+    rhs.reset(ATTRTYPE_UNSPECIFIED);
+}
+
+void
+AttributeValue::set(const std::string& value)
+{
+    type = ATTRTYPE_STRING;
+    reset(ATTRTYPE_STRING);
+    _string = value;
+}
+
+void
+AttributeValue::set(double value)
+{
+    type = ATTRTYPE_DOUBLE;
+    reset(ATTRTYPE_DOUBLE);
+    _double = value;
+}
+
+void
+AttributeValue::set(long long value)
+{
+    type = ATTRTYPE_INT;
+    reset(ATTRTYPE_INT);
+    _int = value;
+}
+
+void
+AttributeValue::set(bool value)
+{
+    type = ATTRTYPE_BOOL;
+    reset(ATTRTYPE_BOOL);
+    _bool = value;
+}
+
+void
+AttributeValue::set(const std::vector<double>& value)
+{
+    type = ATTRTYPE_DOUBLEARRAY;
+    reset(ATTRTYPE_DOUBLEARRAY);
+    _doubleArray = value;
+}
+
+void
+AttributeValue::setSwap(std::vector<double>& value)
+{
+    type = ATTRTYPE_DOUBLEARRAY;
+    reset(ATTRTYPE_DOUBLEARRAY);
+    _doubleArray.swap(value);
+}
+
+void
+AttributeValue::setNull()
+{
+    reset(ATTRTYPE_UNSPECIFIED);
+}
+
+std::string
+AttributeValue::getString() const
+{
+    switch(_stored) {
+        case ATTRTYPE_STRING: return _string;
+        case ATTRTYPE_DOUBLE: return osgEarth::toString(_double);
+        case ATTRTYPE_INT:    return osgEarth::toString(_int);
+        case ATTRTYPE_BOOL:   return osgEarth::toString(_bool);
+        default: break;
+    }
     return EMPTY_STRING;
 }
 
 double
 AttributeValue::getDouble( double defaultValue ) const
 {
-    if (!value.set)
-    {
-        return defaultValue;
-    }
-
-    switch(type) {
-        case ATTRTYPE_STRING: return Strings::as<double>(value.stringValue, defaultValue);
-        case ATTRTYPE_DOUBLE: return value.doubleValue;
-        case ATTRTYPE_INT:    return (double)value.intValue;
-        case ATTRTYPE_BOOL:   return value.boolValue? 1.0 : 0.0;
-        case ATTRTYPE_UNSPECIFIED: break;
+    switch(_stored) {
+        case ATTRTYPE_STRING: return Strings::as<double>(_string, defaultValue);
+        case ATTRTYPE_DOUBLE: return _double;
+        case ATTRTYPE_INT:    return (double)_int;
+        case ATTRTYPE_BOOL:   return _bool? 1.0 : 0.0;
+        default: break;
     }
     return defaultValue;
 }
@@ -142,17 +282,12 @@ AttributeValue::getDouble( double defaultValue ) const
 long long
 AttributeValue::getInt( long long defaultValue ) const
 {
-    if (!value.set)
-    {
-        return defaultValue;
-    }
-
-    switch( type ) {
-        case ATTRTYPE_STRING: return Strings::as<int>(value.stringValue, defaultValue);
-        case ATTRTYPE_DOUBLE: return (long long)value.doubleValue;
-        case ATTRTYPE_INT:    return value.intValue;
-        case ATTRTYPE_BOOL:   return value.boolValue? 1 : 0;
-        case ATTRTYPE_UNSPECIFIED: break;
+    switch(_stored) {
+        case ATTRTYPE_STRING: return Strings::as<int>(_string, defaultValue);
+        case ATTRTYPE_DOUBLE: return (long long)_double;
+        case ATTRTYPE_INT:    return _int;
+        case ATTRTYPE_BOOL:   return _bool? 1 : 0;
+        default: break;
     }
     return defaultValue;
 }
@@ -160,24 +295,21 @@ AttributeValue::getInt( long long defaultValue ) const
 bool
 AttributeValue::getBool( bool defaultValue ) const
 {
-    if (!value.set)
-    {
-        return defaultValue;
-    }
-
-    switch( type ) {
-        case ATTRTYPE_STRING: return Strings::as<bool>(value.stringValue, defaultValue);
-        case ATTRTYPE_DOUBLE: return value.doubleValue != 0.0;
-        case ATTRTYPE_INT:    return value.intValue != 0;
-        case ATTRTYPE_BOOL:   return value.boolValue;
-        case ATTRTYPE_UNSPECIFIED: break;
+    switch(_stored) {
+        case ATTRTYPE_STRING: return Strings::as<bool>(_string, defaultValue);
+        case ATTRTYPE_DOUBLE: return _double != 0.0;
+        case ATTRTYPE_INT:    return _int != 0;
+        case ATTRTYPE_BOOL:   return _bool;
+        default: break;
     }
     return defaultValue;
 }
 
-const std::vector<double>& AttributeValue::getDoubleArrayValue() const
+const std::vector<double>&
+AttributeValue::getDoubleArrayValue() const
 {
-    return value.doubleArrayValue;
+    static const std::vector<double> s_empty;
+    return _stored == ATTRTYPE_DOUBLEARRAY ? _doubleArray : s_empty;
 }
 
 //----------------------------------------------------------------------------
@@ -282,37 +414,25 @@ Feature::dirty()
 void
 Feature::set( const std::string& name, const std::string& value )
 {
-    AttributeValue& a = _attrs[name];
-    a.type = ATTRTYPE_STRING;
-    a.value.stringValue = value;
-    a.value.set = true;
+    _attrs[name].set(value);
 }
 
 void
 Feature::set( const std::string& name, double value )
 {
-    AttributeValue& a = _attrs[name];
-    a.type = ATTRTYPE_DOUBLE;
-    a.value.doubleValue = value;
-    a.value.set = true;
+    _attrs[name].set(value);
 }
 
 void
 Feature::set( const std::string& name, long long value )
 {
-    AttributeValue& a = _attrs[name];
-    a.type = ATTRTYPE_INT;
-    a.value.intValue = value;
-    a.value.set = true;
+    _attrs[name].set(value);
 }
 
 void
 Feature::set(const std::string& name, int value)
 {
-    AttributeValue& a = _attrs[name];
-    a.type = ATTRTYPE_INT;
-    a.value.intValue = value;
-    a.value.set = true;
+    _attrs[name].set((long long)value);
 }
 
 void
@@ -324,43 +444,33 @@ Feature::set( const std::string& name, const AttributeValue& value)
 void
 Feature::set( const std::string& name, bool value )
 {
-    AttributeValue& a = _attrs[name];
-    a.type = ATTRTYPE_BOOL;
-    a.value.boolValue = value;
-    a.value.set = true;
+    _attrs[name].set(value);
 }
 
 void
 Feature::set( const std::string& name, const std::vector<double>& value )
 {
-    AttributeValue& a = _attrs[name];
-    a.type = ATTRTYPE_DOUBLEARRAY;
-    a.value.doubleArrayValue = value;
-    a.value.set = true;
+    _attrs[name].set(value);
 }
 
 void
 Feature::setSwap( const std::string& name, std::vector<double>& value )
 {
-    AttributeValue& a = _attrs[name];
-    a.type = ATTRTYPE_DOUBLEARRAY;
-    a.value.doubleArrayValue.swap(value);
-    a.value.set = true;
+    _attrs[name].setSwap(value);
 }
 
 void
 Feature::setNull( const std::string& name)
 {
-    AttributeValue& a = _attrs[name];
-    a.value.set = false;
+    _attrs[name].setNull();
 }
 
 void
 Feature::setNull( const std::string& name, AttributeType type)
 {
     AttributeValue& a = _attrs[name];
+    a.setNull();
     a.type = type;
-    a.value.set = false;
 }
 
 void
@@ -414,7 +524,7 @@ bool
 Feature::isSet( const std::string& name) const
 {
     AttributeTable::const_iterator i = _attrs.find(toLower(name));
-    return i != _attrs.end()? i->second.value.set : false;
+    return i != _attrs.end()? i->second.isSet() : false;
 }
 
 double
@@ -689,7 +799,7 @@ Feature::getGeoJSON() const
         {
             if (itr->second.type == ATTRTYPE_INT)
             {
-                if (itr->second.value.set)
+                if (itr->second.isSet())
                 {
                     props[itr->first] = (double)itr->second.getInt();
                 }
@@ -700,7 +810,7 @@ Feature::getGeoJSON() const
             }
             else if (itr->second.type == ATTRTYPE_DOUBLE)
             {
-                if (itr->second.value.set)
+                if (itr->second.isSet())
                 {
                     props[itr->first] = itr->second.getDouble();
                 }
@@ -711,7 +821,7 @@ Feature::getGeoJSON() const
             }
             else if (itr->second.type == ATTRTYPE_BOOL)
             {
-                if (itr->second.value.set)
+                if (itr->second.isSet())
                 {
                     props[itr->first] = itr->second.getBool();
                 }
@@ -722,7 +832,7 @@ Feature::getGeoJSON() const
             }
             else
             {
-                if (itr->second.value.set)
+                if (itr->second.isSet())
                 {
                     props[itr->first] = itr->second.getString();
                 }
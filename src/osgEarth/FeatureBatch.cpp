@@ -0,0 +1,513 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/FeatureBatch>
+#include <osgEarth/StringUtils>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[FeatureBatch] "
+
+namespace
+{
+    // Creates one Feature per row, on demand
+    class FeatureBatchCursor : public FeatureCursor
+    {
+    public:
+        FeatureBatchCursor(const FeatureBatch* batch, ProgressCallback* progress) :
+            FeatureCursor(progress),
+            _batch(batch),
+            _next(0u) { }
+
+        bool hasMore() const override {
+            return _next < _batch->size();
+        }
+
+        Feature* nextFeature() override {
+            if (!hasMore())
+                return nullptr;
+            _current = _batch->getFeature(_next++);
+            return _current.get();
+        }
+
+    private:
+        osg::ref_ptr<const FeatureBatch> _batch;
+        unsigned _next;
+        osg::ref_ptr<Feature> _current;
+    };
+
+    inline void appendBit(std::vector<std::uint64_t>& bits, unsigned row, bool value)
+    {
+        if ((row & 63u) == 0u)
+            bits.push_back(0u);
+        if (value)
+            bits.back() |= (std::uint64_t)1u << (row & 63u);
+    }
+}
+
+//........................................................................
+
+void
+FeatureBatch::Column::append(const AttributeValue* value)
+{
+    if (value == nullptr)
+    {
+        store(nullptr, false);
+        return;
+    }
+
+    AttributeType valueType = value->type;
+
+    if (valueType != ATTRTYPE_UNSPECIFIED && valueType != type)
+    {
+        if (type == ATTRTYPE_UNSPECIFIED)
+        {
+            convert(valueType);
+        }
+        else if (value->isSet())
+        {
+            if (type == ATTRTYPE_DOUBLE && valueType == ATTRTYPE_INT)
+                ; // stored as a double
+            else if (type == ATTRTYPE_INT && valueType == ATTRTYPE_DOUBLE)
+                convert(ATTRTYPE_DOUBLE);
+            else if (type == ATTRTYPE_DOUBLEARRAY || valueType == ATTRTYPE_DOUBLEARRAY)
+                value = nullptr; // no sensible conversion; store as NULL
+            else
+                convert(ATTRTYPE_STRING);
+        }
+    }
+
+    store(value, true);
+}
+
+void
+FeatureBatch::Column::store(const AttributeValue* value, bool isPresent)
+{
+    bool isSet = value != nullptr && value->isSet();
+
+    switch (type)
+    {
+    case ATTRTYPE_DOUBLE:
+        doubles.push_back(isSet ? value->getDouble() : 0.0);
+        break;
+    case ATTRTYPE_INT:
+        ints.push_back(isSet ? value->getInt() : 0LL);
+        break;
+    case ATTRTYPE_BOOL:
+        bools.push_back(isSet && value->getBool() ? 1 : 0);
+        break;
+    case ATTRTYPE_STRING:
+        if (isSet)
+        {
+            auto result = stringIndex.emplace(value->getString(), (std::uint32_t)stringTable.size());
+            if (result.second)
+                stringTable.push_back(&result.first->first);
+            strings.push_back(result.first->second);
+        }
+        else
+        {
+            strings.push_back(0u);
+        }
+        break;
+    case ATTRTYPE_DOUBLEARRAY:
+        doubleArrays.emplace_back();
+        if (isSet)
+            doubleArrays.back() = value->getDoubleArrayValue();
+        break;
+    case ATTRTYPE_UNSPECIFIED:
+        // no values yet; only the bits matter
+        isSet = false;
+        break;
+    }
+
+    appendBit(present, rows, isPresent);
+    appendBit(set, rows, isSet);
+    ++rows;
+}
+
+void
+FeatureBatch::Column::convert(AttributeType newType)
+{
+    std::vector<AttributeValue> values(rows);
+    std::vector<char> wasPresent(rows);
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        wasPresent[row] = isPresent(row) ? 1 : 0;
+        get(row, values[row]);
+    }
+
+    doubles.clear();
+    ints.clear();
+    bools.clear();
+    strings.clear();
+    doubleArrays.clear();
+    stringIndex.clear();
+    stringTable.clear();
+    present.clear();
+    set.clear();
+
+    unsigned numRows = rows;
+    rows = 0u;
+    type = newType;
+
+    for (unsigned row = 0; row < numRows; ++row)
+    {
+        store(&values[row], wasPresent[row] != 0);
+    }
+}
+
+void
+FeatureBatch::Column::get(unsigned row, AttributeValue& output) const
+{
+    if (!isSet(row))
+    {
+        output.setNull();
+        output.type = type;
+        return;
+    }
+
+    switch (type)
+    {
+    case ATTRTYPE_DOUBLE: output.set(doubles[row]); break;
+    case ATTRTYPE_INT: output.set(ints[row]); break;
+    case ATTRTYPE_BOOL: output.set(bools[row] != 0); break;
+    case ATTRTYPE_STRING: output.set(*stringTable[strings[row]]); break;
+    case ATTRTYPE_DOUBLEARRAY: output.set(doubleArrays[row]); break;
+    case ATTRTYPE_UNSPECIFIED: output.setNull(); break;
+    }
+}
+
+std::size_t
+FeatureBatch::Column::getMemoryUsage() const
+{
+    std::size_t bytes =
+        sizeof(Column) +
+        name.capacity() +
+        (present.capacity() + set.capacity()) * sizeof(std::uint64_t) +
+        doubles.capacity() * sizeof(double) +
+        ints.capacity() * sizeof(long long) +
+        bools.capacity() +
+        strings.capacity() * sizeof(std::uint32_t) +
+        doubleArrays.capacity() * sizeof(std::vector<double>) +
+        stringTable.capacity() * sizeof(const std::string*) +
+        stringIndex.bucket_count() * sizeof(void*);
+
+    for (auto& array : doubleArrays)
+        bytes += array.capacity() * sizeof(double);
+
+    // a hash node is roughly a next pointer, the key, the value and the hash
+    for (auto& entry : stringIndex)
+        bytes += sizeof(void*) + sizeof(std::string) + sizeof(std::uint32_t) + sizeof(std::size_t) +
+            (entry.first.capacity() > 15u ? entry.first.capacity() : 0u);
+
+    return bytes;
+}
+
+//........................................................................
+
+FeatureBatch::FeatureBatch(const SpatialReference* srs) :
+    _srs(srs)
+{
+    //nop
+}
+
+FeatureBatch::FeatureBatch(const FeatureList& features)
+{
+    _fids.reserve(features.size());
+    _geoms.reserve(features.size());
+
+    for (auto& feature : features)
+    {
+        if (feature.valid() && !add(feature.get()))
+        {
+            OE_WARN << LC << "Skipped feature " << feature->getFID() << " with a different SRS" << std::endl;
+        }
+    }
+}
+
+bool
+FeatureBatch::add(const Feature* feature)
+{
+    OE_SOFT_ASSERT_AND_RETURN(feature != nullptr, false);
+
+    if (!_srs.valid())
+    {
+        _srs = feature->getSRS();
+    }
+    else if (feature->getSRS() && !feature->getSRS()->isEquivalentTo(_srs.get()))
+    {
+        return false;
+    }
+
+    unsigned row = size();
+    std::vector<char> filled(_columns.size(), 0);
+
+    for (auto& attr : feature->getAttrs())
+    {
+        std::string key = toLower(attr.first);
+
+        unsigned index;
+        auto i = _columnIndex.find(key);
+        if (i != _columnIndex.end())
+        {
+            index = i->second;
+        }
+        else
+        {
+            // new column: NULL for every earlier row
+            index = (unsigned)_columns.size();
+            _columnIndex[key] = index;
+            _columns.emplace_back(new Column());
+            _columns.back()->name = attr.first;
+            for (unsigned r = 0; r < row; ++r)
+                _columns.back()->append(nullptr);
+            filled.push_back(0);
+        }
+
+        if (filled[index] == 0)
+        {
+            _columns[index]->append(&attr.second);
+            filled[index] = 1;
+        }
+    }
+
+    for (unsigned c = 0; c < _columns.size(); ++c)
+    {
+        if (filled[c] == 0)
+            _columns[c]->append(nullptr);
+    }
+
+    _fids.push_back(feature->getFID());
+    _geoms.emplace_back(feature->getGeometry() ? feature->getGeometry()->clone() : nullptr);
+
+    if (feature->style().isSet())
+        _styles[row] = feature->style().get();
+
+    if (feature->geoInterp().isSet())
+        _geoInterps[row] = feature->geoInterp().get();
+
+    return true;
+}
+
+void
+FeatureBatch::clear()
+{
+    _columns.clear();
+    _columnIndex.clear();
+    _fids.clear();
+    _geoms.clear();
+    _styles.clear();
+    _geoInterps.clear();
+}
+
+const std::string&
+FeatureBatch::getColumnName(unsigned column) const
+{
+    return _columns[column]->name;
+}
+
+AttributeType
+FeatureBatch::getColumnType(unsigned column) const
+{
+    return _columns[column]->type;
+}
+
+int
+FeatureBatch::getColumnIndex(const std::string& name) const
+{
+    auto i = _columnIndex.find(toLower(name));
+    return i != _columnIndex.end() ? (int)i->second : -1;
+}
+
+FeatureSchema
+FeatureBatch::getSchema() const
+{
+    FeatureSchema schema;
+    for (auto& column : _columns)
+        schema[column->name] = column->type;
+    return schema;
+}
+
+bool
+FeatureBatch::isSet(unsigned row, unsigned column) const
+{
+    return _columns[column]->isSet(row);
+}
+
+std::string
+FeatureBatch::getString(unsigned row, unsigned column) const
+{
+    const Column& c = *_columns[column];
+    if (!c.isSet(row))
+        return EMPTY_STRING;
+
+    switch (c.type)
+    {
+    case ATTRTYPE_STRING: return *c.stringTable[c.strings[row]];
+    case ATTRTYPE_DOUBLE: return osgEarth::toString(c.doubles[row]);
+    case ATTRTYPE_INT:    return osgEarth::toString(c.ints[row]);
+    case ATTRTYPE_BOOL:   return osgEarth::toString(c.bools[row] != 0);
+    default: break;
+    }
+    return EMPTY_STRING;
+}
+
+double
+FeatureBatch::getDouble(unsigned row, unsigned column, double defaultValue) const
+{
+    const Column& c = *_columns[column];
+    if (!c.isSet(row))
+        return defaultValue;
+
+    switch (c.type)
+    {
+    case ATTRTYPE_DOUBLE: return c.doubles[row];
+    case ATTRTYPE_INT:    return (double)c.ints[row];
+    case ATTRTYPE_BOOL:   return c.bools[row] != 0 ? 1.0 : 0.0;
+    case ATTRTYPE_STRING: return Strings::as<double>(*c.stringTable[c.strings[row]], defaultValue);
+    default: break;
+    }
+    return defaultValue;
+}
+
+long long
+FeatureBatch::getInt(unsigned row, unsigned column, long long defaultValue) const
+{
+    const Column& c = *_columns[column];
+    if (!c.isSet(row))
+        return defaultValue;
+
+    switch (c.type)
+    {
+    case ATTRTYPE_DOUBLE: return (long long)c.doubles[row];
+    case ATTRTYPE_INT:    return c.ints[row];
+    case ATTRTYPE_BOOL:   return c.bools[row] != 0 ? 1 : 0;
+    case ATTRTYPE_STRING: return Strings::as<int>(*c.stringTable[c.strings[row]], defaultValue);
+    default: break;
+    }
+    return defaultValue;
+}
+
+bool
+FeatureBatch::getBool(unsigned row, unsigned column, bool defaultValue) const
+{
+    const Column& c = *_columns[column];
+    if (!c.isSet(row))
+        return defaultValue;
+
+    switch (c.type)
+    {
+    case ATTRTYPE_DOUBLE: return c.doubles[row] != 0.0;
+    case ATTRTYPE_INT:    return c.ints[row] != 0;
+    case ATTRTYPE_BOOL:   return c.bools[row] != 0;
+    case ATTRTYPE_STRING: return Strings::as<bool>(*c.stringTable[c.strings[row]], defaultValue);
+    default: break;
+    }
+    return defaultValue;
+}
+
+const std::vector<double>*
+FeatureBatch::getDoubleArray(unsigned row, unsigned column) const
+{
+    const Column& c = *_columns[column];
+    return c.type == ATTRTYPE_DOUBLEARRAY && c.isSet(row) ? &c.doubleArrays[row] : nullptr;
+}
+
+double
+FeatureBatch::eval(NumericExpression& expr, unsigned row) const
+{
+    for (auto& var : expr.variables())
+    {
+        int column = getColumnIndex(var.first);
+        expr.set(var, column >= 0 ? getDouble(row, column, 0.0) : 0.0);
+    }
+    return expr.eval();
+}
+
+const std::string&
+FeatureBatch::eval(StringExpression& expr, unsigned row) const
+{
+    for (auto& var : expr.variables())
+    {
+        int column = getColumnIndex(var.first);
+        expr.set(var, column >= 0 ? getString(row, column) : EMPTY_STRING);
+    }
+    return expr.eval();
+}
+
+osg::ref_ptr<Feature>
+FeatureBatch::getFeature(unsigned row) const
+{
+    const Geometry* geom = _geoms[row].get();
+    osg::ref_ptr<Feature> feature = new Feature(
+        geom ? geom->clone() : nullptr,
+        _srs.get(),
+        Style(),
+        _fids[row]);
+
+    AttributeValue value;
+    for (auto& column : _columns)
+    {
+        if (column->isPresent(row))
+        {
+            column->get(row, value);
+            feature->set(column->name, value);
+        }
+    }
+
+    auto style = _styles.find(row);
+    if (style != _styles.end())
+        feature->style() = style->second;
+
+    auto geoInterp = _geoInterps.find(row);
+    if (geoInterp != _geoInterps.end())
+        feature->geoInterp() = geoInterp->second;
+
+    return feature;
+}
+
+void
+FeatureBatch::toFeatureList(FeatureList& output) const
+{
+    output.reserve(output.size() + size());
+    for (unsigned row = 0; row < size(); ++row)
+        output.emplace_back(getFeature(row));
+}
+
+FeatureCursor*
+FeatureBatch::createCursor(ProgressCallback* progress) const
+{
+    return new FeatureBatchCursor(this, progress);
+}
+
+std::size_t
+FeatureBatch::getMemoryUsage() const
+{
+    std::size_t bytes =
+        sizeof(FeatureBatch) +
+        _fids.capacity() * sizeof(FeatureID) +
+        _geoms.capacity() * sizeof(osg::ref_ptr<Geometry>) +
+        _styles.size() * (sizeof(Style) + 2u * sizeof(void*)) +
+        _geoInterps.size() * (sizeof(GeoInterpolation) + 2u * sizeof(void*));
+
+    for (auto& column : _columns)
+        bytes += column->getMemoryUsage();
+
+    return bytes;
+}
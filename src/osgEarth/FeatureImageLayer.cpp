@@ -43,6 +43,7 @@ FeatureImageLayer::Options::getConfig() const
     conf.set("gamma", gamma());
     conf.set("sdf", sdf());
     conf.set("sdf_invert", sdf_invert());
+    conf.set("render_threads", renderThreads());
 
     if (filters().empty() == false)
     {
@@ -61,12 +62,14 @@ FeatureImageLayer::Options::fromConfig(const Config& conf)
     gamma().setDefault(1.3);
     sdf().setDefault(false);
     sdf_invert().setDefault(false);
+    renderThreads().setDefault(1u);
 
     featureSource().get(conf, "features");
     styleSheet().get(conf, "styles");
     conf.get("gamma", gamma());
     conf.get("sdf", sdf());
     conf.get("sdf_invert", sdf_invert());
+    conf.get("render_threads", renderThreads());
 
     const Config& filtersConf = conf.child("filters");
     for (ConfigSet::const_iterator i = filtersConf.children().begin(); i != filtersConf.children().end(); ++i)
@@ -307,6 +310,8 @@ FeatureImageLayer::createImageImplementation(const TileKey& key, ProgressCallbac
             key.getExtent());
     }
 
+    rasterizer->setNumThreads(options().renderThreads().get());
+
     FeatureStyleSorter::Function renderer = [&](
         const Style& style,
         FeatureList& features,
@@ -22,6 +22,7 @@
 
 #include <osgEarth/FeatureSource>
 #include <osgEarth/StyleSheet>
+#include <osgEarth/Threading>
 #include <osgText/String>
 #include <osgEarth/BuildConfig>
 
@@ -50,6 +51,15 @@ namespace osgEarth {
             double xf, yf;
         };
 
+        // A cropped geometry ready to rasterize with AGG, and the rows it covers
+        struct Shape
+        {
+            osg::ref_ptr<Geometry> geometry;
+            osg::Vec4f color;
+            float value;
+            int rowMin, rowMax;
+        };
+
         struct float32
         {
             float32() : value(NO_DATA_VALUE) { }
@@ -102,7 +112,8 @@ namespace osgEarth {
             const osg::Vec4& color,
             RenderFrame& frame,
             agg::rasterizer& ras,
-            agg::rendering_buffer& buffer)
+            agg::rendering_buffer& buffer,
+            int dy = 0)
         {
             unsigned a = (unsigned)(127.0f + (color.a()*255.0f) / 2.0f); // scale alpha up
 
@@ -130,7 +141,7 @@ namespace osgEarth {
                 }
             }
             agg::renderer<agg::span_abgr32, agg::rgba8> ren(buffer);
-            ras.render(ren, fgColor);
+            ras.render(ren, fgColor, 0, dy);
 
             ras.reset();
         }
@@ -141,7 +152,8 @@ namespace osgEarth {
             float value,
             RenderFrame& frame,
             agg::rasterizer& ras,
-            agg::rendering_buffer& buffer)
+            agg::rendering_buffer& buffer,
+            int dy = 0)
         {
             ConstGeometryIterator gi(geometry);
             while (gi.hasMore())
@@ -162,7 +174,7 @@ namespace osgEarth {
             }
 
             agg::renderer<span_coverage32, float32> ren(buffer);
-            ras.render(ren, value);
+            ras.render(ren, value, 0, dy);
             ras.reset();
         }
 
@@ -697,6 +709,16 @@ void FeatureRasterizer::setPixelScale(float pixelScale)
     _pixelScale = pixelScale;
 }
 
+unsigned FeatureRasterizer::getNumThreads() const
+{
+    return _numThreads;
+}
+
+void FeatureRasterizer::setNumThreads(unsigned numThreads)
+{
+    _numThreads = osg::maximum(numThreads, 1u);
+}
+
 void
 FeatureRasterizer::render_blend2d(
     const FeatureList& features,
@@ -730,7 +752,13 @@ FeatureRasterizer::render_blend2d(
     BLImage buf;
     buf.createFromData(_image->s(), _image->t(), BL_FORMAT_PRGB32, _image->data(), _image->s() * 4);
 
-    BLContext ctx(buf);
+    // Blend2D's multi-threaded context queues the commands and renders them
+    // on worker threads, in order, when the context ends.
+    BLContextCreateInfo createInfo {};
+    if (_numThreads > 1u)
+        createInfo.threadCount = _numThreads;
+
+    BLContext ctx(buf, createInfo);
     ctx.setCompOp(BL_COMP_OP_SRC_OVER);
 
     // render polygons:
@@ -1077,16 +1105,6 @@ FeatureRasterizer::render_agglite(
     for (auto& line : lines)
         line->transform(_extent.getSRS());
 
-    // set up the AGG renderer:
-    agg::rendering_buffer rbuf(
-        _image->data(),
-        _image->s(), _image->t(),
-        _image->s() * 4);
-
-    // Create the renderer and the rasterizer
-    agg::rasterizer ras;
-    ras.filling_rule(agg::fill_even_odd);
-
     // construct an extent for cropping the geometry to our tile.
     // extend just outside the actual extents so we don't get edge artifacts:
     GeoExtent cropExtent = GeoExtent(_extent);
@@ -1125,54 +1143,80 @@ FeatureRasterizer::render_agglite(
         covValue = covSymbol->valueExpression().get();
     }
 
-    // render the polygons
-    for (auto& feature : polygons)
-    {
-        Geometry* geometry = feature->getGeometry();
+    // crop the geometry and resolve each shape's color or coverage value:
+    std::vector<Shape> shapes;
+    shapes.reserve(polygons.size() + lines.size());
 
-        osg::ref_ptr<Geometry> croppedGeometry;
-        if (geometry->crop(cropPoly.get(), croppedGeometry))
+    auto addShape = [&](Feature* feature, const osg::Vec4f& color)
+    {
+        Shape shape;
+        if (feature->getGeometry()->crop(cropPoly.get(), shape.geometry))
         {
-            if (covValue.isSet())
-            {
-                float value = feature->eval(covValue.mutable_value(), &context);
-                rasterizeCoverage_agglite(croppedGeometry.get(), value, frame, ras, rbuf);
-            }
-            else
-            {
-                const PolygonSymbol* poly =
-                    feature->style().isSet() && feature->style()->has<PolygonSymbol>() ? feature->style()->get<PolygonSymbol>() :
-                    globalPolySymbol;
+            shape.color = color;
+            shape.value = covValue.isSet() ? (float)feature->eval(covValue.mutable_value(), &context) : 0.0f;
 
-                Color color = poly ? poly->fill()->color() : Color::White;
-                rasterize_agglite(croppedGeometry.get(), color, frame, ras, rbuf);
-            }
+            // rows the shape touches, with a pixel to spare for antialiasing
+            const Bounds bounds = shape.geometry->getBounds();
+            shape.rowMin = (int)floor(frame.yf*(bounds.yMin() - frame.ymin)) - 1;
+            shape.rowMax = (int)ceil(frame.yf*(bounds.yMax() - frame.ymin)) + 1;
+
+            shapes.emplace_back(std::move(shape));
         }
+    };
+
+    for (auto& feature : polygons)
+    {
+        const PolygonSymbol* poly =
+            feature->style().isSet() && feature->style()->has<PolygonSymbol>() ? feature->style()->get<PolygonSymbol>() :
+            globalPolySymbol;
+
+        addShape(feature.get(), poly ? poly->fill()->color() : Color::White);
     }
 
     for (auto& feature : lines)
     {
-        Geometry* geometry = feature->getGeometry();
+        const LineSymbol* line =
+            feature->style().isSet() && feature->style()->has<LineSymbol>() ? feature->style()->get<LineSymbol>() :
+            globalLineSymbol;
+
+        addShape(feature.get(), line ? static_cast<osg::Vec4>(line->stroke()->color()) : osg::Vec4(1, 1, 1, 1));
+    }
+
+    // Render the shapes in order into bands of rows. Each band has its own
+    // rasterizer and skips the shapes that miss it, so the bands can render
+    // in parallel and still match a single-threaded render.
+    const int height = _image->t();
+    const unsigned bands = osg::clampBetween((unsigned)height / 64u, 1u, _numThreads);
+
+    auto renderBand = [&](unsigned band)
+    {
+        int rowBegin = (int)((unsigned)height * band / bands);
+        int rowEnd = (int)((unsigned)height * (band + 1) / bands);
+
+        agg::rendering_buffer rbuf(
+            _image->data() + rowBegin * _image->s() * 4,
+            _image->s(), rowEnd - rowBegin,
+            _image->s() * 4);
 
-        osg::ref_ptr<Geometry> croppedGeometry;
-        if (geometry->crop(cropPoly.get(), croppedGeometry))
+        agg::rasterizer ras;
+        ras.filling_rule(agg::fill_even_odd);
+
+        for (auto& shape : shapes)
         {
+            if (shape.rowMax < rowBegin || shape.rowMin >= rowEnd)
+                continue;
+
             if (covValue.isSet())
-            {
-                float value = feature->eval(covValue.mutable_value(), &context);
-                rasterizeCoverage_agglite(croppedGeometry.get(), value, frame, ras, rbuf);
-            }
+                rasterizeCoverage_agglite(shape.geometry.get(), shape.value, frame, ras, rbuf, -rowBegin);
             else
-            {
-                const LineSymbol* line =
-                    feature->style().isSet() && feature->style()->has<LineSymbol>() ? feature->style()->get<LineSymbol>() :
-                    globalLineSymbol;
-
-                osg::Vec4f color = line ? static_cast<osg::Vec4>(line->stroke()->color()) : osg::Vec4(1, 1, 1, 1);
-                rasterize_agglite(croppedGeometry.get(), color, frame, ras, rbuf);
-            }
+                rasterize_agglite(shape.geometry.get(), shape.color, frame, ras, rbuf, -rowBegin);
         }
-    }
+    };
+
+    if (bands > 1u)
+        Threading::parallelFor(bands, jobs::get_pool("oe.rasterizer"), renderBand);
+    else
+        renderBand(0u);
 
 #if 0
     if (!lines.empty())
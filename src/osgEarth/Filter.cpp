@@ -23,6 +23,7 @@
 #include <osgEarth/ECEF>
 #include <osgEarth/Registry>
 #include <osgEarth/GLUtils>
+#include <osgEarth/Threading>
 #include <osgEarth/VirtualProgram>
 #include <osg/MatrixTransform>
 #include <osgDB/ReadFile>
@@ -75,6 +76,60 @@ FeatureFilterChain::create(const std::vector<ConfigOptions>& filters, const osgD
     return std::move(chain);
 }
 
+FilterContext
+FeatureFilterChain::push(FeatureList& input, FilterContext& context) const
+{
+    FilterContext temp = context;
+
+    for (unsigned i = 0; i < size(); )
+    {
+        // find the run of feature-independent filters starting here
+        unsigned end = i;
+        while (end < size() && (*this)[end]->isFeatureIndependent())
+            ++end;
+
+        unsigned partitions = _partitionSize > 0u ? (unsigned)input.size() / _partitionSize : 0u;
+
+        if (end == i || partitions < 2u)
+        {
+            temp = (*this)[i]->push(input, temp);
+            ++i;
+            continue;
+        }
+
+        jobs::jobpool* pool = jobs::get_pool("oe.featurefilter");
+        partitions = std::min(partitions, pool->concurrency() + 1u);
+
+        // split the list into contiguous partitions, each with its own context
+        std::vector<FeatureList> parts(partitions);
+        std::vector<FilterContext> contexts(partitions, temp);
+        std::size_t chunk = (input.size() + partitions - 1) / partitions;
+        for (std::size_t f = 0; f < input.size(); ++f)
+        {
+            FeatureList& part = parts[f / chunk];
+            if (part.empty())
+                part.reserve(chunk);
+            part.emplace_back(std::move(input[f]));
+        }
+
+        Threading::parallelFor(partitions, pool, [&](unsigned p)
+            {
+                for (unsigned f = i; f < end; ++f)
+                    contexts[p] = (*this)[f]->push(parts[p], contexts[p]);
+            });
+
+        // merge back in the original order
+        input.clear();
+        for (auto& part : parts)
+            input.insert(input.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+
+        temp = contexts.front();
+        i = end;
+    }
+
+    return temp;
+}
+
 /********************************************************************************/
         
 #undef  LC
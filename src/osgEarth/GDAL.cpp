@@ -35,6 +35,7 @@
 #include <osgDB/WriteFile>
 #include <osgDB/ImageOptions>
 
+#include <cfloat>
 #include <sstream>
 #include <thread>
 #include <stdlib.h>
@@ -926,8 +927,9 @@ GDAL::Driver::isValidValue(float v, GDALRasterBand* band)
     return true;
 }
 
+template<typename FETCH>
 float
-GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, bool applyOffset)
+GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, FETCH&& fetch, bool applyOffset)
 {
     double r, c;
     geoToPixel(x, y, c, r);
@@ -968,7 +970,7 @@ GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, boo
 
     if (gdalOptions().interpolation() == INTERP_NEAREST)
     {
-        rasterIO(band, GF_Read, osg::round(c), osg::round(r), 1, 1, &result, 1, 1, GDT_Float32, 0, 0);
+        fetch((int)osg::round(c), (int)osg::round(r), result);
         if (!isValidValue(result, band))
         {
             return NO_DATA_VALUE;
@@ -986,10 +988,10 @@ GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, boo
 
         float urHeight, llHeight, ulHeight, lrHeight;
 
-        rasterIO(band, GF_Read, colMin, rowMin, 1, 1, &llHeight, 1, 1, GDT_Float32, 0, 0);
-        rasterIO(band, GF_Read, colMin, rowMax, 1, 1, &ulHeight, 1, 1, GDT_Float32, 0, 0);
-        rasterIO(band, GF_Read, colMax, rowMin, 1, 1, &lrHeight, 1, 1, GDT_Float32, 0, 0);
-        rasterIO(band, GF_Read, colMax, rowMax, 1, 1, &urHeight, 1, 1, GDT_Float32, 0, 0);
+        fetch(colMin, rowMin, llHeight);
+        fetch(colMin, rowMax, ulHeight);
+        fetch(colMax, rowMin, lrHeight);
+        fetch(colMax, rowMax, urHeight);
 
         if ((!isValidValue(urHeight, band)) || (!isValidValue(llHeight, band)) || (!isValidValue(ulHeight, band)) || (!isValidValue(lrHeight, band)))
         {
@@ -1536,6 +1538,47 @@ GDAL::Driver::createHeightField(const TileKey& key,
         }
         else
         {
+            // Find the source pixels under the tile: the pixel extent of its
+            // corners, shifted by the half-pixel sample offset, plus one pixel
+            // on each side for the interpolation neighbors.
+            double pxMin = DBL_MAX, pxMax = -DBL_MAX, pyMin = DBL_MAX, pyMax = -DBL_MAX;
+            const double corners[4][2] = { { xmin, ymin }, { xmax, ymin }, { xmin, ymax }, { xmax, ymax } };
+            for (auto& corner : corners)
+            {
+                double px, py;
+                geoToPixel(corner[0], corner[1], px, py);
+                pxMin = osg::minimum(pxMin, px); pxMax = osg::maximum(pxMax, px);
+                pyMin = osg::minimum(pyMin, py); pyMax = osg::maximum(pyMax, py);
+            }
+
+            int winColMin = osg::maximum((int)floor(pxMin - 0.5) - 1, 0);
+            int winColMax = osg::minimum((int)ceil(pxMax - 0.5) + 1, _warpedDS->GetRasterXSize() - 1);
+            int winRowMin = osg::maximum((int)floor(pyMin - 0.5) - 1, 0);
+            int winRowMax = osg::minimum((int)ceil(pyMax - 0.5) + 1, _warpedDS->GetRasterYSize() - 1);
+            int winCols = winColMax - winColMin + 1;
+            int winRows = winRowMax - winRowMin + 1;
+
+            // Read the window with one RasterIO and sample it in memory, unless
+            // the source is so much denser than the tile that reading single
+            // pixels touches less data.
+            bool windowed =
+                winCols > 0 && winRows > 0 &&
+                (double)winCols * (double)winRows <= 16.0 * (double)tileSize * (double)tileSize;
+
+            if (windowed)
+            {
+                _window.resize(winCols * winRows);
+                windowed = rasterIO(band, GF_Read, winColMin, winRowMin, winCols, winRows, _window.data(), winCols, winRows, GDT_Float32, 0, 0);
+            }
+
+            auto fetch = [&](int col, int row, float& value)
+            {
+                if (windowed && col >= winColMin && col <= winColMax && row >= winRowMin && row <= winRowMax)
+                    value = _window[(row - winRowMin) * winCols + (col - winColMin)];
+                else
+                    rasterIO(band, GF_Read, col, row, 1, 1, &value, 1, 1, GDT_Float32, 0, 0);
+            };
+
             double dx = (xmax - xmin) / (tileSize - 1);
             double dy = (ymax - ymin) / (tileSize - 1);
             for (unsigned r = 0; r < tileSize; ++r)
@@ -1544,7 +1587,7 @@ GDAL::Driver::createHeightField(const TileKey& key,
                 for (unsigned c = 0; c < tileSize; ++c)
                 {
                     double geoX = xmin + (dx * (double)c);
-                    float h = getInterpolatedValue(band, geoX, geoY) * _linearUnits;
+                    float h = getInterpolatedValue(band, geoX, geoY, fetch) * _linearUnits;
                     hf->setHeight(c, r, h);
                 }
             }
@@ -2289,20 +2332,14 @@ osg::Image* osgEarth::GDAL::reprojectImage(
 
     GDALDataset* destDS = createMemDS(width, height, numBands, dataType, destMinX, destMinY, destMaxX, destMaxY, destWKT);
 
-    if (useBilinearInterpolation == true)
-    {
-        GDALReprojectImage(srcDS, NULL,
-            destDS, NULL,
-            GRA_Bilinear,
-            0, 0, 0, 0, 0);
-    }
-    else
-    {
-        GDALReprojectImage(srcDS, NULL,
-            destDS, NULL,
-            GRA_NearestNeighbour,
-            0, 0, 0, 0, 0);
-    }
+    // Let GDAL interpolate the transform between sparse control points
+    // (within 1/8 pixel, as gdalwarp does by default) rather than transforming
+    // every pixel. Callers already reproject tiles on many threads, so the
+    // warp stays single-threaded unless the user sets GDAL_NUM_THREADS.
+    GDALReprojectImage(srcDS, NULL,
+        destDS, NULL,
+        useBilinearInterpolation ? GRA_Bilinear : GRA_NearestNeighbour,
+        0, 0.125, 0, 0, NULL);
 
     osg::Image* result = createImageFromDataset(destDS);
 
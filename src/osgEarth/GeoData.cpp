@@ -29,6 +29,7 @@
 #include <osg/BoundingBox>
 #include <osg/Polytope>
 #include <osg/Camera>
+#include <limits>
 
 using namespace osgEarth;
 
@@ -1998,6 +1999,189 @@ GeoImage::crop( const GeoExtent& extent, bool exact, unsigned int width, unsigne
 
 namespace
 {
+    // Rows in each band of a parallel reprojection
+    const unsigned REPROJECT_BAND_ROWS = 16u;
+
+    // Pixel spacing of the first control point grid
+    const unsigned REPROJECT_CONTROL_STEP = 16u;
+
+    // Largest error, in source pixels, allowed when interpolating
+    // source coordinates between control points
+    const double REPROJECT_MAX_ERROR = 0.125;
+
+    // Transforms the points of one band exactly. If the batch fails, the
+    // points are transformed one at a time, and those that fail are NaN.
+    void transformBand(
+        const SpatialReference* from,
+        const SpatialReference* to,
+        double* x, double* y, unsigned count)
+    {
+        std::vector<double> x0(x, x + count), y0(y, y + count), z(count, 0.0);
+
+        if (from->transformArrays(x, y, z.data(), count, to))
+            return;
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            osg::Vec3d out;
+            if (from->transform(osg::Vec3d(x0[i], y0[i], 0.0), to, out))
+            {
+                x[i] = out.x();
+                y[i] = out.y();
+            }
+            else
+            {
+                x[i] = y[i] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    }
+
+    // Computes the source-SRS coordinates of every destination pixel center,
+    // row-major. A sparse grid of control points is transformed exactly and
+    // the coordinates in between are interpolated bilinearly. The interpolated
+    // center of each grid cell is checked against an exact transform; the grid
+    // is refined until the error is within REPROJECT_MAX_ERROR source pixels,
+    // and failing that every pixel is transformed.
+    void computeSourceCoords(
+        const GeoExtent&     src_extent,
+        const GeoExtent&     dest_extent,
+        unsigned             width,
+        unsigned             height,
+        double               xfac,
+        double               yfac,
+        std::vector<double>& srcX,
+        std::vector<double>& srcY,
+        jobs::jobpool*       pool)
+    {
+        const SpatialReference* srcSRS = src_extent.getSRS();
+        const SpatialReference* destSRS = dest_extent.getSRS();
+
+        // offset the sample points by 1/2 a pixel so we are sampling "pixel center".
+        // (This is especially useful in the UnifiedCubeProfile since it nullifes the chances for
+        // edge ambiguity.)
+        const double dx = dest_extent.width() / (double)width;
+        const double dy = dest_extent.height() / (double)height;
+        const double x0 = dest_extent.xMin() + 0.5 * dx;
+        const double y0 = dest_extent.yMin() + 0.5 * dy;
+
+        const unsigned bands = (height + REPROJECT_BAND_ROWS - 1) / REPROJECT_BAND_ROWS;
+
+        srcX.resize(width * height);
+        srcY.resize(width * height);
+
+        for (unsigned step = REPROJECT_CONTROL_STEP; step > 1u && width > 1u && height > 1u; step /= 2u)
+        {
+            // control points every "step" pixels, plus the last column and row
+            std::vector<unsigned> cols, rows;
+            for (unsigned c = 0; c < width - 1; c += step)
+                cols.push_back(c);
+            cols.push_back(width - 1);
+            for (unsigned r = 0; r < height - 1; r += step)
+                rows.push_back(r);
+            rows.push_back(height - 1);
+
+            const unsigned nc = cols.size();
+            const unsigned nr = rows.size();
+            const unsigned numControl = nc * nr;
+
+            // the control points, followed by the center of each cell
+            std::vector<double> x, y;
+            x.reserve(numControl + (nc - 1) * (nr - 1));
+            y.reserve(x.capacity());
+
+            for (unsigned j = 0; j < nr; ++j)
+            {
+                for (unsigned i = 0; i < nc; ++i)
+                {
+                    x.push_back(x0 + (double)cols[i] * dx);
+                    y.push_back(y0 + (double)rows[j] * dy);
+                }
+            }
+
+            for (unsigned j = 0; j + 1 < nr; ++j)
+            {
+                for (unsigned i = 0; i + 1 < nc; ++i)
+                {
+                    x.push_back(x0 + 0.5 * (double)(cols[i] + cols[i + 1]) * dx);
+                    y.push_back(y0 + 0.5 * (double)(rows[j] + rows[j + 1]) * dy);
+                }
+            }
+
+            std::vector<double> z(x.size(), 0.0);
+            if (!destSRS->transformArrays(x.data(), y.data(), z.data(), x.size(), srcSRS))
+                break;
+
+            // a cell center interpolates to the average of its corners
+            // (written so that NaNs fail the test)
+            bool accurate = true;
+            for (unsigned j = 0, k = numControl; accurate && j + 1 < nr; ++j)
+            {
+                for (unsigned i = 0; accurate && i + 1 < nc; ++i, ++k)
+                {
+                    unsigned a = j * nc + i;
+                    double ix = 0.25 * (x[a] + x[a + 1] + x[a + nc] + x[a + nc + 1]);
+                    double iy = 0.25 * (y[a] + y[a + 1] + y[a + nc] + y[a + nc + 1]);
+                    accurate =
+                        fabs(ix - x[k]) * xfac <= REPROJECT_MAX_ERROR &&
+                        fabs(iy - y[k]) * yfac <= REPROJECT_MAX_ERROR;
+                }
+            }
+
+            if (!accurate)
+                continue;
+
+            // cell and weight of each column
+            std::vector<unsigned> colCell(width);
+            std::vector<double> colWeight(width);
+            for (unsigned c = 0; c < width; ++c)
+            {
+                unsigned i = osg::minimum(c / step, nc - 2);
+                colCell[c] = i;
+                colWeight[c] = (double)(c - cols[i]) / (double)(cols[i + 1] - cols[i]);
+            }
+
+            Threading::parallelFor(bands, pool, [&](unsigned band)
+                {
+                    unsigned rEnd = osg::minimum((band + 1) * REPROJECT_BAND_ROWS, height);
+                    for (unsigned r = band * REPROJECT_BAND_ROWS; r < rEnd; ++r)
+                    {
+                        unsigned j = osg::minimum(r / step, nr - 2);
+                        double v = (double)(r - rows[j]) / (double)(rows[j + 1] - rows[j]);
+
+                        for (unsigned c = 0; c < width; ++c)
+                        {
+                            unsigned a = j * nc + colCell[c];
+                            double u = colWeight[c];
+                            double bx = x[a] + (x[a + 1] - x[a]) * u;
+                            double by = y[a] + (y[a + 1] - y[a]) * u;
+                            double tx = x[a + nc] + (x[a + nc + 1] - x[a + nc]) * u;
+                            double ty = y[a + nc] + (y[a + nc + 1] - y[a + nc]) * u;
+                            srcX[r * width + c] = bx + (tx - bx) * v;
+                            srcY[r * width + c] = by + (ty - by) * v;
+                        }
+                    }
+                });
+
+            return;
+        }
+
+        // transform every pixel center
+        Threading::parallelFor(bands, pool, [&](unsigned band)
+            {
+                unsigned rBegin = band * REPROJECT_BAND_ROWS;
+                unsigned rEnd = osg::minimum(rBegin + REPROJECT_BAND_ROWS, height);
+                for (unsigned r = rBegin; r < rEnd; ++r)
+                {
+                    for (unsigned c = 0; c < width; ++c)
+                    {
+                        srcX[r * width + c] = x0 + (double)c * dx;
+                        srcY[r * width + c] = y0 + (double)r * dy;
+                    }
+                }
+                transformBand(destSRS, srcSRS, &srcX[rBegin * width], &srcY[rBegin * width], (rEnd - rBegin) * width);
+            });
+    }
+
     osg::Image* manualReproject(
         const osg::Image* image, 
         const GeoExtent&  src_extent, 
@@ -2025,138 +2209,133 @@ namespace
 
         //ImageUtils::PixelReader ra(result);
         ImageUtils::PixelWriter writer(result);
-        const double dx = dest_extent.width() / (double)width;
-        const double dy = dest_extent.height() / (double)height;
 
-        // offset the sample points by 1/2 a pixel so we are sampling "pixel center".
-        // (This is especially useful in the UnifiedCubeProfile since it nullifes the chances for
-        // edge ambiguity.)
-
-        unsigned int numPixels = width * height;
+        const int src_s = image->s();
+        const int src_t = image->t();
+        const double xfac = (src_s - 1) / src_extent.width();
+        const double yfac = (src_t - 1) / src_extent.height();
 
-        // Start by creating a sample grid over the destination
-        // extent. These will be the source coordinates. Then, reproject
-        // the sample grid into the source coordinate system.
-        double *srcPointsX = new double[numPixels * 2];
-        double *srcPointsY = srcPointsX + numPixels;
+        jobs::jobpool* pool = jobs::get_pool("oe.reproject");
 
-        dest_extent.getSRS()->transformGrid(
-            src_extent.getSRS(),
-            dest_extent.xMin() + .5 * dx, dest_extent.yMin() + .5 * dy,
-            dest_extent.xMax() - .5 * dx, dest_extent.yMax() - .5 * dy,
-            srcPointsX, srcPointsY, width, height);
+        // Start by computing the source-SRS coordinates of each
+        // destination pixel.
+        std::vector<double> srcPointsX, srcPointsY;
+        computeSourceCoords(src_extent, dest_extent, width, height, xfac, yfac, srcPointsX, srcPointsY, pool);
 
         ImageUtils::PixelReader ia(image);
-        osg::Vec4 color;
-        osg::Vec4 urColor;
-        osg::Vec4 llColor;
-        osg::Vec4 ulColor;
-        osg::Vec4 lrColor;
 
-        double xfac = (image->s() - 1) / src_extent.width();
-        double yfac = (image->t() - 1) / src_extent.height();
+        // Read each source layer into memory a row at a time, and build each
+        // destination row before writing it, rather than going through the
+        // reader and writer one pixel at a time.
+        std::vector<osg::Vec4f> source(src_s * src_t);
+
+        const unsigned bands = (height + REPROJECT_BAND_ROWS - 1) / REPROJECT_BAND_ROWS;
 
         for (int depth = 0; depth < image->r(); depth++)
         {
+           for (int t = 0; t < src_t; ++t)
+           {
+              ia.readRow(&source[t * src_s], 0, t, src_s, depth);
+           }
+
            // Next, go through the source-SRS sample grid, read the color at each point from the source image,
            // and write it to the corresponding pixel in the destination image.
-           int pixel = 0;
-           double xfac = (image->s() - 1) / src_extent.width();
-           double yfac = (image->t() - 1) / src_extent.height();
-           for (unsigned int c = 0; c < width; ++c)
+           // Bands of rows are independent, so build and write them in parallel.
+           Threading::parallelFor(bands, pool, [&](unsigned band)
            {
-              for (unsigned int r = 0; r < height; ++r)
-              {
-                 double src_x = srcPointsX[pixel];
-                 double src_y = srcPointsY[pixel];
+              std::vector<osg::Vec4f> row(width);
+              osg::Vec4 color;
 
-                 if (src_x < src_extent.xMin() || src_x > src_extent.xMax() || src_y < src_extent.yMin() || src_y > src_extent.yMax())
+              unsigned int rEnd = osg::minimum((band + 1) * REPROJECT_BAND_ROWS, height);
+              for (unsigned int r = band * REPROJECT_BAND_ROWS; r < rEnd; ++r)
+              {
+                 for (unsigned int c = 0; c < width; ++c)
                  {
-                    //If the sample point is outside of the bound of the source extent, increment the pixel and keep looping through.
-                    //OE_WARN << LC << "ERROR: sample point out of bounds: " << src_x << ", " << src_y << std::endl;
-                    pixel++;
-                    continue;
-                 }
+                    unsigned int pixel = r * width + c;
+                    double src_x = srcPointsX[pixel];
+                    double src_y = srcPointsY[pixel];
 
-                 float px = (src_x - src_extent.xMin()) * xfac;
-                 float py = (src_y - src_extent.yMin()) * yfac;
+                    color.set(0,0,0,0);
 
-                 int px_i = osg::clampBetween((int)osg::round(px), 0, image->s() - 1);
-                 int py_i = osg::clampBetween((int)osg::round(py), 0, image->t() - 1);
+                    if (!(src_x >= src_extent.xMin() && src_x <= src_extent.xMax() && src_y >= src_extent.yMin() && src_y <= src_extent.yMax()))
+                    {
+                       //If the sample point is outside of the bound of the source extent (or failed to
+                       //transform), leave the pixel transparent.
+                       row[c] = color;
+                       continue;
+                    }
 
-                 color.set(0,0,0,0);
+                    float px = (src_x - src_extent.xMin()) * xfac;
+                    float py = (src_y - src_extent.yMin()) * yfac;
 
-                 // TODO: consider this again later. Causes blockiness.
-                 if (!interpolate) //! isSrcContiguous ) // non-contiguous space- use nearest neighbot
-                 {
-                    ia(color, px_i, py_i, depth);
-                 }
+                    int px_i = osg::clampBetween((int)osg::round(px), 0, src_s - 1);
+                    int py_i = osg::clampBetween((int)osg::round(py), 0, src_t - 1);
 
-                 else // contiguous space - use bilinear sampling
-                 {
-                    int rowMin = osg::maximum((int)floor(py), 0);
-                    int rowMax = osg::maximum(osg::minimum((int)ceil(py), (int)(image->t() - 1)), 0);
-                    int colMin = osg::maximum((int)floor(px), 0);
-                    int colMax = osg::maximum(osg::minimum((int)ceil(px), (int)(image->s() - 1)), 0);
-
-                    if (rowMin > rowMax) rowMin = rowMax;
-                    if (colMin > colMax) colMin = colMax;
-
-                    ia(urColor, colMax, rowMax, depth);
-                    ia(llColor, colMin, rowMin, depth);
-                    ia(ulColor, colMin, rowMax, depth);
-                    ia(lrColor, colMax, rowMin, depth);
-
-                    /*Bilinear interpolation*/
-                    //Check for exact value
-                    if ((colMax == colMin) && (rowMax == rowMin))
+                    // TODO: consider this again later. Causes blockiness.
+                    if (!interpolate) //! isSrcContiguous ) // non-contiguous space- use nearest neighbot
                     {
-                       //OE_NOTICE << "[osgEarth::GeoData] Exact value" << std::endl;
-                       ia(color, px_i, py_i, depth);
+                       color = source[py_i * src_s + px_i];
                     }
-                    else if (colMax == colMin)
+
+                    else // contiguous space - use bilinear sampling
                     {
-                       //OE_NOTICE << "[osgEarth::GeoData] Vertically" << std::endl;
-                       //Linear interpolate vertically
-                       for (unsigned int i = 0; i < 4; ++i)
+                       int rowMin = osg::maximum((int)floor(py), 0);
+                       int rowMax = osg::maximum(osg::minimum((int)ceil(py), (int)(src_t - 1)), 0);
+                       int colMin = osg::maximum((int)floor(px), 0);
+                       int colMax = osg::maximum(osg::minimum((int)ceil(px), (int)(src_s - 1)), 0);
+
+                       if (rowMin > rowMax) rowMin = rowMax;
+                       if (colMin > colMax) colMin = colMax;
+
+                       const osg::Vec4f& urColor = source[rowMax * src_s + colMax];
+                       const osg::Vec4f& llColor = source[rowMin * src_s + colMin];
+                       const osg::Vec4f& ulColor = source[rowMax * src_s + colMin];
+                       const osg::Vec4f& lrColor = source[rowMin * src_s + colMax];
+
+                       /*Bilinear interpolation*/
+                       //Check for exact value
+                       if ((colMax == colMin) && (rowMax == rowMin))
                        {
-                          color[i] = ((float)rowMax - py) * llColor[i] + (py - (float)rowMin) * ulColor[i];
+                          color = source[py_i * src_s + px_i];
                        }
-                    }
-                    else if (rowMax == rowMin)
-                    {
-                       //OE_NOTICE << "[osgEarth::GeoData] Horizontally" << std::endl;
-                       //Linear interpolate horizontally
-                       for (unsigned int i = 0; i < 4; ++i)
+                       else if (colMax == colMin)
                        {
-                          color[i] = ((float)colMax - px) * llColor[i] + (px - (float)colMin) * lrColor[i];
+                          //Linear interpolate vertically
+                          for (unsigned int i = 0; i < 4; ++i)
+                          {
+                             color[i] = ((float)rowMax - py) * llColor[i] + (py - (float)rowMin) * ulColor[i];
+                          }
                        }
-                    }
-                    else
-                    {
-                       //OE_NOTICE << "[osgEarth::GeoData] Bilinear" << std::endl;
-                       //Bilinear interpolate
-                       float col1 = colMax - px, col2 = px - colMin;
-                       float row1 = rowMax - py, row2 = py - rowMin;
-                       for (unsigned int i = 0; i < 4; ++i)
+                       else if (rowMax == rowMin)
                        {
-                          float r1 = col1 * llColor[i] + col2 * lrColor[i];
-                          float r2 = col1 * ulColor[i] + col2 * urColor[i];
-
-                          //OE_INFO << "r1, r2 = " << r1 << " , " << r2 << std::endl;
-                          color[i] = row1 * r1 + row2 * r2;
+                          //Linear interpolate horizontally
+                          for (unsigned int i = 0; i < 4; ++i)
+                          {
+                             color[i] = ((float)colMax - px) * llColor[i] + (px - (float)colMin) * lrColor[i];
+                          }
+                       }
+                       else
+                       {
+                          //Bilinear interpolate
+                          float col1 = colMax - px, col2 = px - colMin;
+                          float row1 = rowMax - py, row2 = py - rowMin;
+                          for (unsigned int i = 0; i < 4; ++i)
+                          {
+                             float r1 = col1 * llColor[i] + col2 * lrColor[i];
+                             float r2 = col1 * ulColor[i] + col2 * urColor[i];
+                             color[i] = row1 * r1 + row2 * r2;
+                          }
                        }
                     }
+
+                    row[c] = color;
                  }
 
-                 writer(color, c, r, depth);
-                 pixel++;
+                 writer.writeRow(row.data(), 0, r, width, depth);
               }
-           }
+           });
         }
 
-        delete[] srcPointsX;
-
         return result;
     }
 }
@@ -2432,24 +2611,31 @@ GeoHeightField::createSubSample( const GeoExtent& destEx, unsigned int width, un
     dest->setXInterval( dx );
     dest->setYInterval( dy );
 
-    double x, y;
-    int col, row;
-
     double x0 = (destEx.xMin()-_extent.xMin())/_extent.width();
     double y0 = (destEx.yMin()-_extent.yMin())/_extent.height();
 
     double xstep = div / (double)(width-1);
     double ystep = div / (double)(height-1);
-    
-    for( x = x0, col = 0; col < (int)width; x += xstep, col++ )
-    {
-        for( y = y0, row = 0; row < (int)height; y += ystep, row++ )
+
+    // sample bands of rows in parallel; each row is independent
+    const unsigned bandRows = 16u;
+    const unsigned bands = (height + bandRows - 1) / bandRows;
+
+    Threading::parallelFor(bands, jobs::get_pool("oe.reproject"), [&](unsigned band)
         {
-            float heightAtNL = HeightFieldUtils::getHeightAtNormalizedLocation(
-                _heightField.get(), x, y, interpolation );
-            dest->setHeight( col, row, heightAtNL);
-        }
-    }
+            unsigned rowEnd = osg::minimum((band + 1) * bandRows, height);
+            for (unsigned row = band * bandRows; row < rowEnd; ++row)
+            {
+                double y = y0 + ystep * (double)row;
+                for (unsigned col = 0; col < width; ++col)
+                {
+                    double x = x0 + xstep * (double)col;
+                    float heightAtNL = HeightFieldUtils::getHeightAtNormalizedLocation(
+                        _heightField.get(), x, y, interpolation);
+                    dest->setHeight(col, row, heightAtNL);
+                }
+            }
+        });
 
     return GeoHeightField( dest, destEx ); // Q: is the VDATUM accounted for?
 }
@@ -449,6 +449,12 @@ ImageLayer::createImageInKeyProfile(const TileKey& key, ProgressCallback* progre
         return GeoImage::INVALID;
     }
 
+    // An earlier request for this key came back empty; don't ask again.
+    if (isKnownMissing(key))
+    {
+        return GeoImage::INVALID;
+    }
+
     // Tile gate prevents two threads from requesting the same key
     // at the same time, which would be unnecessary work. Only lock
     // the gate if there is an L2 cache active
@@ -580,6 +586,7 @@ ImageLayer::createImageInKeyProfile(const TileKey& key, ProgressCallback* progre
     {
         if (ImageUtils::areEquivalent(result.getImage(), _nodataImage.get()))
         {
+            setKnownMissing(key);
             return GeoImage::INVALID;
         }
     }
@@ -628,6 +635,11 @@ ImageLayer::createImageInKeyProfile(const TileKey& key, ProgressCallback* progre
             OE_DEBUG << LC << "Using cached but expired image for " << key.str() << std::endl;
             result = GeoImage( cachedImage.get(), key.getExtent());
         }
+        else if (result.getStatus().isOK())
+        {
+            // no data and no error; remember that so we don't ask again.
+            setKnownMissing(key);
+        }
 #endif
     }
 
@@ -23,6 +23,7 @@
 #include <osgEarth/Metrics>
 #include <osgEarth/ImageLayer>
 #include <osgEarth/Math>
+#include <osgEarth/SIMD>
 #include <osg/GLU>
 #include <osgDB/Registry>
 
@@ -43,6 +44,242 @@
 using namespace osgEarth;
 using namespace osgEarth::Util;
 
+namespace
+{
+    using namespace osgEarth::Util::SIMD;
+
+    // Formats with dedicated kernels that skip PixelReader/PixelWriter
+    enum FastFormat
+    {
+        FAST_NONE,
+        FAST_RGBA8,
+        FAST_RGB8,
+        FAST_R32F   // GL_RED or GL_LUMINANCE floats
+    };
+
+    FastFormat getFastFormat(const osg::Image* image)
+    {
+        GLenum format = image->getPixelFormat();
+
+        if (image->getDataType() == GL_UNSIGNED_BYTE)
+        {
+            if (format == GL_RGBA) return FAST_RGBA8;
+            if (format == GL_RGB) return FAST_RGB8;
+        }
+        else if (image->getDataType() == GL_FLOAT)
+        {
+            if (format == GL_RED || format == GL_LUMINANCE) return FAST_R32F;
+        }
+        return FAST_NONE;
+    }
+
+    // d = d*(1-a) + s*a over n bytes
+    void mixBytes(unsigned char* d, const unsigned char* s, unsigned n, float a)
+    {
+        float4 wd = float4::set1(1.0f - a), ws = float4::set1(a);
+        unsigned i = 0;
+        for (; i + 4 <= n; i += 4)
+            (float4::loadBytes(d + i) * wd + float4::loadBytes(s + i) * ws).storeBytes(d + i);
+        for (; i < n; ++i)
+            d[i] = (unsigned char)((float)d[i] * (1.0f - a) + (float)s[i] * a + 0.5f);
+    }
+
+    // d = d*(1-a) + s*a over n floats
+    void mixFloats(float* d, const float* s, unsigned n, float a)
+    {
+        float4 wd = float4::set1(1.0f - a), ws = float4::set1(a);
+        unsigned i = 0;
+        for (; i + 4 <= n; i += 4)
+            (float4::load(d + i) * wd + float4::load(s + i) * ws).store(d + i);
+        for (; i < n; ++i)
+            d[i] = d[i] * (1.0f - a) + s[i] * a;
+    }
+
+    // Same blend as the generic ImageUtils::mix, one RGBA8 pixel per vector
+    void mixRGBA8(unsigned char* d, const unsigned char* s, unsigned pixels, float a)
+    {
+        const float scale = 1.0f / 255.0f;
+        for (unsigned i = 0; i < pixels; ++i, d += 4, s += 4)
+        {
+            float sa = a * ((float)s[3] * scale);
+            float da = (float)d[3] * scale;
+            (float4::loadBytes(d) * float4::set1(1.0f - sa) + float4::loadBytes(s) * float4::set1(sa)).storeBytes(d);
+            d[3] = (unsigned char)(osg::maximum(sa, da) * 255.0f + 0.5f);
+        }
+    }
+
+    // Calls func(srcRow, destRow) for every row of every layer
+    template<typename FUNC>
+    void forEachRow(const osg::Image* src, osg::Image* dest, FUNC&& func)
+    {
+        for (int r = 0; r < src->r(); ++r)
+            for (int t = 0; t < src->t(); ++t)
+                func(src->data(0, t, r), dest->data(0, t, r));
+    }
+
+    // Source samples for one output column or row of a resize
+    struct Tap
+    {
+        int i0, i1;     // bilinear neighbors (equal when there's only one)
+        float w0, w1;   // bilinear weights
+        int nearest;
+    };
+
+    // Mirrors the sample positions of the generic resizeImage loop
+    void computeTaps(unsigned in, unsigned out, std::vector<Tap>& taps)
+    {
+        taps.resize(out);
+        for (unsigned o = 0; o < out; ++o)
+        {
+            float x = ((float)o / (float)out) * (float)in;
+            if (x >= (float)in) x = (float)(in - 1);
+            else if (x < 0.0f) x = 0.0f;
+
+            Tap& tap = taps[o];
+            tap.i0 = osg::maximum((int)floor(x), 0);
+            tap.i1 = osg::maximum(osg::minimum((int)ceil(x), (int)in - 1), 0);
+            if (tap.i0 > tap.i1) tap.i0 = tap.i1;
+            tap.w0 = tap.i0 == tap.i1 ? 1.0f : (float)tap.i1 - x;
+            tap.w1 = tap.i0 == tap.i1 ? 0.0f : x - (float)tap.i0;
+
+            tap.nearest = (x - (int)x) <= (ceil(x) - x) ?
+                (int)x :
+                osg::minimum(1 + (int)x, (int)in - 1);
+        }
+    }
+
+    bool resizeFast(const osg::Image* input, unsigned out_s, unsigned out_t, osg::Image* output, bool bilinear)
+    {
+        FastFormat format = getFastFormat(input);
+        if (format == FAST_NONE || !ImageUtils::sameFormat(input, output))
+            return false;
+
+        std::vector<Tap> cols, rows;
+        computeTaps(input->s(), out_s, cols);
+        computeTaps(input->t(), out_t, rows);
+
+        for (int layer = 0; layer < input->r(); ++layer)
+        {
+            for (unsigned t = 0; t < out_t; ++t)
+            {
+                const Tap& ty = rows[t];
+                unsigned char* out = output->data(0, t, layer);
+
+                if (!bilinear)
+                {
+                    const unsigned char* in = input->data(0, ty.nearest, layer);
+                    unsigned bytes = input->getPixelSizeInBits() / 8;
+                    for (unsigned s = 0; s < out_s; ++s)
+                        ::memcpy(out + s * bytes, in + cols[s].nearest * bytes, bytes);
+                }
+
+                else if (format == FAST_RGBA8)
+                {
+                    const unsigned char* r0 = input->data(0, ty.i0, layer);
+                    const unsigned char* r1 = input->data(0, ty.i1, layer);
+                    float4 w0y = float4::set1(ty.w0), w1y = float4::set1(ty.w1);
+
+                    for (unsigned s = 0; s < out_s; ++s)
+                    {
+                        const Tap& tx = cols[s];
+                        float4 w0x = float4::set1(tx.w0), w1x = float4::set1(tx.w1);
+                        float4 c0 = float4::loadBytes(r0 + 4 * tx.i0) * w0x + float4::loadBytes(r0 + 4 * tx.i1) * w1x;
+                        float4 c1 = float4::loadBytes(r1 + 4 * tx.i0) * w0x + float4::loadBytes(r1 + 4 * tx.i1) * w1x;
+                        (c0 * w0y + c1 * w1y).storeBytes(out + 4 * s);
+                    }
+                }
+
+                else if (format == FAST_RGB8)
+                {
+                    const unsigned char* r0 = input->data(0, ty.i0, layer);
+                    const unsigned char* r1 = input->data(0, ty.i1, layer);
+
+                    for (unsigned s = 0; s < out_s; ++s)
+                    {
+                        const Tap& tx = cols[s];
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            float c0 = (float)r0[3 * tx.i0 + c] * tx.w0 + (float)r0[3 * tx.i1 + c] * tx.w1;
+                            float c1 = (float)r1[3 * tx.i0 + c] * tx.w0 + (float)r1[3 * tx.i1 + c] * tx.w1;
+                            out[3 * s + c] = (unsigned char)(c0 * ty.w0 + c1 * ty.w1 + 0.5f);
+                        }
+                    }
+                }
+
+                else // FAST_R32F
+                {
+                    // Same branches as the generic path, so results are identical
+                    // and a NaN or no-data neighbor with zero weight is never read.
+                    const float* r0 = (const float*)input->data(0, ty.i0, layer);
+                    const float* r1 = (const float*)input->data(0, ty.i1, layer);
+                    float* outf = (float*)out;
+
+                    for (unsigned s = 0; s < out_s; ++s)
+                    {
+                        const Tap& tx = cols[s];
+                        if (tx.i0 == tx.i1 && ty.i0 == ty.i1)
+                            outf[s] = r0[tx.i0];
+                        else if (tx.i0 == tx.i1)
+                            outf[s] = r0[tx.i0] * ty.w0 + r1[tx.i0] * ty.w1;
+                        else if (ty.i0 == ty.i1)
+                            outf[s] = r0[tx.i0] * tx.w0 + r0[tx.i1] * tx.w1;
+                        else
+                            outf[s] =
+                                (r0[tx.i0] * tx.w0 + r0[tx.i1] * tx.w1) * ty.w0 +
+                                (r1[tx.i0] * tx.w0 + r1[tx.i1] * tx.w1) * ty.w1;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool convertFast(const osg::Image* image, osg::Image* result)
+    {
+        GLenum fromFormat = image->getPixelFormat(), toFormat = result->getPixelFormat();
+        GLenum fromType = image->getDataType(), toType = result->getDataType();
+        unsigned s = image->s();
+
+        if (fromFormat == GL_RGBA && fromType == GL_UNSIGNED_BYTE &&
+            toFormat == GL_RGB && toType == GL_UNSIGNED_BYTE)
+        {
+            forEachRow(image, result, [s](const unsigned char* in, unsigned char* out)
+                {
+                    for (unsigned i = 0; i < s; ++i, in += 4, out += 3)
+                        out[0] = in[0], out[1] = in[1], out[2] = in[2];
+                });
+            return true;
+        }
+
+        if (fromFormat == GL_RGBA && fromType == GL_UNSIGNED_BYTE &&
+            toFormat == GL_RGBA && toType == GL_FLOAT)
+        {
+            float4 scale = float4::set1(1.0f / 255.0f);
+            forEachRow(image, result, [s, scale](const unsigned char* in, unsigned char* out)
+                {
+                    for (unsigned i = 0; i < s; ++i)
+                        (float4::loadBytes(in + 4 * i) * scale).store((float*)out + 4 * i);
+                });
+            return true;
+        }
+
+        if (fromFormat == GL_RGBA && fromType == GL_FLOAT &&
+            toFormat == GL_RGBA && toType == GL_UNSIGNED_BYTE)
+        {
+            float4 scale = float4::set1(255.0f);
+            forEachRow(image, result, [s, scale](const unsigned char* in, unsigned char* out)
+                {
+                    for (unsigned i = 0; i < s; ++i)
+                        (float4::load((const float*)in + 4 * i) * scale).storeBytes(out + 4 * i);
+                });
+            return true;
+        }
+
+        return false;
+    }
+}
+
 
 osg::Image*
 ImageUtils::cloneImage( const osg::Image* input )
@@ -94,15 +331,14 @@ ImageUtils::copyAsSubImage(const osg::Image* src, osg::Image* dst, int dst_start
 
         PixelReader read(src);
         PixelWriter write(dst);
+        std::vector<osg::Vec4f> row(src->s());
 
         for( int r=0; r<src->r(); ++r)
         {
             for( int src_t=0, dst_t=dst_start_row; src_t < src->t(); src_t++, dst_t++ )
             {
-                for( int src_s=0, dst_s=dst_start_col; src_s < src->s(); src_s++, dst_s++ )
-                {
-                    write(read(src_s, src_t, r), dst_s, dst_t, r);
-                }
+                read.readRow(row.data(), 0, src_t, src->s(), r);
+                write.writeRow(row.data(), dst_start_col, dst_t, src->s(), r);
             }
         }
     }
@@ -216,45 +452,69 @@ ImageUtils::resizeImage(const osg::Image* input,
     {
         memcpy( output->data(), input->data(), input->getTotalSizeInBytes() );
     }
+    else if ( mipmapLevel == 0 && resizeFast(input, out_s, out_t, output.get(), bilinear) )
+    {
+        // done
+    }
     else
     {
         PixelReader read( input );
         PixelWriter write( output.get() );
 
-        osg::Vec4 color;
+        std::vector<osg::Vec4f> minRow(in_s), maxRow(in_s), outRow(out_s);
 
-        for( unsigned int output_row=0; output_row < out_t; output_row++ )
+        for(int layer=0; layer<input->r(); ++layer)
         {
-            // get an appropriate input row
-            float output_row_ratio = (float)output_row/(float)out_t;
-            float input_row = output_row_ratio * (float)in_t;
-            if ( input_row >= input->t() ) input_row = in_t-1;
-            else if ( input_row < 0 ) input_row = 0;
-
-            for( unsigned int output_col = 0; output_col < out_s; output_col++ )
+            for( unsigned int output_row=0; output_row < out_t; output_row++ )
             {
-                float output_col_ratio = (float)output_col/(float)out_s;
-                float input_col =  output_col_ratio * (float)in_s;
-                if ( input_col >= (int)in_s ) input_col = in_s-1;
-                else if ( input_col < 0 ) input_col = 0.0f;
+                // get an appropriate input row
+                float output_row_ratio = (float)output_row/(float)out_t;
+                float input_row = output_row_ratio * (float)in_t;
+                if ( input_row >= input->t() ) input_row = in_t-1;
+                else if ( input_row < 0 ) input_row = 0;
+
+                int rowMin = osg::maximum((int)floor(input_row), 0);
+                int rowMax = osg::maximum(osg::minimum((int)ceil(input_row), (int)(input->t()-1)), 0);
+                if (rowMin > rowMax) rowMin = rowMax;
+
+                int nearestRow = (input_row-(int)input_row) <= (ceil(input_row)-input_row) ?
+                    (int)input_row :
+                    osg::minimum( 1+(int)input_row, (int)in_t-1 );
+
+                // read the source rows this output row needs (from mip level 0)
+                if (bilinear)
+                {
+                    read.readRow(minRow.data(), 0, rowMin, in_s, layer);
+                    if (rowMax != rowMin)
+                        read.readRow(maxRow.data(), 0, rowMax, in_s, layer);
+                    else
+                        maxRow = minRow;
+                }
+                else
+                {
+                    read.readRow(minRow.data(), 0, nearestRow, in_s, layer);
+                }
 
-                for(int layer=0; layer<input->r(); ++layer)
+                for( unsigned int output_col = 0; output_col < out_s; output_col++ )
                 {
+                    float output_col_ratio = (float)output_col/(float)out_s;
+                    float input_col =  output_col_ratio * (float)in_s;
+                    if ( input_col >= (int)in_s ) input_col = in_s-1;
+                    else if ( input_col < 0 ) input_col = 0.0f;
+
+                    osg::Vec4f& color = outRow[output_col];
+
                     if (bilinear)
                     {
                         // Do a bilinear interpolation for the image
-                        int rowMin = osg::maximum((int)floor(input_row), 0);
-                        int rowMax = osg::maximum(osg::minimum((int)ceil(input_row), (int)(input->t()-1)), 0);
                         int colMin = osg::maximum((int)floor(input_col), 0);
                         int colMax = osg::maximum(osg::minimum((int)ceil(input_col), (int)(input->s()-1)), 0);
-
-                        if (rowMin > rowMax) rowMin = rowMax;
                         if (colMin > colMax) colMin = colMax;
 
-                        osg::Vec4 urColor = read(colMax, rowMax, layer);
-                        osg::Vec4 llColor = read(colMin, rowMin, layer);
-                        osg::Vec4 ulColor = read(colMin, rowMax, layer);
-                        osg::Vec4 lrColor = read(colMax, rowMin, layer);
+                        const osg::Vec4f& urColor = maxRow[colMax];
+                        const osg::Vec4f& llColor = minRow[colMin];
+                        const osg::Vec4f& ulColor = maxRow[colMin];
+                        const osg::Vec4f& lrColor = minRow[colMax];
 
                         if ((colMax == colMin) && (rowMax == rowMin))
                         {
@@ -286,18 +546,11 @@ ImageUtils::resizeImage(const osg::Image* input,
                             (int)input_col :
                             osg::minimum( 1+(int)input_col, (int)in_s-1 );
 
-                        int row = (input_row-(int)input_row) <= (ceil(input_row)-input_row) ?
-                            (int)input_row :
-                            osg::minimum( 1+(int)input_row, (int)in_t-1 );
-
-                        read(color, col, row, layer); // read pixel from mip level 0.
-
-                        // old code
-                        //color = read( (int)input_col, (int)input_row, layer ); // read pixel from mip level 0
+                        color = minRow[col];
                     }
-
-                    write( color, output_col, output_row, layer, mipmapLevel ); // write to target mip level
                 }
+
+                write.writeRow( outRow.data(), 0, output_row, out_s, layer, mipmapLevel ); // write to target mip level
             }
         }
     }
@@ -964,26 +1217,53 @@ ImageUtils::mix(osg::Image* dest, const osg::Image* src, float a)
     }
 
     a = osg::clampBetween( a, 0.0f, 1.0f );
+
+    FastFormat format = sameFormat(dest, src) ? getFastFormat(src) : FAST_NONE;
+    if (format != FAST_NONE)
+    {
+        unsigned s = src->s();
+        forEachRow(src, dest, [&](const unsigned char* in, unsigned char* out)
+            {
+                if (format == FAST_RGBA8)
+                    mixRGBA8(out, in, s, a);
+                else if (format == FAST_RGB8)
+                    mixBytes(out, in, s * 3, a);
+                else
+                    mixFloats((float*)out, (const float*)in, s, a);
+            });
+        return true;
+    }
+
     bool srcHasAlpha = hasAlphaChannel(src);
     bool destHasAlpha = hasAlphaChannel(dest);
 
-    osg::Vec4 src_value, dest_value;
     PixelReader read_src(src), read_dest(dest);
     PixelWriter write_dest(dest);
-    ImageIterator i(src);
+    std::vector<osg::Vec4f> src_row(src->s()), dest_row(src->s());
 
-    i.forEachPixel([&]() {
-        read_src(src_value, i.s(), i.t());
-        read_dest(dest_value, i.s(), i.t());
-        float sa = srcHasAlpha ? a * src_value.a() : a;
-        float da = destHasAlpha ? dest_value.a() : 1.0f;
-        dest_value.set(
-            dest_value.r()*(1.0f - sa) + src_value.r()*sa,
-            dest_value.g()*(1.0f - sa) + src_value.g()*sa,
-            dest_value.b()*(1.0f - sa) + src_value.b()*sa,
-            osg::maximum(sa, da));
-        write_dest(dest_value, i.s(), i.t());
-        });
+    for (int r = 0; r < src->r(); ++r)
+    {
+        for (int t = 0; t < src->t(); ++t)
+        {
+            read_src.readRow(src_row.data(), 0, t, src->s(), r);
+            read_dest.readRow(dest_row.data(), 0, t, src->s(), r);
+
+            for (int s = 0; s < src->s(); ++s)
+            {
+                const osg::Vec4f& src_value = src_row[s];
+                osg::Vec4f& dest_value = dest_row[s];
+                float sa = srcHasAlpha ? a * src_value.a() : a;
+                float da = destHasAlpha ? dest_value.a() : 1.0f;
+                dest_value.set(
+                    dest_value.r()*(1.0f - sa) + src_value.r()*sa,
+                    dest_value.g()*(1.0f - sa) + src_value.g()*sa,
+                    dest_value.b()*(1.0f - sa) + src_value.b()*sa,
+                    osg::maximum(sa, da));
+            }
+
+            write_dest.writeRow(dest_row.data(), 0, t, src->s(), r);
+        }
+    }
 
     return true;
 }
@@ -1176,14 +1456,15 @@ ImageUtils::isEmptyImage(const osg::Image* image, float alphaThreshold)
     }
 
     PixelReader read(image);
+    std::vector<osg::Vec4f> row(image->s());
 
-    for(unsigned r=0; r<(unsigned)image->r(); ++r)
+    for(int r=0; r<image->r(); ++r)
     {
-        for(unsigned t=0; t<(unsigned)image->t(); ++t)
+        for(int t=0; t<image->t(); ++t)
         {
-            for(unsigned s=0; s<(unsigned)image->s(); ++s)
+            read.readRow(row.data(), 0, t, image->s(), r);
+            for(auto& color : row)
             {
-                osg::Vec4 color = read(s, t, r);
                 if ( color.a() > alphaThreshold )
                     return false;
             }
@@ -1217,13 +1498,15 @@ ImageUtils::isSingleColorImage(const osg::Image* image, float threshold)
     float refB = referenceColor.b();
     float refA = referenceColor.a();
 
-    for(unsigned r=0; r<(unsigned)image->r(); ++r)
+    std::vector<osg::Vec4f> row(image->s());
+
+    for(int r=0; r<image->r(); ++r)
     {
-        for(unsigned t=0; t<(unsigned)image->t(); ++t)
+        for(int t=0; t<image->t(); ++t)
         {
-            for(unsigned s=0; s<(unsigned)image->s(); ++s)
+            read.readRow(row.data(), 0, t, image->s(), r);
+            for(auto& color : row)
             {
-                osg::Vec4 color = read(s, t, r);
                 if (   (fabs(color.r()-refR) > threshold)
                     || (fabs(color.g()-refG) > threshold)
                     || (fabs(color.b()-refB) > threshold)
@@ -1431,14 +1714,21 @@ ImageUtils::convert(const osg::Image* image, GLenum pixelFormat, GLenum dataType
         result->setInternalTextureFormat( pixelFormat );
 
     // copy image to result
-    PixelReader read(image);
-    PixelWriter write(result);
-    osg::Vec4 value;
-    ImageIterator iter(read);
-    iter.forEachPixel([&]() {
-        read(value, iter.s(), iter.t());
-        write(value, iter.s(), iter.t());
-    });
+    if (!convertFast(image, result))
+    {
+        PixelReader read(image);
+        PixelWriter write(result);
+        std::vector<osg::Vec4f> row(image->s());
+
+        for (int r = 0; r < image->r(); ++r)
+        {
+            for (int t = 0; t < image->t(); ++t)
+            {
+                read.readRow(row.data(), 0, t, image->s(), r);
+                write.writeRow(row.data(), 0, t, image->s(), r);
+            }
+        }
+    }
 
     return result;
 }
@@ -1506,11 +1796,18 @@ ImageUtils::hasTransparency(const osg::Image* image, float threshold)
         return false;
 
     PixelReader read(image);
+    std::vector<osg::Vec4f> row(image->s());
+
     for( int r=0; r<image->r(); ++r)
+    {
         for( int t=0; t<image->t(); ++t )
-            for( int s=0; s<image->s(); ++s )
-                if ( read(s, t, r).a() < threshold )
+        {
+            read.readRow(row.data(), 0, t, image->s(), r);
+            for( auto& color : row )
+                if ( color.a() < threshold )
                     return true;
+        }
+    }
 
     return false;
 }
@@ -1558,13 +1855,18 @@ ImageUtils::convertToPremultipliedAlpha(osg::Image* image)
 
     PixelReader read(image);
     PixelWriter write(image);
-    ImageIterator iter(read);
-    osg::Vec4 c;
-    iter.forEachPixel([&]() {
-        read(c, iter.s(), iter.t(), iter.r());
-        c.set(c.r()*c.a(), c.g()*c.a(), c.b()*c.a(), c.a());
-        write(c, iter.s(), iter.t(), iter.r());
-    });
+    std::vector<osg::Vec4f> row(image->s());
+
+    for (int r = 0; r < image->r(); ++r)
+    {
+        for (int t = 0; t < image->t(); ++t)
+        {
+            read.readRow(row.data(), 0, t, image->s(), r);
+            for (auto& c : row)
+                c.set(c.r()*c.a(), c.g()*c.a(), c.b()*c.a(), c.a());
+            write.writeRow(row.data(), 0, t, image->s(), r);
+        }
+    }
     return true;
 }
 
@@ -2211,38 +2513,78 @@ namespace
         }
     };
 
+    // Per-pixel and per-row read functions for one format
+    struct ReaderFuncs
+    {
+        ImageUtils::PixelReader::ReaderFunc read = nullptr;
+        ImageUtils::PixelReader::RowReaderFunc readRow = nullptr;
+        ImageUtils::PixelReader::RowScalarReaderFunc readRowScalar = nullptr;
+    };
+
+    // Loops over a row with the reader inlined, so there's one
+    // indirect call per row instead of one per pixel
+    template<typename READER>
+    struct RowReader
+    {
+        static void readRow(const ImageUtils::PixelReader* ia, osg::Vec4f* out, int s, int t, int count, int r, int m)
+        {
+            for (int i = 0; i < count; ++i)
+                READER::read(ia, out[i], s + i, t, r, m);
+        }
+
+        static void readRowScalar(const ImageUtils::PixelReader* ia, float* out, int s, int t, int count, int r, int m)
+        {
+            osg::Vec4f temp;
+            for (int i = 0; i < count; ++i)
+            {
+                READER::read(ia, temp, s + i, t, r, m);
+                out[i] = temp.r();
+            }
+        }
+    };
+
+    template<typename READER>
+    inline ReaderFuncs makeReader()
+    {
+        ReaderFuncs funcs;
+        funcs.read = &READER::read;
+        funcs.readRow = &RowReader<READER>::readRow;
+        funcs.readRowScalar = &RowReader<READER>::readRowScalar;
+        return funcs;
+    }
+
     template<int GLFormat>
-    inline ImageUtils::PixelReader::ReaderFunc
+    inline ReaderFuncs
     chooseReader(GLenum dataType)
     {
         switch (dataType)
         {
         case GL_BYTE:
-            return &ColorReader<GLFormat, GLbyte>::read;
+            return makeReader<ColorReader<GLFormat, GLbyte>>();
         case GL_UNSIGNED_BYTE:
-            return &ColorReader<GLFormat, GLubyte>::read;
+            return makeReader<ColorReader<GLFormat, GLubyte>>();
         case GL_SHORT:
-            return &ColorReader<GLFormat, GLshort>::read;
+            return makeReader<ColorReader<GLFormat, GLshort>>();
         case GL_UNSIGNED_SHORT:
-            return &ColorReader<GLFormat, GLushort>::read;
+            return makeReader<ColorReader<GLFormat, GLushort>>();
         case GL_INT:
-            return &ColorReader<GLFormat, GLint>::read;
+            return makeReader<ColorReader<GLFormat, GLint>>();
         case GL_UNSIGNED_INT:
-            return &ColorReader<GLFormat, GLuint>::read;
+            return makeReader<ColorReader<GLFormat, GLuint>>();
         case GL_FLOAT:
-            return &ColorReader<GLFormat, GLfloat>::read;
+            return makeReader<ColorReader<GLFormat, GLfloat>>();
         case GL_UNSIGNED_SHORT_5_5_5_1:
-            return &ColorReader<GL_UNSIGNED_SHORT_5_5_5_1, GLushort>::read;
+            return makeReader<ColorReader<GL_UNSIGNED_SHORT_5_5_5_1, GLushort>>();
         case GL_UNSIGNED_BYTE_3_3_2:
-            return &ColorReader<GL_UNSIGNED_BYTE_3_3_2, GLubyte>::read;
+            return makeReader<ColorReader<GL_UNSIGNED_BYTE_3_3_2, GLubyte>>();
         case GL_UNSIGNED_INT_8_8_8_8_REV:
-            return &ColorReader<GLFormat, GLubyte>::read;
+            return makeReader<ColorReader<GLFormat, GLubyte>>();
         default:
-            return &ColorReader<0, GLbyte>::read;
+            return makeReader<ColorReader<0, GLbyte>>();
         }
     }
 
-    inline ImageUtils::PixelReader::ReaderFunc
+    inline ReaderFuncs
     getReader( GLenum pixelFormat, GLenum dataType )
     {
         switch( pixelFormat )
@@ -2278,16 +2620,16 @@ namespace
             return chooseReader<GL_BGRA>(dataType);
             break;
         case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
-            return &ColorReader<GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GLubyte>::read;
+            return makeReader<ColorReader<GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GLubyte>>();
             break;
         case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
-            return &ColorReader<GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GLubyte>::read;
+            return makeReader<ColorReader<GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GLubyte>>();
             break;
         case GL_COMPRESSED_RED_GREEN_RGTC2_EXT:
-            return &ColorReader<GL_COMPRESSED_RED_GREEN_RGTC2_EXT, float>::read;
+            return makeReader<ColorReader<GL_COMPRESSED_RED_GREEN_RGTC2_EXT, float>>();
             break;
         default:
-            return 0L;
+            return ReaderFuncs();
             break;
         }
     }
@@ -2298,7 +2640,9 @@ ImageUtils::PixelReader::PixelReader() :
     _sampleAsTexture(false),
     _sampleAsRepeatingTexture(false),
     _image(nullptr),
-    _read(nullptr)
+    _read(nullptr),
+    _readRow(nullptr),
+    _readRowScalar(nullptr)
 {
     //nop
 }
@@ -2308,7 +2652,9 @@ ImageUtils::PixelReader::PixelReader(const osg::Image* image) :
     _sampleAsTexture(false),
     _sampleAsRepeatingTexture(false),
     _image(nullptr),
-    _read(nullptr)
+    _read(nullptr),
+    _readRow(nullptr),
+    _readRowScalar(nullptr)
 {
     setImage(image);
 }
@@ -2325,12 +2671,15 @@ ImageUtils::PixelReader::setImage(const osg::Image* image)
         _rowBytes = _image->getRowStepInBytes(); //getRowSizeInBytes();
         _imageBytes = _image->getImageSizeInBytes();
         GLenum dataType = _image->getDataType();
-        _read = getReader( _image->getPixelFormat(), dataType );
-        if ( !_read)
+        ReaderFuncs funcs = getReader( _image->getPixelFormat(), dataType );
+        if ( !funcs.read )
         {
             OE_WARN << "[PixelReader] No reader found for pixel format " << std::hex << _image->getPixelFormat() << std::endl;
-            _read = &ColorReader<0,GLbyte>::read;
+            funcs = makeReader<ColorReader<0, GLbyte>>();
         }
+        _read = funcs.read;
+        _readRow = funcs.readRow;
+        _readRowScalar = funcs.readRowScalar;
     }
 }
 
@@ -2672,42 +3021,80 @@ ImageUtils::PixelReader::operator()(double u, double v, int r, int m) const
 bool
 ImageUtils::PixelReader::supports( GLenum pixelFormat, GLenum dataType )
 {
-    return getReader(pixelFormat, dataType) != 0L;
+    return getReader(pixelFormat, dataType).read != nullptr;
 }
 
 //------------------------------------------------------------------------
 
 namespace
 {
+    // Per-pixel and per-row write functions for one format
+    struct WriterFuncs
+    {
+        ImageUtils::PixelWriter::WriterFunc write = nullptr;
+        ImageUtils::PixelWriter::RowWriterFunc writeRow = nullptr;
+        ImageUtils::PixelWriter::RowScalarWriterFunc writeRowScalar = nullptr;
+    };
+
+    template<typename WRITER>
+    struct RowWriter
+    {
+        static void writeRow(const ImageUtils::PixelWriter* iw, const osg::Vec4f* in, int s, int t, int count, int r, int m)
+        {
+            for (int i = 0; i < count; ++i)
+                WRITER::write(iw, in[i], s + i, t, r, m);
+        }
+
+        static void writeRowScalar(const ImageUtils::PixelWriter* iw, const float* in, int s, int t, int count, int r, int m)
+        {
+            osg::Vec4f temp;
+            for (int i = 0; i < count; ++i)
+            {
+                temp.set(in[i], in[i], in[i], 1.0f);
+                WRITER::write(iw, temp, s + i, t, r, m);
+            }
+        }
+    };
+
+    template<typename WRITER>
+    inline WriterFuncs makeWriter()
+    {
+        WriterFuncs funcs;
+        funcs.write = &WRITER::write;
+        funcs.writeRow = &RowWriter<WRITER>::writeRow;
+        funcs.writeRowScalar = &RowWriter<WRITER>::writeRowScalar;
+        return funcs;
+    }
+
     template<int GLFormat>
-    inline ImageUtils::PixelWriter::WriterFunc chooseWriter(GLenum dataType)
+    inline WriterFuncs chooseWriter(GLenum dataType)
     {
         switch (dataType)
         {
         case GL_BYTE:
-            return &ColorWriter<GLFormat, GLbyte>::write;
+            return makeWriter<ColorWriter<GLFormat, GLbyte>>();
         case GL_UNSIGNED_BYTE:
-            return &ColorWriter<GLFormat, GLubyte>::write;
+            return makeWriter<ColorWriter<GLFormat, GLubyte>>();
         case GL_SHORT:
-            return &ColorWriter<GLFormat, GLshort>::write;
+            return makeWriter<ColorWriter<GLFormat, GLshort>>();
         case GL_UNSIGNED_SHORT:
-            return &ColorWriter<GLFormat, GLushort>::write;
+            return makeWriter<ColorWriter<GLFormat, GLushort>>();
         case GL_INT:
-            return &ColorWriter<GLFormat, GLint>::write;
+            return makeWriter<ColorWriter<GLFormat, GLint>>();
         case GL_UNSIGNED_INT:
-            return &ColorWriter<GLFormat, GLuint>::write;
+            return makeWriter<ColorWriter<GLFormat, GLuint>>();
         case GL_FLOAT:
-            return &ColorWriter<GLFormat, GLfloat>::write;
+            return makeWriter<ColorWriter<GLFormat, GLfloat>>();
         case GL_UNSIGNED_SHORT_5_5_5_1:
-            return &ColorWriter<GL_UNSIGNED_SHORT_5_5_5_1, GLushort>::write;
+            return makeWriter<ColorWriter<GL_UNSIGNED_SHORT_5_5_5_1, GLushort>>();
         case GL_UNSIGNED_BYTE_3_3_2:
-            return &ColorWriter<GL_UNSIGNED_BYTE_3_3_2, GLubyte>::write;
+            return makeWriter<ColorWriter<GL_UNSIGNED_BYTE_3_3_2, GLubyte>>();
         default:
-            return 0L;
+            return WriterFuncs();
         }
     }
 
-    inline ImageUtils::PixelWriter::WriterFunc getWriter(GLenum pixelFormat, GLenum dataType)
+    inline WriterFuncs getWriter(GLenum pixelFormat, GLenum dataType)
     {
         switch( pixelFormat )
         {
@@ -2742,7 +3129,7 @@ namespace
             return chooseWriter<GL_BGRA>(dataType);
             break;
         default:
-            return 0L;
+            return WriterFuncs();
             break;
         }
     }
@@ -2758,19 +3145,22 @@ _image(image)
         _rowBytes = _image->getRowStepInBytes();
         _imageBytes = _image->getImageSizeInBytes();
         GLenum dataType = _image->getDataType();
-        _writer = getWriter( _image->getPixelFormat(), dataType );
-        if ( !_writer )
+        WriterFuncs funcs = getWriter( _image->getPixelFormat(), dataType );
+        if ( !funcs.write )
         {
             OE_WARN << "[PixelWriter] No writer found for pixel format " << std::hex << _image->getPixelFormat() << std::endl;
-            _writer = &ColorWriter<0, GLbyte>::write;
+            funcs = makeWriter<ColorWriter<0, GLbyte>>();
         }
+        _writer = funcs.write;
+        _writeRow = funcs.writeRow;
+        _writeRowScalar = funcs.writeRowScalar;
     }
 }
 
 bool
 ImageUtils::PixelWriter::supports( GLenum pixelFormat, GLenum dataType )
 {
-    return getWriter(pixelFormat, dataType) != 0L;
+    return getWriter(pixelFormat, dataType).write != nullptr;
 }
 
 void
@@ -2779,9 +3169,7 @@ ImageUtils::PixelWriter::assign(const osg::Vec4& c)
     if (_image->valid())
     {
         for(int r=0; r<_image->r(); ++r)
-            for(int t=0; t<_image->t(); ++t)
-                for(int s=0; s<_image->s(); ++s)
-                    (*this)(c, s, t, r);
+            assign(c, r);
     }
 }
 
@@ -2790,9 +3178,9 @@ ImageUtils::PixelWriter::assign(const osg::Vec4& c, int layer)
 {
     if (_image->valid())
     {
+        std::vector<osg::Vec4f> row(_image->s(), c);
         for(int t=0; t<_image->t(); ++t)
-            for(int s=0; s<_image->s(); ++s)
-                (*this)(c, s, t, layer);
+            writeRow(row.data(), 0, t, _image->s(), layer);
     }
 }
 
@@ -727,14 +727,15 @@ LandCoverLayerVector::populateLandCoverImage(
         ImageUtils::PixelWriter writeOutput(output.get());
 
         numNoDataValues = 0u;
+        std::vector<float> row(readOutput.s());
 
         for(int t=0; t<readOutput.t(); ++t)
         {
+            readOutput.readRow(row.data(), 0, t, readOutput.s());
+
             for(int s=0; s<readOutput.s(); ++s)
             {
-                readOutput(value, s, t);
-
-                if (value.r() == NO_DATA_VALUE)
+                if (row[s] == NO_DATA_VALUE)
                 {
                     readInput(value, (int)(s*scale+sbias), (int)(t*scale+tbias));
 
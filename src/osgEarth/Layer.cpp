@@ -24,6 +24,7 @@
 #include <osgEarth/TileKey>
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/TerrainResources>
+#include <osgEarth/WriteBehindCacheBin>
 #include <osg/StateSet>
 
 using namespace osgEarth;
@@ -406,11 +407,19 @@ Layer::openImplementation()
         _runtimeCacheId = getCacheID();
 
         // make our cacheing bin!
-        CacheBin* bin = _cacheSettings->getCache()->addBin(_runtimeCacheId);
-        if (bin)
+        osg::ref_ptr<CacheBin> bin = _cacheSettings->getCache()->addBin(_runtimeCacheId);
+
+        // optionally move cache writes off the loading threads.
+        unsigned writeBehindQueueSize = _cacheSettings->getCache()->getCacheOptions().writeBehindQueueSize().get();
+        if (bin.valid() && writeBehindQueueSize > 0u)
+        {
+            bin = new WriteBehindCacheBin(bin.get(), writeBehindQueueSize);
+        }
+
+        if (bin.valid())
         {
             OE_INFO << LC << "Cache bin is [" << _runtimeCacheId << "]" << std::endl;
-            _cacheSettings->setCacheBin(bin);
+            _cacheSettings->setCacheBin(bin.get());
         }
         else
         {
@@ -22,10 +22,15 @@
 #include <osgEarth/XmlUtils>
 #include <osgEarth/StringUtils>
 #include <osgEarth/ImageToHeightFieldConverter>
+#include <osgEarth/Threading>
 #include <osgDB/FileUtils>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <thread>
 #include <sqlite3.h>
 
 using namespace osgEarth;
@@ -60,6 +65,8 @@ MBTiles::Options::writeTo(Config& conf) const
     conf.set("filename", _url);
     conf.set("format", _format);
     conf.set("compress", _compress);
+    conf.set("max_read_connections", _maxReadConnections);
+    conf.set("write_batch_size", _writeBatchSize);
 }
 
 void
@@ -72,6 +79,8 @@ MBTiles::Options::readFrom(const Config& conf)
     conf.get("url", _url); // compat for consistency with other drivers
     conf.get("format", _format);
     conf.get("compress", _compress);
+    conf.get("max_read_connections", _maxReadConnections);
+    conf.get("write_batch_size", _writeBatchSize);
 }
 
 //...................................................................
@@ -142,6 +151,14 @@ MBTilesImageLayer::openImplementation()
     return Status::NoError;
 }
 
+Status
+MBTilesImageLayer::closeImplementation()
+{
+    Status status = _driver.close();
+    Status parent = ImageLayer::closeImplementation();
+    return status.isError() ? status : parent;
+}
+
 void
 MBTilesImageLayer::setDataExtents(const DataExtentList& values)
 {
@@ -258,6 +275,14 @@ MBTilesElevationLayer::openImplementation()
     return Status::NoError;
 }
 
+Status
+MBTilesElevationLayer::closeImplementation()
+{
+    Status status = _driver.close();
+    Status parent = ElevationLayer::closeImplementation();
+    return status.isError() ? status : parent;
+}
+
 void
 MBTilesElevationLayer::setDataExtents(const DataExtentList& values)
 {
@@ -328,11 +353,251 @@ bool MBTilesElevationLayer::putMetaData(const std::string& name, const std::stri
 #undef LC
 #define LC "[MBTiles] \"" << _name << "\" "
 
+/**
+ * Pool of read-only SQLite connections, each with its own prepared tile
+ * query. SQLite connections opened with NOMUTEX may be used from any
+ * thread as long as only one thread uses a given connection at a time,
+ * so each reader checks out a connection, runs its query, and returns it.
+ * Connections are opened on demand up to the maximum.
+ */
+class MBTiles::Driver::ReadConnectionPool
+{
+public:
+    struct Connection
+    {
+        sqlite3* database = nullptr;
+        sqlite3_stmt* selectTile = nullptr;
+
+        ~Connection()
+        {
+            if (selectTile)
+                sqlite3_finalize(selectTile);
+            if (database)
+                sqlite3_close_v2(database);
+        }
+    };
+
+    ReadConnectionPool(const std::string& filename, unsigned maxConnections) :
+        _filename(filename),
+        _maxConnections(std::max(maxConnections, 1u))
+    {
+        //nop
+    }
+
+    //! Check out a connection, blocking if they are all in use.
+    //! Returns nullptr upon failure and populates the error string.
+    Connection* take(std::string& error)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;)
+        {
+            if (!_idle.empty())
+            {
+                Connection* conn = _idle.back();
+                _idle.pop_back();
+                return conn;
+            }
+
+            if (_all.size() < _maxConnections)
+            {
+                std::unique_ptr<Connection> conn(new Connection());
+
+                int rc = sqlite3_open_v2(
+                    _filename.c_str(),
+                    &conn->database,
+                    SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                    0L);
+
+                if (rc != SQLITE_OK)
+                {
+                    error = Stringify() << "Failed to open read connection: " << sqlite3_errmsg(conn->database);
+                    return nullptr;
+                }
+
+                const char* query = "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
+                rc = sqlite3_prepare_v2(conn->database, query, -1, &conn->selectTile, 0L);
+                if (rc != SQLITE_OK)
+                {
+                    error = Stringify() << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(conn->database);
+                    return nullptr;
+                }
+
+                _all.emplace_back(std::move(conn));
+                return _all.back().get();
+            }
+
+            _available.wait(lock);
+        }
+    }
+
+    //! Return a connection to the pool after use.
+    void release(Connection* conn)
+    {
+        sqlite3_reset(conn->selectTile);
+        sqlite3_clear_bindings(conn->selectTile);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _idle.push_back(conn);
+        _available.notify_one();
+    }
+
+private:
+    std::string _filename;
+    unsigned _maxConnections;
+    std::mutex _mutex;
+    std::condition_variable _available;
+    std::vector<std::unique_ptr<Connection>> _all;
+    std::vector<Connection*> _idle;
+};
+
+/**
+ * Queue that accepts encoded tiles from any number of threads and commits
+ * them to the database on a single writer thread, many tiles per
+ * transaction. The queue is bounded so that producers block when the
+ * writer falls behind.
+ */
+class MBTiles::Driver::BatchWriter
+{
+public:
+    BatchWriter(Driver& driver, unsigned batchSize) :
+        _driver(driver),
+        _batchSize(std::max(batchSize, 1u)),
+        _capacity(4u * _batchSize),
+        _inFlight(0u),
+        _done(false)
+    {
+        _thread = std::thread([this]() { run(); });
+    }
+
+    //! Commits everything still in the queue, then stops the writer thread.
+    ~BatchWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            _done = true;
+        }
+        _wake.notify_all();
+        _thread.join();
+    }
+
+    //! Queue a tile for writing, blocking while the queue is full.
+    //! Returns the error from an earlier failed batch, if any, in which
+    //! case the tile is not queued.
+    Status push(int z, int x, int y, std::string&& data)
+    {
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        _space.wait(lock, [this]() { return _queue.size() < _capacity; });
+        if (_status.isError())
+            return _status;
+        _queue.emplace_back();
+        PendingTile& tile = _queue.back();
+        tile.z = z, tile.x = x, tile.y = y;
+        tile.data = std::move(data);
+        _wake.notify_one();
+        return Status::NoError;
+    }
+
+    //! Block until the queue is empty and the last batch is committed.
+    //! Returns the error from the first failed batch, if any.
+    Status flush()
+    {
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        _drained.wait(lock, [this]() { return _queue.empty() && _inFlight == 0u; });
+        return _status;
+    }
+
+private:
+    struct PendingTile
+    {
+        int z, x, y;
+        std::string data;
+    };
+
+    void run()
+    {
+        osgEarth::setThreadName("oe.mbtiles.write");
+
+        std::vector<PendingTile> batch;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_queueMutex);
+                _wake.wait(lock, [this]() { return !_queue.empty() || _done; });
+                if (_queue.empty())
+                    return;
+
+                unsigned count = std::min((unsigned)_queue.size(), _batchSize);
+                batch.assign(
+                    std::make_move_iterator(_queue.begin()),
+                    std::make_move_iterator(_queue.begin() + count));
+                _queue.erase(_queue.begin(), _queue.begin() + count);
+                _inFlight = count;
+            }
+            _space.notify_all();
+
+            Status status = commit(batch);
+            batch.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(_queueMutex);
+                _inFlight = 0u;
+                if (status.isError() && _status.isOK())
+                    _status = status;
+            }
+            _drained.notify_all();
+        }
+    }
+
+    Status commit(const std::vector<PendingTile>& batch)
+    {
+        std::lock_guard<std::mutex> exclusiveLock(_driver._mutex);
+
+        sqlite3* database = (sqlite3*)_driver._database;
+
+        sqlite3_exec(database, "BEGIN TRANSACTION", 0L, 0L, 0L);
+
+        Status result;
+        for (auto& tile : batch)
+        {
+            Status status = _driver.insertTileData(tile.z, tile.x, tile.y, tile.data);
+            if (status.isError())
+            {
+                OE_WARN << "[MBTiles] \"" << _driver._name << "\" " << status.message() << std::endl;
+                if (result.isOK())
+                    result = status;
+            }
+        }
+
+        if (SQLITE_OK != sqlite3_exec(database, "COMMIT", 0L, 0L, 0L))
+        {
+            result = Status(Status::GeneralError, Stringify()
+                << "Failed to commit " << batch.size() << " tiles; " << sqlite3_errmsg(database));
+            OE_WARN << "[MBTiles] \"" << _driver._name << "\" " << result.message() << std::endl;
+        }
+
+        return result;
+    }
+
+    Driver& _driver;
+    unsigned _batchSize;
+    unsigned _capacity;
+    std::deque<PendingTile> _queue;
+    unsigned _inFlight;
+    bool _done;
+    Status _status; // first failed batch; sticky
+    std::mutex _queueMutex;
+    std::condition_variable _wake;
+    std::condition_variable _space;
+    std::condition_variable _drained;
+    std::thread _thread;
+};
+
 MBTiles::Driver::Driver() :
     _minLevel(0),
     _maxLevel(19),
     _forceRGB(false),
-    _database(nullptr)
+    _database(nullptr),
+    _insertStatement(nullptr)
 {
     //nop
 }
@@ -345,14 +610,50 @@ Driver::~Driver()
 void
 MBTiles::Driver::closeDatabase()
 {
+    _readPool = nullptr;
+
+    // drains the queue before returning
+    bool batched = (_batchWriter != nullptr);
+    _batchWriter = nullptr;
+
+    if (_insertStatement != nullptr)
+    {
+        sqlite3_finalize((sqlite3_stmt*)_insertStatement);
+        _insertStatement = nullptr;
+    }
+
     if (_database != nullptr)
     {
         sqlite3* database = (sqlite3*)_database;
+
+        // fold the write-ahead log back into the main file so the
+        // database is self-contained again
+        if (batched)
+            sqlite3_exec(database, "PRAGMA journal_mode=DELETE", 0L, 0L, 0L);
+
         sqlite3_close_v2(database);
         _database = nullptr;
     }
 }
 
+Status
+MBTiles::Driver::flush()
+{
+    if (_batchWriter)
+    {
+        return _batchWriter->flush();
+    }
+    return Status::NoError;
+}
+
+Status
+MBTiles::Driver::close()
+{
+    Status status = flush();
+    closeDatabase();
+    return status;
+}
+
 Status
 MBTiles::Driver::open(
     const std::string& name,
@@ -579,7 +880,7 @@ MBTiles::Driver::open(
                 {
                     // Using 0 for the minLevel is not technically correct, but we use it instead of the proper minLevel to force osgEarth to subdivide
                     // since we don't really handle DataExtents with minLevels > 0 just yet.
-                    out_dataExtents.push_back(DataExtent(extent, 0, _maxLevel));
+                    out_dataExtents.push_back(DataExtent(extent, 0, _maxLevel.load()));
                     OE_INFO << LC << "Bounds = " << extent.toString() << std::endl;
                 }
                 else
@@ -592,7 +893,7 @@ MBTiles::Driver::open(
         {
             // Using 0 for the minLevel is not technically correct, but we use it instead of the proper minLevel to force osgEarth to subdivide
             // since we don't really handle DataExtents with minLevels > 0 just yet.
-            out_dataExtents.push_back(DataExtent(inout_profile->getExtent(), 0, _maxLevel));
+            out_dataExtents.push_back(DataExtent(inout_profile->getExtent(), 0, _maxLevel.load()));
         }
     }
 
@@ -608,6 +909,34 @@ MBTiles::Driver::open(
     unsigned char *data = _emptyImage->data(0, 0);
     memset(data, 0, 4 * size * size);
 
+    // When batching writes, a single writer thread commits many tiles per
+    // transaction. The write-ahead log and relaxed syncing keep each commit
+    // cheap; the journal mode is restored when the database closes.
+    if (readWrite && options.writeBatchSize().get() > 0u)
+    {
+        sqlite3* database = (sqlite3*)_database;
+        sqlite3_exec(database, "PRAGMA journal_mode=WAL", 0L, 0L, 0L);
+        sqlite3_exec(database, "PRAGMA synchronous=NORMAL", 0L, 0L, 0L);
+
+        _batchWriter.reset(new BatchWriter(*this, options.writeBatchSize().get()));
+
+        OE_DEBUG << LC << "Writing in batches of " << options.writeBatchSize().get() << " tiles" << std::endl;
+    }
+
+    // In read-only mode, service tile reads from a pool of connections
+    // so that concurrent readers do not serialize on a single handle.
+    // This requires an SQLite library built for multi-threaded use.
+    if (!readWrite && sqlite3_threadsafe() != 0)
+    {
+        unsigned maxConnections = options.maxReadConnections().get();
+        if (maxConnections == 0u)
+            maxConnections = std::max(std::thread::hardware_concurrency(), 1u);
+
+        _readPool.reset(new ReadConnectionPool(fullFilename, maxConnections));
+
+        OE_DEBUG << LC << "Using up to " << maxConnections << " read connections" << std::endl;
+    }
+
     return Status::OK();
 }
 
@@ -643,32 +972,38 @@ MBTiles::Driver::readMaxLevel()
     return result;
 }
 
-ReadResult
-MBTiles::Driver::read(
-    const TileKey& key,
-    ProgressCallback* progress,
-    const osgDB::Options* readOptions) const
+bool
+MBTiles::Driver::readTileData(int z, int x, int y, std::string& out_data) const
 {
-    std::lock_guard<std::mutex> exclusiveLock(_mutex);
+    if (_readPool)
+    {
+        std::string error;
+        ReadConnectionPool::Connection* conn = _readPool->take(error);
+        if (!conn)
+        {
+            OE_WARN << LC << error << std::endl;
+            return false;
+        }
 
-    int z = key.getLevelOfDetail();
-    int x = key.getTileX();
-    int y = key.getTileY();
+        sqlite3_bind_int(conn->selectTile, 1, z);
+        sqlite3_bind_int(conn->selectTile, 2, x);
+        sqlite3_bind_int(conn->selectTile, 3, y);
 
-    if (z < (int)_minLevel)
-    {
-        return ReadResult::RESULT_NOT_FOUND;
-    }
+        bool found = false;
+        if (sqlite3_step(conn->selectTile) == SQLITE_ROW)
+        {
+            // the pointer returned from _blob gets freed internally by sqlite, supposedly
+            const char* data = (const char*)sqlite3_column_blob(conn->selectTile, 0);
+            int dataLen = sqlite3_column_bytes(conn->selectTile, 0);
+            out_data.assign(data, dataLen);
+            found = true;
+        }
 
-    if (z > (int)_maxLevel)
-    {
-        //If we're at the max level, just return NULL
-        return ReadResult::RESULT_NOT_FOUND;
+        _readPool->release(conn);
+        return found;
     }
 
-    unsigned int numRows, numCols;
-    key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
-    y  = numRows - y - 1;
+    std::lock_guard<std::mutex> exclusiveLock(_mutex);
 
     sqlite3* database = (sqlite3*)_database;
 
@@ -679,24 +1014,65 @@ MBTiles::Driver::read(
     if ( rc != SQLITE_OK )
     {
         OE_WARN << LC << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database) << std::endl;
-        return ReadResult::RESULT_READER_ERROR;
+        return false;
     }
 
-    bool valid = true;
-
     sqlite3_bind_int( select, 1, z );
     sqlite3_bind_int( select, 2, x );
     sqlite3_bind_int( select, 3, y );
 
-    osg::Image* result = NULL;
+    bool found = false;
     rc = sqlite3_step( select );
     if ( rc == SQLITE_ROW)
     {
         // the pointer returned from _blob gets freed internally by sqlite, supposedly
         const char* data = (const char*)sqlite3_column_blob( select, 0 );
         int dataLen = sqlite3_column_bytes( select, 0 );
+        out_data.assign( data, dataLen );
+        found = true;
+    }
+    else
+    {
+        OE_DEBUG << LC << "SQL QUERY failed for " << query << ": " << std::endl;
+    }
 
-        std::string dataBuffer( data, dataLen );
+    sqlite3_finalize( select );
+    return found;
+}
+
+ReadResult
+MBTiles::Driver::read(
+    const TileKey& key,
+    ProgressCallback* progress,
+    const osgDB::Options* readOptions) const
+{
+    int z = key.getLevelOfDetail();
+    int x = key.getTileX();
+    int y = key.getTileY();
+
+    if (z < (int)_minLevel.load())
+    {
+        return ReadResult::RESULT_NOT_FOUND;
+    }
+
+    if (z > (int)_maxLevel.load())
+    {
+        //If we're at the max level, just return NULL
+        return ReadResult::RESULT_NOT_FOUND;
+    }
+
+    unsigned int numRows, numCols;
+    key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
+    y  = numRows - y - 1;
+
+    // Decompression and decoding happen outside of any database lock
+    // so they can proceed in parallel.
+    std::string dataBuffer;
+    osg::Image* result = NULL;
+
+    if (readTileData(z, x, y, dataBuffer))
+    {
+        bool valid = true;
 
         // decompress if necessary:
         if ( _compressor.valid() )
@@ -726,13 +1102,6 @@ MBTiles::Driver::read(
             }
         }
     }
-    else
-    {
-        OE_DEBUG << LC << "SQL QUERY failed for " << query << ": " << std::endl;
-        valid = false;
-    }
-
-    sqlite3_finalize( select );
 
     return ReadResult(result);
 }
@@ -747,8 +1116,6 @@ MBTiles::Driver::write(
     if (!key.valid() || !image)
         return Status::AssertionFailure;
 
-    std::lock_guard<std::mutex> exclusiveLock(_mutex);
-
     // encode the data stream:
     std::stringstream buf;
     osgDB::ReaderWriter::WriteResult wr;
@@ -790,16 +1157,35 @@ MBTiles::Driver::write(
     key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
     y = numRows - y - 1;
 
+    // hand off to the writer thread if batching:
+    if (_batchWriter)
+    {
+        return _batchWriter->push(z, x, y, std::move(value));
+    }
+
+    std::lock_guard<std::mutex> exclusiveLock(_mutex);
+    return insertTileData(z, x, y, value);
+}
+
+Status
+MBTiles::Driver::insertTileData(int z, int x, int y, const std::string& value)
+{
+    // Caller must hold _mutex.
+
     sqlite3* database = (sqlite3*)_database;
 
-    // Prep the insert statement:
-    sqlite3_stmt* insert = NULL;
+    // Prep the insert statement once and reuse it:
     std::string query = "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)";
-    int rc = sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L);
-    if (rc != SQLITE_OK)
+    sqlite3_stmt* insert = (sqlite3_stmt*)_insertStatement;
+    if (insert == nullptr)
     {
-        return Status(Status::GeneralError, Stringify()
-            << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        int rc = sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L);
+        if (rc != SQLITE_OK)
+        {
+            return Status(Status::GeneralError, Stringify()
+                << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        }
+        _insertStatement = insert;
     }
 
     // bind parameters:
@@ -811,12 +1197,15 @@ MBTiles::Driver::write(
     sqlite3_bind_blob(insert, 4, value.c_str(), value.length(), SQLITE_STATIC);
 
     // run the sql.
-    bool ok = true;
+    int rc;
     int tries = 0;
     do {
         rc = sqlite3_step(insert);
     } while (++tries < 100 && (rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
 
+    sqlite3_reset(insert);
+    sqlite3_clear_bindings(insert);
+
     if (SQLITE_OK != rc && SQLITE_DONE != rc)
     {
 #if SQLITE_VERSION_NUMBER >= 3007015
@@ -824,20 +1213,17 @@ MBTiles::Driver::write(
 #else
         return Status(Status::GeneralError, Stringify()<< "Failed query: " << query << "(" << rc << ")" << rc << "; " << sqlite3_errmsg(database));
 #endif
-        ok = false;
     }
 
-    sqlite3_finalize(insert);
-
     // adjust the max level if necessary
-    if (key.getLOD() > _maxLevel)
+    if ((unsigned)z > _maxLevel)
     {
-        _maxLevel = key.getLOD();
+        _maxLevel = z;
         //putMetaData("maxlevel", Stringify()<<_maxLevel);
     }
-    if (key.getLOD() < _minLevel)
+    if ((unsigned)z < _minLevel)
     {
-        _minLevel = key.getLOD();
+        _minLevel = z;
         //putMetaData("minlevel", Stringify()<<_minLevel);
     }
 
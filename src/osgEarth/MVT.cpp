@@ -25,11 +25,13 @@
 #include <osgEarth/FileUtils>
 #include <osgEarth/GeoData>
 #include <osgEarth/FeatureSource>
+#include <osgEarth/StringUtils>
 #include <osgDB/Registry>
-#include <list>
-#include <stdio.h>
-#include <stdlib.h>
-#include "vector_tile.pb.h"
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <streambuf>
 
 #include <sqlite3.h>
 
@@ -45,14 +47,6 @@ using namespace osgEarth::MVT;
 
 namespace osgEarth { namespace MVT
 {
-    // https://github.com/mapbox/mapnik-vector-tile/blob/master/examples/c%2B%2B/tileinfo.cpp
-    enum CommandType {
-        SEG_END    = 0,
-        SEG_MOVETO = 1,
-        SEG_LINETO = 2,
-        SEG_CLOSE = (0x40 | 0x0f)
-    };
-
     enum eGeomType {
         Unknown = 0,
         Point = 1,
@@ -60,69 +54,260 @@ namespace osgEarth { namespace MVT
         Polygon = 3
     };
 
-    int zig_zag_decode(int n)
+    int zig_zag_decode(std::uint32_t n)
     {
-        return (n >> 1) ^ (-(n & 1));
+        return (int)((n >> 1) ^ (~(n & 1u) + 1u));
     }
+}}
+
+namespace
+{
+    // Protobuf wire types used by the vector tile schema
+    enum WireType {
+        WIRE_VARINT = 0,
+        WIRE_FIXED64 = 1,
+        WIRE_BYTES = 2,
+        WIRE_FIXED32 = 5
+    };
 
-    Geometry* decodeLine(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
+    /**
+     * Reads protobuf fields straight out of a byte range, following
+     * https://developers.google.com/protocol-buffers/docs/encoding.
+     * Strings and sub-messages come back as readers over the same bytes,
+     * so nothing is copied until a value is actually needed. Repeated
+     * numbers are read packed, which is how vector tiles encode them.
+     */
+    class PBFReader
+    {
+    public:
+        PBFReader() : _p(nullptr), _end(nullptr) { }
+
+        PBFReader(const char* begin, const char* end) : _p(begin), _end(end) { }
+
+        //! Moves to the next field. False at the end of the data,
+        //! or if the data is malformed.
+        bool next()
+        {
+            std::uint64_t key;
+            if (empty() || !readVarint(key))
+                return false;
+            _field = (unsigned)(key >> 3);
+            _wireType = (unsigned)(key & 7u);
+            return true;
+        }
+
+        unsigned field() const { return _field; }
+        unsigned wireType() const { return _wireType; }
+
+        //! Whether all data has been read
+        bool empty() const { return _p >= _end; }
+
+        //! Whether the data turned out to be malformed
+        bool failed() const { return _failed; }
+
+        const char* data() const { return _p; }
+        std::size_t size() const { return (std::size_t)(_end - _p); }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value = 0u;
+            readVarint(value);
+            return value;
+        }
+
+        float fixed32() { float value = 0.0f; readFixed(&value, 4); return value; }
+        double fixed64() { double value = 0.0; readFixed(&value, 8); return value; }
+
+        //! Length-delimited field (a string, sub-message or packed array)
+        PBFReader bytes()
+        {
+            std::uint64_t length = 0u;
+            if (!readVarint(length) || length > size())
+            {
+                fail();
+                return PBFReader();
+            }
+            PBFReader result(_p, _p + length);
+            _p += length;
+            return result;
+        }
+
+        std::string string()
+        {
+            PBFReader r = bytes();
+            return std::string(r.data(), r.size());
+        }
+
+        //! Skips the value of the current field
+        void skip()
+        {
+            switch (_wireType)
+            {
+            case WIRE_VARINT: varint(); break;
+            case WIRE_FIXED64: readFixed(nullptr, 8); break;
+            case WIRE_BYTES: bytes(); break;
+            case WIRE_FIXED32: readFixed(nullptr, 4); break;
+            default: fail(); break;
+            }
+        }
+
+    private:
+        const char* _p;
+        const char* _end;
+        unsigned _field = 0u;
+        unsigned _wireType = 0u;
+        bool _failed = false;
+
+        bool readVarint(std::uint64_t& value)
+        {
+            value = 0u;
+            for (unsigned shift = 0u; shift < 64u && _p < _end; shift += 7u)
+            {
+                std::uint8_t b = (std::uint8_t)*_p++;
+                value |= (std::uint64_t)(b & 0x7fu) << shift;
+                if ((b & 0x80u) == 0u)
+                    return true;
+            }
+            fail();
+            return false;
+        }
+
+        void readFixed(void* value, std::size_t length)
+        {
+            if (size() < length)
+            {
+                fail();
+                return;
+            }
+            // protobuf is little-endian, like every platform we build on
+            if (value)
+                std::memcpy(value, _p, length);
+            _p += length;
+        }
+
+        void fail()
+        {
+            _failed = true;
+            _p = _end;
+        }
+    };
+
+    // Read-only stream over memory, so a compressed tile can be inflated
+    // without first being copied into a string
+    struct MemoryBuffer : public std::streambuf
+    {
+        MemoryBuffer(const char* data, std::size_t size)
+        {
+            char* p = const_cast<char*>(data);
+            setg(p, p, p + size);
+        }
+    };
+
+    // Whether the data starts with a gzip or zlib header. An uncompressed
+    // tile starts with the key of a layers field, 0x1a, which is neither.
+    bool isCompressed(const char* data, std::size_t size)
+    {
+        if (size < 2)
+            return false;
+        std::uint8_t b0 = (std::uint8_t)data[0], b1 = (std::uint8_t)data[1];
+        bool gzip = b0 == 0x1f && b1 == 0x8b;
+        bool zlib = (b0 & 0x0f) == 8 && ((b0 << 8) | b1) % 31 == 0;
+        return gzip || zlib;
+    }
+
+    bool decompress(const char* data, std::size_t size, std::string& output)
+    {
+        static osg::ref_ptr<osgDB::BaseCompressor> compressor =
+            osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+
+        if (!compressor.valid())
+            return false;
+
+        MemoryBuffer buffer(data, size);
+        std::istream in(&buffer);
+        return compressor->decompress(in, output);
+    }
+
+    bool contains(const std::vector<std::string>& names, const std::string& name)
+    {
+        for (auto& n : names)
+            if (ciEquals(n, name))
+                return true;
+        return false;
+    }
+
+    // Walks a packed geometry command stream, calling visit(cmd, x, y) for
+    // each MoveTo and LineTo vertex (in map coordinates) and each ClosePath.
+    // Returns false if the stream is malformed.
+    template<typename VISIT>
+    bool decodeCommands(PBFReader geometry, const GeoExtent& extent, unsigned int tileres, VISIT&& visit)
     {
         unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
+        unsigned int cmd = 0;
 
         int x = 0;
         int y = 0;
 
-        std::vector< osg::ref_ptr< osgEarth::LineString > > lines;
-        osg::ref_ptr< osgEarth::LineString > currentLine;
+        double width = extent.width();
+        double height = extent.height();
 
-        GeoExtent extent = key.getExtent();
-
-        for (int k = 0; k < feature.geometry_size();)
+        while (!geometry.empty())
         {
             if (!length)
             {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
+                std::uint32_t cmd_length = (std::uint32_t)geometry.varint();
+                cmd = cmd_length & ((1 << CMD_BITS) - 1);
+                length = cmd_length >> CMD_BITS;
             }
             if (length > 0)
             {
                 length--;
 
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
+                if (cmd == CMD_MOVETO || cmd == CMD_LINETO)
                 {
-                    if (cmd == SEG_MOVETO)
-                    {
-                        currentLine = new osgEarth::LineString;
-                        lines.push_back( currentLine.get() );
-                    }
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
-
-                    x += px;
-                    y += py;
-
-                    double width = extent.width();
-                    double height = extent.height();
+                    x += MVT::zig_zag_decode((std::uint32_t)geometry.varint());
+                    y += MVT::zig_zag_decode((std::uint32_t)geometry.varint());
+                    if (geometry.failed())
+                        return false;
 
                     double geoX = extent.xMin() + (width/(double)tileres) * (double)x;
                     double geoY = extent.yMax() - (height/(double)tileres) * (double)y;
-
-                    if (currentLine.valid())
-                    {
-                        currentLine->push_back(geoX, geoY, 0);
-                    }
+                    visit(cmd, geoX, geoY);
+                }
+                else if (cmd == CMD_CLOSEPATH)
+                {
+                    visit(cmd, 0.0, 0.0);
+                }
+                else
+                {
+                    // unknown command
+                    return false;
                 }
             }
         }
 
-        currentLine = 0;
+        return !geometry.failed();
+    }
+
+    Geometry* decodeLine(const PBFReader& geometry, const GeoExtent& extent, unsigned int tileres)
+    {
+        std::vector< osg::ref_ptr< osgEarth::LineString > > lines;
+        osgEarth::LineString* currentLine = nullptr;
 
-        if (lines.size() == 0)
+        bool ok = decodeCommands(geometry, extent, tileres, [&](unsigned int cmd, double x, double y)
+        {
+            if (cmd == CMD_MOVETO)
+            {
+                currentLine = new osgEarth::LineString;
+                lines.emplace_back(currentLine);
+            }
+            if (currentLine && cmd != CMD_CLOSEPATH)
+            {
+                currentLine->push_back(x, y, 0);
+            }
+        });
+
+        if (!ok || lines.size() == 0)
         {
             return 0;
         }
@@ -143,54 +328,22 @@ namespace osgEarth { namespace MVT
         }
     }
 
-    Geometry* decodePoint(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
+    Geometry* decodePoint(const PBFReader& geometry, const GeoExtent& extent, unsigned int tileres)
     {
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
-
-        int x = 0;
-        int y = 0;
-
-        osgEarth::PointSet *geometry = new osgEarth::PointSet();
-
-        GeoExtent extent = key.getExtent();
+        osg::ref_ptr<osgEarth::PointSet> points = new osgEarth::PointSet();
 
-        for (int k = 0; k < feature.geometry_size();)
+        bool ok = decodeCommands(geometry, extent, tileres, [&](unsigned int cmd, double x, double y)
         {
-            if (!length)
+            if (cmd != CMD_CLOSEPATH)
             {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
+                points->push_back(x, y, 0);
             }
-            if (length > 0)
-            {
-                length--;
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
-                {
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
-
-                    x += px;
-                    y += py;
-
-                    double width = extent.width();
-                    double height = extent.height();
+        });
 
-                    double geoX = extent.xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = extent.yMax() - (height/(double)tileres) * (double)y;
-                    geometry->push_back(geoX, geoY, 0);
-                }
-            }
-        }
-
-        return geometry;
+        return ok ? points.release() : 0;
     }
 
-    Geometry* decodePolygon(const mapnik::vector::tile_feature& feature, const  TileKey& key, unsigned int tileres)
+    Geometry* decodePolygon(const PBFReader& geometry, const GeoExtent& extent, unsigned int tileres)
     {
         /*
          https://github.com/mapbox/vector-tile-spec/tree/master/2.1
@@ -200,14 +353,6 @@ namespace osgEarth { namespace MVT
          interior ring (inner polygon of the current polygon).
          */
 
-
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
-
-        int x = 0;
-        int y = 0;
-
         // The list of polygons we've collected
         std::vector< osg::ref_ptr< osgEarth::Polygon > > polygons;
 
@@ -215,81 +360,55 @@ namespace osgEarth { namespace MVT
 
         osg::ref_ptr< osgEarth::Ring > currentRing;
 
-        GeoExtent extent = key.getExtent();
-
-        for (int k = 0; k < feature.geometry_size();)
+        bool ok = decodeCommands(geometry, extent, tileres, [&](unsigned int cmd, double x, double y)
         {
-            if (!length)
+            if (cmd == CMD_MOVETO || cmd == CMD_LINETO)
             {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
+                if (!currentRing)
+                {
+                    currentRing = new osgEarth::Ring();
+                }
+                currentRing->push_back(x, y, 0);
             }
-            if (length > 0)
+            else if (currentRing.valid())
             {
-                length--;
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
-                {
-                    if (!currentRing)
-                    {
-                        currentRing = new osgEarth::Ring();
-                    }
-
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
+                double area = currentRing->getSignedArea2D();
 
-                    x += px;
-                    y += py;
+                // Close the ring.
+                currentRing->close();
 
-                    double width = extent.width();
-                    double height = extent.height();
-
-                    double geoX = extent.xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = extent.yMax() - (height/(double)tileres) * (double)y;
-                    currentRing->push_back(geoX, geoY, 0);
+                // New polygon
+                if (area > 0)
+                {
+                    currentRing->rewind(Geometry::ORIENTATION_CCW);
+                    currentPolygon = new osgEarth::Polygon(&currentRing->asVector());
+                    polygons.push_back(currentPolygon.get());
                 }
-                else if (cmd == (SEG_CLOSE & ((1 << cmd_bits) - 1)))
-                {                    
-                    double area = currentRing->getSignedArea2D();
-
-                    // Close the ring.
-                    currentRing->close();
-
-                    // New polygon
-                    if (area > 0)
+                // Hole
+                else if (area < 0)
+                {
+                    if (currentPolygon.valid())
                     {
-                        currentRing->rewind(Geometry::ORIENTATION_CCW);
-                        currentPolygon = new osgEarth::Polygon(&currentRing->asVector());
-                        polygons.push_back(currentPolygon.get());
+                        currentRing->rewind(Geometry::ORIENTATION_CW);
+                        currentPolygon->getHoles().push_back( currentRing );
                     }
-                    // Hole
-                    else if (area < 0)
+                    else
                     {
-                        if (currentPolygon.valid())
-                        {
-                            currentRing->rewind(Geometry::ORIENTATION_CW);
-                            currentPolygon->getHoles().push_back( currentRing );
-                        }
-                        else
-                        {
-                            // this means we encountered a "hole" without a parent outer ring,
-                            // discard for now -gw
-                            OE_INFO << LC << "Discarding improperly wound polygon (hole without an outer ring)\n";
-                        }
+                        // this means we encountered a "hole" without a parent outer ring,
+                        // discard for now -gw
+                        OE_INFO << LC << "Discarding improperly wound polygon (hole without an outer ring)\n";
                     }
-
-                    // Start a new ring
-                    currentRing = 0;
                 }
+
+                // Start a new ring
+                currentRing = 0;
             }
-        }
+        });
 
         currentRing = 0;
         currentPolygon = 0;
 
-        if (polygons.size() == 0)
+        if (!ok || polygons.size() == 0)
         {
             return 0;
         }
@@ -310,154 +429,442 @@ namespace osgEarth { namespace MVT
         }
     }
 
-    bool readTile(std::istream& in, const TileKey& key, FeatureList& features)
+    // Decodes a tile value message. When more than one field is set it
+    // picks the same one the generated protobuf reader used to.
+    bool decodeValue(PBFReader message, AttributeValue& output)
     {
-        features.clear();
+        std::string stringValue;
+        float floatValue = 0.0f;
+        double doubleValue = 0.0;
+        long long intValue = 0, sintValue = 0, uintValue = 0;
+        bool boolValue = false;
+        unsigned has = 0u;
+
+        while (message.next())
+        {
+            unsigned field = message.field();
+            unsigned type = message.wireType();
+
+            if (field == 1 && type == WIRE_BYTES)
+                stringValue = message.string();
+            else if (field == 2 && type == WIRE_FIXED32)
+                floatValue = message.fixed32();
+            else if (field == 3 && type == WIRE_FIXED64)
+                doubleValue = message.fixed64();
+            else if (field == 4 && type == WIRE_VARINT)
+                intValue = (long long)message.varint();
+            else if (field == 5 && type == WIRE_VARINT)
+                uintValue = (long long)message.varint();
+            else if (field == 6 && type == WIRE_VARINT)
+            {
+                std::uint64_t n = message.varint();
+                sintValue = (long long)((n >> 1) ^ (~(n & 1u) + 1u));
+            }
+            else if (field == 7 && type == WIRE_VARINT)
+                boolValue = message.varint() != 0u;
+            else
+            {
+                message.skip();
+                continue;
+            }
 
-        // Get the compressor
-        osg::ref_ptr< osgDB::BaseCompressor> compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
-        if (!compressor.valid())
+            has |= 1u << field;
+        }
+
+        if (message.failed())
+            return false;
+
+        if (has & (1u << 7)) output.set(boolValue);
+        else if (has & (1u << 3)) output.set(doubleValue);
+        else if (has & (1u << 2)) output.set((double)floatValue);
+        else if (has & (1u << 4)) output.set(intValue);
+        else if (has & (1u << 6)) output.set(sintValue);
+        else if (has & (1u << 1)) output.set(stringValue);
+        else if (has & (1u << 5)) output.set(uintValue);
+        else return false;
+
+        return true;
+    }
+
+    // The string field of a tile value message, or an empty string
+    std::string getStringValue(PBFReader message)
+    {
+        std::string result;
+        while (message.next())
+        {
+            if (message.field() == 1 && message.wireType() == WIRE_BYTES)
+                result = message.string();
+            else
+                message.skip();
+        }
+        return result;
+    }
+
+    /**
+     * Decodes an uncompressed tile in place, one feature at a time.
+     *
+     * open() only indexes the layers the options ask for, keeping readers
+     * over their features and values. Each call to next() then decodes one
+     * feature's geometry and the attributes the options ask for. Values
+     * are decoded the first time a feature uses them and shared from then
+     * on. The tile data must outlive the decoder.
+     */
+    class TileDecoder
+    {
+    public:
+        TileDecoder(const TileKey& key, const ReadOptions& options) :
+            _options(options),
+            _extent(key.getExtent()),
+            _srs(key.getProfile()->getSRS()) { }
+
+        //! Indexes the layers in the tile; returns false if it is malformed
+        bool open(const char* data, std::size_t size)
+        {
+            PBFReader tile(data, data + size);
+            while (tile.next())
+            {
+                if (tile.field() == 3 && tile.wireType() == WIRE_BYTES)
+                {
+                    PBFReader layer = tile.bytes();
+                    if (wantLayer(layer))
+                    {
+                        _layers.emplace_back();
+                        if (!indexLayer(layer, _layers.back()))
+                            return false;
+                    }
+                }
+                else
+                {
+                    tile.skip();
+                }
+            }
+            return !tile.failed();
+        }
+
+        //! Decodes the next feature that has a geometry, or returns
+        //! nullptr after the last one.
+        osg::ref_ptr<Feature> next()
         {
+            while (_layer < _layers.size())
+            {
+                Layer& layer = _layers[_layer];
+                while (_feature < layer.features.size())
+                {
+                    osg::ref_ptr<Feature> feature = decodeFeature(layer, layer.features[_feature++]);
+                    if (feature.valid())
+                        return feature;
+                }
+                ++_layer;
+                _feature = 0u;
+            }
+            return nullptr;
+        }
+
+    private:
+        // what to read from each key
+        enum KeyUse : std::uint8_t { SKIP = 0, READ = 1, READ_HEIGHT = 2 };
+
+        // what is known about each value
+        enum ValueState : std::uint8_t { NOT_DECODED, DECODED, INVALID };
+
+        struct Layer
+        {
+            std::string name;
+            unsigned int extent = 4096;
+            std::vector<PBFReader> features;
+            std::vector<std::string> keys;
+            std::vector<std::uint8_t> keyUse;
+            std::vector<PBFReader> values;
+            std::vector<AttributeValue> decoded;
+            std::vector<std::uint8_t> state;
+        };
+
+        ReadOptions _options;
+        GeoExtent _extent;
+        osg::ref_ptr<const SpatialReference> _srs;
+        std::vector<Layer> _layers;
+        unsigned _layer = 0u;
+        unsigned _feature = 0u;
+
+        bool wantLayer(PBFReader layer) const
+        {
+            if (_options.layers.empty())
+                return true;
+
+            while (layer.next())
+            {
+                if (layer.field() == 1 && layer.wireType() == WIRE_BYTES)
+                {
+                    PBFReader name = layer.bytes();
+                    return contains(_options.layers, std::string(name.data(), name.size()));
+                }
+                layer.skip();
+            }
             return false;
         }
 
-        // Decompress the tile
-        std::string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-        in.seekg (0, std::ios::beg);
-        std::string value;
-        if (!compressor->decompress(in, value))
+        bool indexLayer(PBFReader message, Layer& layer) const
         {
-            value = original;
+            while (message.next())
+            {
+                unsigned field = message.field();
+                unsigned type = message.wireType();
+
+                if (field == 1 && type == WIRE_BYTES)
+                    layer.name = message.string();
+                else if (field == 2 && type == WIRE_BYTES)
+                    layer.features.push_back(message.bytes());
+                else if (field == 3 && type == WIRE_BYTES)
+                    layer.keys.push_back(message.string());
+                else if (field == 4 && type == WIRE_BYTES)
+                    layer.values.push_back(message.bytes());
+                else if (field == 5 && type == WIRE_VARINT)
+                    layer.extent = (unsigned int)message.varint();
+                else
+                    message.skip();
+            }
+
+            if (message.failed())
+                return false;
+
+            bool all = _options.attributes.empty();
+            bool height = all || contains(_options.attributes, "height");
+
+            layer.keyUse.resize(layer.keys.size(), SKIP);
+            for (unsigned i = 0; i < layer.keys.size(); ++i)
+            {
+                if (all || contains(_options.attributes, layer.keys[i]))
+                    layer.keyUse[i] |= READ;
+
+                // Special path for getting heights from our test dataset.
+                if (height && layer.keys[i] == "other_tags")
+                    layer.keyUse[i] |= READ_HEIGHT;
+            }
+
+            layer.decoded.resize(layer.values.size());
+            layer.state.resize(layer.values.size(), NOT_DECODED);
+            return true;
         }
 
+        const AttributeValue* getValue(Layer& layer, std::uint64_t index) const
+        {
+            if (index >= layer.values.size())
+                return nullptr;
 
-        mapnik::vector::tile tile;
+            if (layer.state[index] == NOT_DECODED)
+            {
+                bool ok = decodeValue(layer.values[index], layer.decoded[index]);
+                layer.state[index] = ok ? DECODED : INVALID;
+            }
+
+            return layer.state[index] == DECODED ? &layer.decoded[index] : nullptr;
+        }
 
-        if (tile.ParseFromString(value))
+        osg::ref_ptr<Feature> decodeFeature(Layer& layer, PBFReader message) const
         {
-            for (int i = 0; i < tile.layers().size(); i++)
+            PBFReader tags, geometry;
+            unsigned type = MVT::Unknown;
+
+            while (message.next())
             {
-                const mapnik::vector::tile_layer &layer = tile.layers().Get(i);
+                unsigned field = message.field();
+                if (field == 2 && message.wireType() == WIRE_BYTES)
+                    tags = message.bytes();
+                else if (field == 3 && message.wireType() == WIRE_VARINT)
+                    type = (unsigned)message.varint();
+                else if (field == 4 && message.wireType() == WIRE_BYTES)
+                    geometry = message.bytes();
+                else
+                    message.skip();
+            }
 
-                for (int j = 0; j < layer.features().size(); j++)
-                {
-                    const mapnik::vector::tile_feature &feature = layer.features().Get(j);
+            if (message.failed())
+                return nullptr;
 
-                    osg::ref_ptr< Feature > oeFeature = new Feature(0, key.getProfile()->getSRS());
+            // Decode the geometry first, since features without one are dropped
+            osg::ref_ptr< osgEarth::Geometry > geom;
 
-                    // Set the layer name as "mvt_layer" so we can filter it later
-                    oeFeature->set("mvt_layer", layer.name());
+            if (type == MVT::Polygon)
+            {
+                geom = decodePolygon(geometry, _extent, layer.extent);
+            }
+            else if (type == MVT::Point)
+            {
+                geom = decodePoint(geometry, _extent, layer.extent);
 
-                    // Read attributes
-                    for (int k = 0; k < feature.tags().size(); k+=2)
-                    {
-                        std::string key = layer.keys().Get(feature.tags().Get(k));
-                        mapnik::vector::tile_value value = layer.values().Get(feature.tags().Get(k+1));
+                // This is a bit of a hack, but if a point is outside of the extents we remove it.
+                // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
+                // extent.  Should probably make this an option somewhere.
+                if (geom.valid() && !_extent.contains(geom->getBounds().center()))
+                {
+                    geom = nullptr;
+                }
+            }
+            else
+            {
+                geom = decodeLine(geometry, _extent, layer.extent);
+            }
 
-                        if (value.has_bool_value())
-                        {
-                            oeFeature->set(key, value.bool_value());
-                        }
-                        else if (value.has_double_value())
-                        {
-                            oeFeature->set(key, value.double_value());
-                        }
-                        else if (value.has_float_value())
-                        {
-                            oeFeature->set(key, value.float_value());
-                        }
-                        else if (value.has_int_value())
-                        {
-                            oeFeature->set(key, (long long)value.int_value());
-                        }
-                        else if (value.has_sint_value())
-                        {
-                            oeFeature->set(key, (long long)value.sint_value());
-                        }
-                        else if (value.has_string_value())
-                        {
-                            oeFeature->set(key, value.string_value());
-                        }
-                        else if (value.has_uint_value())
-                        {
-                            oeFeature->set(key, (long long)value.uint_value());
-                        }
+            if (!geom.valid())
+                return nullptr;
 
-                        // Special path for getting heights from our test dataset.
-                        if (key == "other_tags")
-                        {
-                            std::string other_tags = value.string_value();
+            osg::ref_ptr< Feature > feature = new Feature(geom.get(), _srs.get());
 
-                            StringTokenizer tok("=>");
-                            StringVector tized;
-                            tok.tokenize(other_tags, tized);
-                            if (tized.size() == 3)
-                            {
-                                if (tized[0] == "height")
-                                {
-                                    std::string value = tized[2];
-                                    // Remove quotes from the height
-                                    float height = as<float>(value, FLT_MAX);
-                                    if (height != FLT_MAX)
-                                    {
-                                        oeFeature->set("height", height);
-                                    }
-                                }
-                            }
-                        }
-                    }
+            // Set the layer name as "mvt_layer" so we can filter it later
+            feature->set("mvt_layer", layer.name);
 
+            while (!tags.empty())
+            {
+                std::uint64_t k = tags.varint();
+                std::uint64_t v = tags.varint();
+                if (tags.failed() || k >= layer.keys.size() || layer.keyUse[k] == SKIP)
+                    continue;
 
+                const AttributeValue* value = getValue(layer, v);
+                if (!value)
+                    continue;
 
-                    osg::ref_ptr< osgEarth::Geometry > geometry;
+                if (layer.keyUse[k] & READ)
+                {
+                    feature->set(layer.keys[k], *value);
+                }
 
-                    eGeomType geomType = static_cast<eGeomType>(feature.type());
-                    if (geomType == MVT::Polygon)
-                    {
-                        geometry = decodePolygon(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::LineString)
-                    {
-                        geometry = decodeLine(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::Point)
-                    {
-                        geometry = decodePoint(feature, key, layer.extent());
+                if (layer.keyUse[k] & READ_HEIGHT)
+                {
+                    std::string other_tags = getStringValue(layer.values[v]);
 
-                        // This is a bit of a hack, but if a point is outside of the extents we remove it.
-                        // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
-                        // extent.  Should probably make this an option somewhere.
-                        if (geometry)
+                    StringTokenizer tok("=>");
+                    StringVector tized;
+                    tok.tokenize(other_tags, tized);
+                    if (tized.size() == 3)
+                    {
+                        if (tized[0] == "height")
                         {
-                            if (!key.getExtent().contains(geometry->getBounds().center()))
+                            std::string value = tized[2];
+                            // Remove quotes from the height
+                            float height = as<float>(value, FLT_MAX);
+                            if (height != FLT_MAX)
                             {
-                                geometry = NULL;
+                                feature->set("height", height);
                             }
                         }
                     }
-                    else
-                    {
-                        geometry = decodeLine(feature, key, layer.extent());
-                    }
+                }
+            }
 
-                    if (geometry)
-                    {
-                        oeFeature->setGeometry( geometry.get() );
-                        features.push_back(oeFeature.get());
-                    }
+            return feature;
+        }
+    };
 
-                }
+    /**
+     * Cursor that owns an uncompressed copy of a tile and decodes its
+     * features as they are read.
+     */
+    class TileCursor : public FeatureCursor
+    {
+    public:
+        TileCursor(const TileKey& key, const ReadOptions& options, ProgressCallback* progress) :
+            FeatureCursor(progress),
+            _decoder(key, options) { }
+
+        bool open(const char* data, std::size_t size)
+        {
+            if (isCompressed(data, size))
+            {
+                if (!decompress(data, size, _buffer))
+                    return false;
             }
+            else
+            {
+                _buffer.assign(data, size);
+            }
+
+            if (!_decoder.open(_buffer.data(), _buffer.size()))
+                return false;
+
+            _next = _decoder.next();
+            return true;
         }
-        else
+
+    public: // FeatureCursor
+
+        bool hasMore() const override
+        {
+            return _next.valid();
+        }
+
+        Feature* nextFeature() override
         {
-            OE_WARN << "Failed to parse mvt" << key.str() << std::endl;
+            _last = _next;
+
+            if (_progress.valid() && _progress->isCanceled())
+                _next = nullptr;
+            else
+                _next = _decoder.next();
+
+            return _last.get();
+        }
+
+    private:
+        std::string _buffer;
+        TileDecoder _decoder;
+        osg::ref_ptr<Feature> _next;
+        osg::ref_ptr<Feature> _last;
+    };
+}
+
+namespace osgEarth { namespace MVT
+{
+    bool readTile(std::istream& in, const TileKey& key, FeatureList& features)
+    {
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return readTile(data.data(), data.size(), key, features);
+    }
+
+    bool readTile(const char* data, std::size_t size, const TileKey& key, FeatureList& features, const ReadOptions& options)
+    {
+        features.clear();
+
+        // Decode compressed tiles out of a scratch buffer, and the
+        // others straight out of the caller's memory
+        std::string inflated;
+        if (isCompressed(data, size))
+        {
+            if (!decompress(data, size, inflated))
+            {
+                OE_WARN << LC << "Failed to decompress mvt " << key.str() << std::endl;
+                return false;
+            }
+            data = inflated.data();
+            size = inflated.size();
+        }
+
+        TileDecoder decoder(key, options);
+        if (!decoder.open(data, size))
+        {
+            OE_WARN << LC << "Failed to parse mvt " << key.str() << std::endl;
             return false;
         }
 
+        for (osg::ref_ptr<Feature> feature = decoder.next(); feature.valid(); feature = decoder.next())
+        {
+            features.emplace_back(std::move(feature));
+        }
+
         return true;
     }
 
+    FeatureCursor* createFeatureCursor(const char* data, std::size_t size, const TileKey& key, const ReadOptions& options, ProgressCallback* progress)
+    {
+        osg::ref_ptr<TileCursor> cursor = new TileCursor(key, options, progress);
+        if (!cursor->open(data, size))
+        {
+            OE_WARN << LC << "Failed to parse mvt " << key.str() << std::endl;
+            return nullptr;
+        }
+        return cursor.release();
+    }
+
 }} // namespace osgEarth::MVT
 
 //........................................................................
@@ -469,6 +876,8 @@ MVTFeatureSourceOptions::getConfig() const
     conf.set("url", url());
     conf.set("min_level", _minLevel);
     conf.set("max_level", _maxLevel);
+    conf.set("layers", layers());
+    conf.set("attributes", attributes());
     return conf;
 }
 
@@ -478,6 +887,8 @@ MVTFeatureSourceOptions::fromConfig(const Config& conf)
     conf.get("url", url());
     conf.get("min_level", _minLevel);
     conf.get("max_level", _maxLevel);
+    conf.get("layers", layers());
+    conf.get("attributes", attributes());
 }
 
 //........................................................................
@@ -529,6 +940,12 @@ MVTFeatureSource::openImplementation()
 
     setFeatureProfile(createFeatureProfile());
 
+    _readOptions = MVT::ReadOptions();
+    if (options().layers().isSet())
+        StringTokenizer(options().layers().get(), _readOptions.layers, ",", "'\"", false, true);
+    if (options().attributes().isSet())
+        StringTokenizer(options().attributes().get(), _readOptions.attributes, ",", "'\"", false, true);
+
     return Status::NoError;
 }
 
@@ -577,16 +994,15 @@ MVTFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
 
     rc = sqlite3_step(select);
 
-    FeatureList features;
+    osg::ref_ptr<FeatureCursor> cursor;
 
     if (rc == SQLITE_ROW)
     {
-        // the pointer returned from _blob gets freed internally by sqlite, supposedly
+        // the pointer returned from _blob gets freed internally by sqlite, supposedly,
+        // so the cursor keeps its own (decompressed) copy of the tile
         const char* data = (const char*)sqlite3_column_blob(select, 0);
         int dataLen = sqlite3_column_bytes(select, 0);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
-        MVT::readTile(in, key, features);
+        cursor = MVT::createFeatureCursor(data, dataLen, key, _readOptions, progress);
     }
     else
     {
@@ -613,10 +1029,9 @@ MVTFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
     }
 #endif
 
-    if (!features.empty())
+    if (cursor.valid() && cursor->hasMore())
     {
-        //OE_NOTICE << "Returning " << features.size() << " features" << std::endl;
-        return new FeatureListCursor(std::move(features));
+        return cursor.release();
     }
 
     return nullptr;
@@ -677,12 +1092,10 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
         // the pointer returned from _blob gets freed internally by sqlite, supposedly
         const char* data = (const char*)sqlite3_column_blob(select, 3);
         int dataLen = sqlite3_column_bytes(select, 3);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
 
         FeatureList features;
 
-        MVT::readTile(in, key, features);
+        MVT::readTile(data, dataLen, key, features, _readOptions);
 
         // If we have any features and we have an fid attribute, override the fid of the features
         // NOTE: FeatureSource normally does this, but we're bypassing it here... consider a refactoring...
@@ -17,6 +17,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/MemCache>
+#include <osgEarth/MemoryUtils>
+#include <algorithm>
+#include <atomic>
 
 using namespace osgEarth;
 
@@ -30,20 +33,136 @@ namespace
 {
     typedef std::pair<osg::ref_ptr<const osg::Object>, Config> MemCacheEntry;
     typedef LRUCache<std::string, MemCacheEntry> MemCacheLRU;
+    typedef ShardedLRUCache<std::string, MemCacheEntry> MemCacheShardedLRU;
 
-    struct MemCacheBin : public CacheBin
+    std::size_t sizeOf(const MemCacheEntry& entry)
     {
-        MemCacheBin( const std::string& id, unsigned maxSize )
-            : CacheBin( id, true ),
-              _lru    ( true /* MT-safe */, maxSize )
+        return sizeof(MemCacheEntry) + Util::Memory::estimateSizeInBytes(entry.first.get());
+    }
+
+    struct MemCacheBinBase : public CacheBin
+    {
+        MemCacheBinBase( const std::string& id )
+            : CacheBin( id, true ) { }
+
+        virtual CacheStats getStats() const = 0;
+
+        virtual std::size_t getSizeInBytes() const = 0;
+
+        virtual std::size_t evictBytes(std::size_t amount) = 0;
+    };
+}
+
+//------------------------------------------------------------------------
+
+/**
+ * Byte budget shared by all the bins of one MemCache.
+ */
+struct MemCache::Budget
+{
+    std::mutex _mutex;
+    std::vector<MemCacheBinBase*> _bins;
+    std::atomic<std::size_t> _maxBytes;
+
+    Budget() : _maxBytes(0u) { }
+
+    void add(MemCacheBinBase* bin)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _bins.push_back(bin);
+    }
+
+    void remove(MemCacheBinBase* bin)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _bins.erase(std::remove(_bins.begin(), _bins.end(), bin), _bins.end());
+    }
+
+    std::size_t getSizeInBytes()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::size_t total = 0u;
+        for (auto bin : _bins)
+            total += bin->getSizeInBytes();
+        return total;
+    }
+
+    void enforce()
+    {
+        std::size_t maxBytes = _maxBytes;
+        if (maxBytes == 0u)
+            return;
+
+        // If another thread is already enforcing, let it do the work.
+        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return;
+
+        std::vector<std::size_t> sizes(_bins.size());
+        std::size_t total = 0u;
+        for (unsigned i = 0; i < _bins.size(); ++i)
+            total += (sizes[i] = _bins[i]->getSizeInBytes());
+
+        if (total <= maxBytes)
+            return;
+
+        // Take the excess from each bin in proportion to its size...
+        std::size_t excess = total - maxBytes;
+        for (unsigned i = 0; i < _bins.size(); ++i)
         {
-            //nop
+            std::size_t share = (std::size_t)((double)excess * (double)sizes[i] / (double)total);
+            if (share > 0u)
+                total -= _bins[i]->evictBytes(share);
+        }
+
+        // ...then from the largest bins until we fit.
+        while (total > maxBytes)
+        {
+            MemCacheBinBase* largest = nullptr;
+            std::size_t largestSize = 0u;
+            for (auto bin : _bins)
+            {
+                std::size_t size = bin->getSizeInBytes();
+                if (size > largestSize)
+                    largest = bin, largestSize = size;
+            }
+
+            std::size_t freed = largest ? largest->evictBytes(total - maxBytes) : 0u;
+            if (freed == 0u)
+                break;
+            total -= osg::minimum(freed, total);
+        }
+    }
+};
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    template<typename LRU>
+    struct MemCacheBin : public MemCacheBinBase
+    {
+        MemCacheBin( const std::string& id, LRU* lru, std::size_t maxBytes, std::shared_ptr<MemCache::Budget> budget )
+            : MemCacheBinBase( id ),
+              _lru    ( lru ),
+              _budget ( budget )
+        {
+            _lru->setCostFunction(sizeOf);
+            _lru->setMaxCost(maxBytes);
+            if (_budget)
+                _budget->add(this);
+        }
+
+        virtual ~MemCacheBin()
+        {
+            if (_budget)
+                _budget->remove(this);
         }
 
         ReadResult readObject(const std::string& key, const osgDB::Options*)
         {
-            MemCacheLRU::Record rec;
-            _lru.get(key, rec);
+            typename LRU::Record rec;
+            _lru->get(key, rec);
 
             // clone required since the cache is in memory
 
@@ -79,10 +198,12 @@ namespace
             {
 #ifdef CLONE_DATA
                 osg::ref_ptr<const osg::Object> cloned = osg::clone(object, osg::CopyOp::DEEP_COPY_ALL);
-                _lru.insert( key, std::make_pair(cloned.get(), meta) );
+                _lru->insert( key, std::make_pair(cloned.get(), meta) );
 #else
-                _lru.insert( key, std::make_pair(object, meta) );
+                _lru->insert( key, std::make_pair(object, meta) );
 #endif
+                if (_budget)
+                    _budget->enforce();
                 return true;
             }
             else
@@ -91,26 +212,26 @@ namespace
 
         bool remove(const std::string& key)
         {
-            _lru.erase(key);
+            _lru->erase(key);
             return true;
         }
 
         bool touch(const std::string& key)
         {
             // just doing a get will put it at the front of the LRU list
-            MemCacheLRU::Record dummy;
-            return _lru.get(key, dummy);
+            typename LRU::Record dummy;
+            return _lru->get(key, dummy);
         }
 
         RecordStatus getRecordStatus( const std::string& key )
         {
             // ignore minTime; MemCache does not support expiration
-            return _lru.has(key) ? STATUS_OK : STATUS_NOT_FOUND;
+            return _lru->has(key) ? STATUS_OK : STATUS_NOT_FOUND;
         }
 
         bool purge()
         {
-            _lru.clear();
+            _lru->clear();
             return true;
         }
 
@@ -119,7 +240,23 @@ namespace
             return key;
         }
 
-        MemCacheLRU _lru;
+        CacheStats getStats() const override
+        {
+            return _lru->getStats();
+        }
+
+        std::size_t getSizeInBytes() const override
+        {
+            return _lru->getCost();
+        }
+
+        std::size_t evictBytes(std::size_t amount) override
+        {
+            return _lru->evictCost(amount);
+        }
+
+        std::unique_ptr<LRU> _lru;
+        std::shared_ptr<MemCache::Budget> _budget;
     };
     
 
@@ -128,16 +265,82 @@ namespace
 
 //------------------------------------------------------------------------
 
-MemCache::MemCache( unsigned maxBinSize ) :
-_maxBinSize( osg::maximum(maxBinSize, 1u) )
+MemCache::MemCache( unsigned maxBinSize, bool sharded ) :
+_maxBinSize( osg::maximum(maxBinSize, 1u) ),
+_sharded( sharded ),
+_maxBinSizeInBytes( 0u ),
+_budget( std::make_shared<Budget>() )
+{
+    //nop
+}
+
+MemCache::MemCache( const MemCache& rhs, const osg::CopyOp& op ) :
+Cache( rhs, op ),
+_maxBinSize( rhs._maxBinSize ),
+_sharded( rhs._sharded ),
+_maxBinSizeInBytes( rhs._maxBinSizeInBytes ),
+_budget( std::make_shared<Budget>() )
+{
+    _budget->_maxBytes = rhs.getMaxSizeInBytes();
+}
+
+MemCache::~MemCache()
 {
     //nop
 }
 
+CacheBin*
+MemCache::createBin( const std::string& binID ) const
+{
+    if ( _sharded )
+        return new MemCacheBin<MemCacheShardedLRU>(binID, new MemCacheShardedLRU(_maxBinSize), _maxBinSizeInBytes, _budget);
+    else
+        return new MemCacheBin<MemCacheLRU>(binID, new MemCacheLRU(true /* MT-safe */, _maxBinSize), _maxBinSizeInBytes, _budget);
+}
+
+void
+MemCache::setMaxSizeInBytes( std::size_t value )
+{
+    _budget->_maxBytes = value;
+    _budget->enforce();
+}
+
+std::size_t
+MemCache::getMaxSizeInBytes() const
+{
+    return _budget->_maxBytes;
+}
+
+std::size_t
+MemCache::getSizeInBytes() const
+{
+    return _budget->getSizeInBytes();
+}
+
+CacheStats
+MemCache::getStats() const
+{
+    CacheStats total(0, 0, 0, 0.0f, 0u, getMaxSizeInBytes());
+    float hits = 0.0f;
+
+    std::lock_guard<std::mutex> lock(_budget->_mutex);
+    for (auto bin : _budget->_bins)
+    {
+        CacheStats stats = bin->getStats();
+        total._entries += stats._entries;
+        total._maxEntries += stats._maxEntries;
+        total._queries += stats._queries;
+        total._cost += stats._cost;
+        hits += stats._hitRatio * (float)stats._queries;
+    }
+    total._hitRatio = total._queries > 0 ? hits / (float)total._queries : 0.0f;
+    return total;
+}
+
 CacheBin*
 MemCache::addBin( const std::string& binID )
 {
-    return _bins.getOrCreate( binID, new MemCacheBin(binID, _maxBinSize) );
+    return _bins.getOrCreate( binID, createBin(binID) );
 }
 
 CacheBin*
@@ -158,7 +361,7 @@ MemCache::getOrCreateDefaultBin()
         // double check
         if ( !_defaultBin.valid() )
         {
-            _defaultBin = new MemCacheBin("__default", _maxBinSize);
+            _defaultBin = createBin("__default");
         }
     }
 
@@ -169,7 +372,8 @@ MemCache::getOrCreateDefaultBin()
 void
 MemCache::dumpStats(const std::string& binID)
 {
-    MemCacheBin* bin = static_cast<MemCacheBin*>(getBin(binID));
-    CacheStats stats = bin->_lru.getStats();
-    OE_INFO << LC << "hit ratio = " << stats._hitRatio << std::endl;
+    MemCacheBinBase* bin = static_cast<MemCacheBinBase*>(getBin(binID));
+    CacheStats stats = bin->getStats();
+    OE_INFO << LC << "hit ratio = " << stats._hitRatio
+        << ", bytes = " << stats._cost << std::endl;
 }
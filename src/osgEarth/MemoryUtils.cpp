@@ -20,7 +20,15 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>
 */
 #include "MemoryUtils"
+#include <osgEarth/IOTypes>
+#include <osg/Image>
+#include <osg/Shape>
+#include <osg/Geometry>
+#include <osg/Texture>
+#include <osg/NodeVisitor>
+#include <unordered_set>
 
+using namespace osgEarth;
 using namespace osgEarth::Util;
 
 /*
@@ -173,3 +181,115 @@ Memory::getProcessPeakPrivateUsage()
     return (std::int64_t)0L;
 #endif
 }
+
+namespace
+{
+    // Accumulates the size of the data referenced by a scene graph.
+    struct SizeOfVisitor : public osg::NodeVisitor
+    {
+        std::size_t _bytes = 0u;
+        std::unordered_set<const osg::Referenced*> _visited;
+
+        SizeOfVisitor() : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+        {
+            setNodeMaskOverride(~0);
+        }
+
+        bool firstVisit(const osg::Referenced* object)
+        {
+            return object != nullptr && _visited.insert(object).second;
+        }
+
+        void addArray(const osg::Array* array)
+        {
+            if (firstVisit(array))
+                _bytes += array->getTotalDataSize();
+        }
+
+        void addStateSet(const osg::StateSet* stateSet)
+        {
+            if (!firstVisit(stateSet))
+                return;
+
+            for (auto& attributes : stateSet->getTextureAttributeList())
+            {
+                for (auto& attribute : attributes)
+                {
+                    const osg::Texture* texture = dynamic_cast<const osg::Texture*>(attribute.second.first.get());
+                    if (texture && firstVisit(texture))
+                    {
+                        for (unsigned i = 0; i < texture->getNumImages(); ++i)
+                        {
+                            const osg::Image* image = texture->getImage(i);
+                            if (firstVisit(image))
+                                _bytes += image->getTotalSizeInBytesIncludingMipmaps();
+                        }
+                    }
+                }
+            }
+        }
+
+        void apply(osg::Node& node) override
+        {
+            _bytes += sizeof(osg::Node);
+            addStateSet(node.getStateSet());
+            traverse(node);
+        }
+
+        void apply(osg::Drawable& drawable) override
+        {
+            _bytes += sizeof(osg::Drawable);
+            addStateSet(drawable.getStateSet());
+
+            osg::Geometry* geom = drawable.asGeometry();
+            if (geom)
+            {
+                addArray(geom->getVertexArray());
+                addArray(geom->getNormalArray());
+                addArray(geom->getColorArray());
+                addArray(geom->getSecondaryColorArray());
+                addArray(geom->getFogCoordArray());
+                for (auto& array : geom->getTexCoordArrayList())
+                    addArray(array.get());
+                for (auto& array : geom->getVertexAttribArrayList())
+                    addArray(array.get());
+
+                for (unsigned i = 0; i < geom->getNumPrimitiveSets(); ++i)
+                {
+                    const osg::DrawElements* de = geom->getPrimitiveSet(i)->getDrawElements();
+                    if (firstVisit(de))
+                        _bytes += de->getTotalDataSize();
+                }
+            }
+        }
+    };
+}
+
+std::size_t
+Memory::estimateSizeInBytes(const osg::Object* object)
+{
+    if (object == nullptr)
+        return 0u;
+
+    const osg::Image* image = dynamic_cast<const osg::Image*>(object);
+    if (image)
+        return sizeof(osg::Image) + image->getTotalSizeInBytesIncludingMipmaps();
+
+    const osg::HeightField* hf = dynamic_cast<const osg::HeightField*>(object);
+    if (hf)
+        return sizeof(osg::HeightField) + hf->getNumColumns() * hf->getNumRows() * sizeof(float);
+
+    const StringObject* str = dynamic_cast<const StringObject*>(object);
+    if (str)
+        return sizeof(StringObject) + str->getString().size();
+
+    const osg::Node* node = dynamic_cast<const osg::Node*>(object);
+    if (node)
+    {
+        SizeOfVisitor visitor;
+        const_cast<osg::Node*>(node)->accept(visitor);
+        return visitor._bytes;
+    }
+
+    return sizeof(osg::Object);
+}
@@ -0,0 +1,209 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/NegativeTileCache>
+
+using namespace osgEarth;
+
+namespace
+{
+    // ~10 bits per key and 4 probes gives about a 1% false positive rate
+    const unsigned BITS_PER_KEY = 10u;
+    const unsigned NUM_PROBES = 4u;
+
+    inline std::uint64_t mix(std::uint64_t x)
+    {
+        // splitmix64 finalizer; spreads the TileKey hash over all 64 bits
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+}
+
+NegativeTileCache::NegativeTileCache(unsigned maxSize) :
+    _maxSize(0u),
+    _revision(-1),
+    _used(false),
+    _numBits(0u),
+    _bloomInserts(0u),
+    _hits(0u),
+    _rejected(0u),
+    _falsePositives(0u)
+{
+    setMaxSize(maxSize);
+}
+
+void
+NegativeTileCache::setMaxSize(unsigned value)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    if (value != _maxSize)
+    {
+        // contains() reads the filter without the lock, so it can only
+        // be reallocated before the first query or insert.
+        OE_SOFT_ASSERT_AND_RETURN(_used == false, void(), "cannot resize a NegativeTileCache after use");
+
+        _maxSize = value;
+
+        // round up to whole words
+        std::size_t words = ((std::size_t)value * BITS_PER_KEY + 63u) / 64u;
+        _numBits = words * 64u;
+        _bits.reset(words > 0u ? new std::atomic<std::uint64_t>[words] : nullptr);
+    }
+
+    reset(_revision);
+}
+
+void
+NegativeTileCache::reset(int revision)
+{
+    // caller must hold _mutex
+    std::size_t words = _numBits / 64u;
+    for (std::size_t i = 0; i < words; ++i)
+        _bits[i].store(0u, std::memory_order_relaxed);
+
+    _bloomInserts = 0u;
+    _keys.clear();
+    _order.clear();
+    _revision = revision;
+}
+
+void
+NegativeTileCache::addToFilter(const TileKey& key)
+{
+    std::uint64_t h = mix(key.hash());
+    std::uint64_t h1 = h & 0xffffffffULL, h2 = (h >> 32) | 1u;
+
+    for (unsigned i = 0; i < NUM_PROBES; ++i)
+    {
+        std::size_t bit = (std::size_t)((h1 + i * h2) % _numBits);
+        _bits[bit / 64u].fetch_or(1ULL << (bit % 64u), std::memory_order_relaxed);
+    }
+    ++_bloomInserts;
+}
+
+bool
+NegativeTileCache::mayContain(const TileKey& key) const
+{
+    std::uint64_t h = mix(key.hash());
+    std::uint64_t h1 = h & 0xffffffffULL, h2 = (h >> 32) | 1u;
+
+    for (unsigned i = 0; i < NUM_PROBES; ++i)
+    {
+        std::size_t bit = (std::size_t)((h1 + i * h2) % _numBits);
+        if ((_bits[bit / 64u].load(std::memory_order_relaxed) & (1ULL << (bit % 64u))) == 0u)
+            return false;
+    }
+    return true;
+}
+
+bool
+NegativeTileCache::contains(const TileKey& key, int revision) const
+{
+    if (!_used.load(std::memory_order_relaxed))
+        _used = true;
+
+    if (_maxSize == 0u || revision != _revision || !key.valid())
+        return false;
+
+    if (!mayContain(key))
+    {
+        ++_rejected;
+        return false;
+    }
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    if (revision == _revision && _keys.find(key) != _keys.end())
+    {
+        ++_hits;
+        return true;
+    }
+
+    ++_falsePositives;
+    return false;
+}
+
+void
+NegativeTileCache::insert(const TileKey& key, int revision)
+{
+    if (!_used.load(std::memory_order_relaxed))
+        _used = true;
+
+    if (_maxSize == 0u || !key.valid())
+        return;
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    if (revision != _revision)
+    {
+        reset(revision);
+    }
+
+    if (_keys.insert(key).second == false)
+        return;
+
+    _order.push_back(key);
+
+    // bounded: forget the oldest key
+    if (_order.size() > _maxSize)
+    {
+        _keys.erase(_order.front());
+        _order.pop_front();
+    }
+
+    // Evicted keys leave their bits behind. Once the filter has seen
+    // twice its capacity, rebuild it from the keys still in the set.
+    if (_bloomInserts >= 2u * _maxSize)
+    {
+        std::size_t words = _numBits / 64u;
+        for (std::size_t i = 0; i < words; ++i)
+            _bits[i].store(0u, std::memory_order_relaxed);
+
+        _bloomInserts = 0u;
+        for (auto& k : _order)
+            addToFilter(k);
+    }
+    else
+    {
+        addToFilter(key);
+    }
+}
+
+void
+NegativeTileCache::clear()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    reset(_revision);
+}
+
+NegativeTileCache::Stats
+NegativeTileCache::getStats() const
+{
+    Stats stats;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        stats.entries = (unsigned)_keys.size();
+    }
+    stats.hits = _hits;
+    stats.rejected = _rejected;
+    stats.falsePositives = _falsePositives;
+    return stats;
+}
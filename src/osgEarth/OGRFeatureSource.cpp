@@ -24,8 +24,10 @@
 
 #include <osgEarth/Registry>
 #include <osgEarth/StringUtils>
+#include <osgEarth/Threading>
 
 #include <gdal.h>
+#include <algorithm>
 #include <queue>
 #include <list>
 
@@ -80,10 +82,164 @@ namespace osgEarth { namespace OGR
         }
         return true;
     }
+
+    // Total thread count of the job pools, i.e. how many threads
+    // could be running queries at once.
+    unsigned getJobThreadCount()
+    {
+        unsigned count = 0u;
+        for (auto pool : jobs::get_metrics()->all())
+            count += pool->concurrency;
+        return count;
+    }
 } }
 
 //........................................................................
 
+const std::chrono::seconds OGR::DatasetPool::idleTimeout(30);
+
+OGR::DatasetPool::DatasetPool(const std::string& source, const std::string& layer) :
+    _source(source),
+    _layer(layer),
+    _maxIdle(getJobThreadCount() + 1u),
+    _closed(false)
+{
+    //nop
+}
+
+OGR::DatasetPool::~DatasetPool()
+{
+    close();
+}
+
+void
+OGR::DatasetPool::removeExpired(std::vector<Handle>& expired)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    // the idle list is oldest first
+    auto keep = std::find_if(_idle.begin(), _idle.end(), [&](const Handle& h) {
+        return now - h.lastUsed < idleTimeout; });
+
+    if ((std::size_t)(_idle.end() - keep) > _maxIdle)
+        keep = _idle.end() - _maxIdle;
+
+    expired.insert(expired.end(), _idle.begin(), keep);
+    _idle.erase(_idle.begin(), keep);
+}
+
+bool
+OGR::DatasetPool::checkout(Handle& handle)
+{
+    // close handles outside the lock
+    std::vector<Handle> expired;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        removeExpired(expired);
+
+        if (!_idle.empty())
+        {
+            // prefer the most recent handle this thread returned, then the most recent one
+            auto i = std::find_if(_idle.rbegin(), _idle.rend(), [](const Handle& h) {
+                return h.thread == std::this_thread::get_id(); });
+
+            auto pick = i != _idle.rend() ? std::prev(i.base()) : std::prev(_idle.end());
+            handle = *pick;
+            _idle.erase(pick);
+            found = true;
+        }
+    }
+
+    for (auto& h : expired)
+    {
+        OGRReleaseDataSource(h.ds);
+    }
+
+    if (found)
+        return true;
+
+    // Each handle may only be used by one thread at a time, so open a new one.
+    handle = Handle();
+    handle.ds = GDALOpenEx(
+        _source.c_str(),
+        GDAL_OF_VECTOR | GDAL_OF_READONLY,
+        nullptr,
+        nullptr,
+        nullptr);
+
+    if (handle.ds)
+    {
+        handle.layer = openLayer(handle.ds, _layer);
+    }
+
+    if (!handle.layer)
+    {
+        if (handle.ds)
+        {
+            OGRReleaseDataSource(handle.ds);
+        }
+        handle = Handle();
+        return false;
+    }
+
+    return true;
+}
+
+void
+OGR::DatasetPool::checkin(Handle& handle)
+{
+    if (!handle.ds)
+        return;
+
+    // clear any state the query left on the layer
+    OGR_L_SetSpatialFilter(handle.layer, nullptr);
+    OGR_L_SetAttributeFilter(handle.layer, nullptr);
+    OGR_L_ResetReading(handle.layer);
+
+    handle.thread = std::this_thread::get_id();
+    handle.lastUsed = std::chrono::steady_clock::now();
+
+    // close handles outside the lock
+    std::vector<Handle> expired;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_closed)
+            expired.push_back(handle);
+        else
+            _idle.push_back(handle);
+
+        removeExpired(expired);
+    }
+
+    for (auto& h : expired)
+    {
+        OGRReleaseDataSource(h.ds);
+    }
+
+    handle = Handle();
+}
+
+void
+OGR::DatasetPool::close()
+{
+    std::vector<Handle> handles;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        handles.swap(_idle);
+    }
+
+    for (auto& h : handles)
+    {
+        OGRReleaseDataSource(h.ds);
+    }
+}
+
+//........................................................................
+
 OGR::OGRFeatureCursor::OGRFeatureCursor(
     OGRDataSourceH dsHandle,
     OGRLayerH layerHandle,
@@ -93,12 +249,14 @@ OGR::OGRFeatureCursor::OGRFeatureCursor(
     const FeatureFilterChain& filters,
     bool rewindPolygons,
     unsigned chunkSize,
-    ProgressCallback* progress) :
+    ProgressCallback* progress,
+    DatasetPool* pool) :
 
     FeatureCursor(progress),
     _source(source),
     _dsHandle(dsHandle),
     _layerHandle(layerHandle),
+    _pool(pool),
     _resultSetHandle(0L),
     _spatialFilter(0L),
     _query(query),
@@ -231,7 +389,19 @@ OGR::OGRFeatureCursor::~OGRFeatureCursor()
         OGR_G_DestroyGeometry( _spatialFilter );
 
     if ( _dsHandle )
-        OGRReleaseDataSource( _dsHandle );
+    {
+        if ( _pool.valid() )
+        {
+            DatasetPool::Handle handle;
+            handle.ds = _dsHandle;
+            handle.layer = _layerHandle;
+            _pool->checkin( handle );
+        }
+        else
+        {
+            OGRReleaseDataSource( _dsHandle );
+        }
+    }
 }
 
 bool
@@ -428,6 +598,12 @@ OGRFeatureSource::closeImplementation()
         _dsHandle = 0L;
     }
 
+    if (_pool.valid())
+    {
+        _pool->close();
+        _pool = nullptr;
+    }
+
     init();
 
     return FeatureSource::closeImplementation();
@@ -633,6 +809,12 @@ OGRFeatureSource::openImplementation()
         // establish the feature schema:
         initSchema();
 
+        // read-only cursors share a pool of handles
+        if (!_writable)
+        {
+            _pool = new OGR::DatasetPool(_source, options().layer().get());
+        }
+
         // establish the geometry type for this feature layer:
         OGRwkbGeometryType wkbType = OGR_FD_GetGeomType(OGR_L_GetLayerDefn(_layerHandle));
         if (
@@ -854,20 +1036,31 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
             nullptr
         };
 
-        dsHandle = GDALOpenEx(
-            _source.c_str(),
-            GDAL_OF_VECTOR | GDAL_OF_READONLY,
-            nullptr,
-            nullptr, //openOptions,
-            nullptr);
-
-        // open the handles safely:
         // Each cursor requires its own DS handle so that multi-threaded access will work.
-        // The cursor impl will dispose of the new DS handle.
-        //dsHandle = OGROpenShared(_source.c_str(), 0, &_ogrDriverHandle);
-        if (dsHandle)
+        // A read-only source lends one from its pool; the cursor returns it when done.
+        OGR::DatasetPool::Handle pooled;
+        if (_pool.valid() && _pool->checkout(pooled))
         {
-            layerHandle = OGR::openLayer(dsHandle, options().layer().get());
+            dsHandle = pooled.ds;
+            layerHandle = pooled.layer;
+        }
+
+        else if (!_pool.valid())
+        {
+            dsHandle = GDALOpenEx(
+                _source.c_str(),
+                GDAL_OF_VECTOR | GDAL_OF_READONLY,
+                nullptr,
+                nullptr, //openOptions,
+                nullptr);
+
+            // open the handles safely:
+            // The cursor impl will dispose of the new DS handle.
+            //dsHandle = OGROpenShared(_source.c_str(), 0, &_ogrDriverHandle);
+            if (dsHandle)
+            {
+                layerHandle = OGR::openLayer(dsHandle, options().layer().get());
+            }
         }
 
         if (dsHandle && layerHandle)
@@ -890,7 +1083,8 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
                 getFilters(),
                 _options->rewindPolygons().get(),
                 0, // default chunksize
-                progress
+                progress,
+                _pool.get()
                 );
         }
         else
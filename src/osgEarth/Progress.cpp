@@ -18,6 +18,7 @@
  */
 
 #include <osgEarth/Progress>
+#include <osg/Math>
 
 using namespace osgEarth;
 
@@ -73,6 +74,18 @@ ProgressCallback::canceled() const
     return _canceled;
 }
 
+void
+ProgressCallback::merge(const ProgressCallback* child)
+{
+    if (child && child != this && child->_canceled)
+    {
+        _canceled = true;
+        _retryDelay_s = osg::maximum(_retryDelay_s, child->getRetryDelay());
+        if (_message.empty())
+            _message = child->message();
+    }
+}
+
 void ProgressCallback::reportError(const std::string& msg)
 {
     _message = msg;
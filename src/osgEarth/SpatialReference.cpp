@@ -24,6 +24,7 @@
 #include <osgEarth/Math>
 #include <ogr_spatialref.h>
 #include <cpl_conv.h>
+#include <cmath>
 
 #define LC "[SpatialReference] "
 
@@ -72,6 +73,189 @@ namespace
             minX, minY, 0.0, 1.0);
         return transform;
     }
+
+    // Built-in kernels for the most common transforms. Each projection
+    // converts one point to or from geographic WGS84 (degrees) and returns
+    // false, leaving the point alone, for input it does not handle so the
+    // caller can hand that point to OGR instead.
+
+    const double WGS84_A = 6378137.0;
+    const double WGS84_F = 1.0 / 298.257223563;
+
+    // UTM limits, well inside the range where the series is accurate
+    const double UTM_MAX_DELTA_LON = osg::DegreesToRadians(30.0);
+    const double UTM_MAX_EASTING_OFFSET = 3500000.0;
+
+    inline double normalizeRadians(double a)
+    {
+        while (a > osg::PI) a -= 2.0*osg::PI;
+        while (a < -osg::PI) a += 2.0*osg::PI;
+        return a;
+    }
+
+    struct GeographicKernel
+    {
+        inline bool toGeographic(double& x, double& y) const {
+            return std::isfinite(x) && std::abs(y) <= 90.0;
+        }
+        inline bool fromGeographic(double& x, double& y) const {
+            return true;
+        }
+    };
+
+    // EPSG:3857 and friends: spherical equations on WGS84 coordinates
+    struct SphericalMercatorKernel
+    {
+        inline bool toGeographic(double& x, double& y) const {
+            if (!(std::abs(x) <= osg::PI*WGS84_A*(1.0 + 1e-12)) || !std::isfinite(y))
+                return false;
+            x = osg::RadiansToDegrees(x / WGS84_A);
+            y = osg::RadiansToDegrees(std::atan(std::sinh(y / WGS84_A)));
+            return true;
+        }
+        inline bool fromGeographic(double& x, double& y) const {
+            if (!(std::abs(x) <= 180.0) || !(std::abs(y) < 90.0))
+                return false;
+            x = WGS84_A * osg::DegreesToRadians(x);
+            y = WGS84_A * std::log(std::tan(0.25*osg::PI + 0.5*osg::DegreesToRadians(y)));
+            return true;
+        }
+    };
+
+    // Series coefficients for the ellipsoidal transverse mercator, to n^6.
+    // C.F.F. Karney, "Transverse Mercator with an accuracy of a few nanometers",
+    // J. Geodesy 85(8), 2011. PROJ uses the same series, so results agree with
+    // OGR to well under a millimeter.
+    struct TransverseMercatorSeries
+    {
+        double e, e2m, A;
+        double alpha[7], beta[7];
+
+        TransverseMercatorSeries()
+        {
+            const double f = WGS84_F;
+            const double n = f / (2.0 - f), n2 = n*n, n3 = n2*n, n4 = n3*n, n5 = n4*n, n6 = n5*n;
+            e = std::sqrt(f*(2.0 - f));
+            e2m = 1.0 - e*e;
+            A = WGS84_A / (1.0 + n) * (1.0 + n2/4.0 + n4/64.0 + n6/256.0);
+
+            alpha[0] = 0.0;
+            alpha[1] = n/2.0 - 2.0*n2/3.0 + 5.0*n3/16.0 + 41.0*n4/180.0 - 127.0*n5/288.0 + 7891.0*n6/37800.0;
+            alpha[2] = 13.0*n2/48.0 - 3.0*n3/5.0 + 557.0*n4/1440.0 + 281.0*n5/630.0 - 1983433.0*n6/1935360.0;
+            alpha[3] = 61.0*n3/240.0 - 103.0*n4/140.0 + 15061.0*n5/26880.0 + 167603.0*n6/181440.0;
+            alpha[4] = 49561.0*n4/161280.0 - 179.0*n5/168.0 + 6601661.0*n6/7257600.0;
+            alpha[5] = 34729.0*n5/80640.0 - 3418889.0*n6/1995840.0;
+            alpha[6] = 212378941.0*n6/319334400.0;
+
+            beta[0] = 0.0;
+            beta[1] = n/2.0 - 2.0*n2/3.0 + 37.0*n3/96.0 - n4/360.0 - 81.0*n5/512.0 + 96199.0*n6/604800.0;
+            beta[2] = n2/48.0 + n3/15.0 - 437.0*n4/1440.0 + 46.0*n5/105.0 - 1118711.0*n6/3870720.0;
+            beta[3] = 17.0*n3/480.0 - 37.0*n4/840.0 - 209.0*n5/4480.0 + 5569.0*n6/90720.0;
+            beta[4] = 4397.0*n4/161280.0 - 11.0*n5/504.0 - 830251.0*n6/7257600.0;
+            beta[5] = 4583.0*n5/161280.0 - 108847.0*n6/3991680.0;
+            beta[6] = 20648693.0*n6/638668800.0;
+        }
+    };
+
+    const TransverseMercatorSeries& getTransverseMercatorSeries()
+    {
+        static const TransverseMercatorSeries series;
+        return series;
+    }
+
+    struct UTMKernel
+    {
+        const TransverseMercatorSeries& tm;
+        double lon0, k0A, falseNorthing;
+
+        UTMKernel(int zone, bool south) :
+            tm(getTransverseMercatorSeries()),
+            lon0(osg::DegreesToRadians(zone*6.0 - 183.0)),
+            k0A(0.9996 * getTransverseMercatorSeries().A),
+            falseNorthing(south ? 10000000.0 : 0.0) { }
+
+        // conformal latitude (as a tangent) from geodetic latitude
+        inline double tauPrime(double tau) const {
+            double t1 = std::sqrt(1.0 + tau*tau);
+            double sig = std::sinh(tm.e * std::atanh(tm.e * tau / t1));
+            return tau*std::sqrt(1.0 + sig*sig) - sig*t1;
+        }
+
+        inline bool fromGeographic(double& x, double& y) const {
+            if (!std::isfinite(x) || !(std::abs(y) < 90.0))
+                return false;
+
+            double lam = normalizeRadians(osg::DegreesToRadians(x) - lon0);
+            if (std::abs(lam) > UTM_MAX_DELTA_LON)
+                return false;
+
+            double taup = tauPrime(std::tan(osg::DegreesToRadians(y)));
+            double cl = std::cos(lam), sl = std::sin(lam);
+            double xip = std::atan2(taup, cl);
+            double etap = std::asinh(sl / std::sqrt(taup*taup + cl*cl));
+
+            double xi = xip, eta = etap;
+            for (int j = 1; j <= 6; ++j)
+            {
+                xi += tm.alpha[j] * std::sin(2.0*j*xip) * std::cosh(2.0*j*etap);
+                eta += tm.alpha[j] * std::cos(2.0*j*xip) * std::sinh(2.0*j*etap);
+            }
+
+            x = 500000.0 + k0A*eta;
+            y = falseNorthing + k0A*xi;
+            return true;
+        }
+
+        inline bool toGeographic(double& x, double& y) const {
+            if (!(std::abs(x - 500000.0) <= UTM_MAX_EASTING_OFFSET) || !std::isfinite(y))
+                return false;
+
+            double xi = (y - falseNorthing) / k0A, eta = (x - 500000.0) / k0A;
+            double xip = xi, etap = eta;
+            for (int j = 1; j <= 6; ++j)
+            {
+                xip -= tm.beta[j] * std::sin(2.0*j*xi) * std::cosh(2.0*j*eta);
+                etap -= tm.beta[j] * std::cos(2.0*j*xi) * std::sinh(2.0*j*eta);
+            }
+
+            double s = std::sinh(etap), c = std::cos(xip);
+            double r = std::hypot(s, c);
+            if (r < 1e-12) // at a pole
+                return false;
+
+            double taup = std::sin(xip) / r;
+
+            // invert tauPrime with Newton's method; converges in 2 or 3 steps
+            double tau = taup / tm.e2m;
+            for (int i = 0; i < 5; ++i)
+            {
+                double t1 = std::sqrt(1.0 + tau*tau);
+                double taui = tauPrime(tau);
+                double dtau = (taup - taui) / std::sqrt(1.0 + taui*taui) *
+                    (1.0 + tm.e2m*tau*tau) / (tm.e2m*t1);
+                tau += dtau;
+                if (std::abs(dtau) < 1e-14 * std::max(1.0, std::abs(tau)))
+                    break;
+            }
+
+            x = osg::RadiansToDegrees(normalizeRadians(lon0 + std::atan2(s, c)));
+            y = osg::RadiansToDegrees(std::atan(tau));
+            return true;
+        }
+    };
+
+    template<typename FROM, typename TO>
+    unsigned runKernels(const FROM& from, const TO& to, double* x, double* y, unsigned count)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            double px = x[i], py = y[i];
+            if (!from.toGeographic(px, py) || !to.fromGeographic(px, py))
+                return i;
+            x[i] = px, y[i] = py;
+        }
+        return count;
+    }
 }
 
 //------------------------------------------------------------------------
@@ -641,6 +825,12 @@ SpatialReference::getGeocentricSRS() const
                     Key key(std::string(wktbuf), ""); // to vdatum in ECEF
                     _geocentric_srs = new SpatialReference(key);
                     _geocentric_srs->_domain = GEOCENTRIC;
+
+                    // init() saw the geographic definition; ECEF on WGS84
+                    // has a kernel of its own
+                    _geocentric_srs->_native.type =
+                        _geocentric_srs->_native.type == NativeProjection::GEOGRAPHIC ?
+                        NativeProjection::GEOCENTRIC : NativeProjection::NONE;
                     CPLFree(wktbuf);
                 }
             }
@@ -903,7 +1093,12 @@ SpatialReference::transform(std::vector<osg::Vec3d>& points,
         y[i] = points[i].y();
     }
 
-    success = inputSRS->transformXYPointArrays( local, x, y, count, outputSRS );
+    // common pairs have built-in kernels; OGR finishes whatever they can't handle
+    unsigned done = transformNative( inputSRS->_native, outputSRS->_native, x, y, count );
+
+    success =
+        done == count ||
+        inputSRS->transformXYPointArrays( local, x + done, y + done, count - done, outputSRS );
 
     if ( success )
     {
@@ -945,6 +1140,103 @@ SpatialReference::transform(std::vector<osg::Vec3d>& points,
 }
 
 
+bool
+SpatialReference::transformArrays(double*                 x,
+                                  double*                 y,
+                                  double*                 z,
+                                  unsigned                count,
+                                  const SpatialReference* outputSRS) const
+{
+    OE_SOFT_ASSERT_AND_RETURN(outputSRS!=nullptr, false);
+    OE_SOFT_ASSERT_AND_RETURN(x!=nullptr && y!=nullptr, false);
+
+    if (!valid())
+        return false;
+
+    if ( count == 0u || isEquivalentTo(outputSRS) )
+        return true;
+
+    const bool fromECEF = _native.type == NativeProjection::GEOCENTRIC;
+    const bool toECEF = outputSRS->_native.type == NativeProjection::GEOCENTRIC;
+
+    // ECEF on one side and a kernel on the other: convert between ECEF and
+    // geographic WGS84 with the ellipsoid, and let the other kernel do the rest
+    if (fromECEF != toECEF &&
+        z != nullptr &&
+        _native.type != NativeProjection::NONE &&
+        outputSRS->_native.type != NativeProjection::NONE &&
+        _vdatum.get() == outputSRS->getVerticalDatum())
+    {
+        if (fromECEF)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                osg::Vec3d lla = _ellipsoid.geocentricToGeodetic(osg::Vec3d(x[i], y[i], z[i]));
+                x[i] = lla.x(), y[i] = lla.y(), z[i] = lla.z();
+            }
+            return getGeodeticSRS()->transformArrays(x, y, z, count, outputSRS);
+        }
+        else
+        {
+            const SpatialReference* outputGeoSRS = outputSRS->getGeodeticSRS();
+            if (!transformArrays(x, y, z, count, outputGeoSRS))
+                return false;
+
+            const Ellipsoid& ellipsoid = outputSRS->getEllipsoid();
+            for (unsigned i = 0; i < count; ++i)
+            {
+                osg::Vec3d xyz = ellipsoid.geodeticToGeocentric(osg::Vec3d(x[i], y[i], z[i]));
+                x[i] = xyz.x(), y[i] = xyz.y(), z[i] = xyz.z();
+            }
+            return true;
+        }
+    }
+
+    // both sides have kernels and Z is unaffected: work on the arrays directly
+    if (_native.type != NativeProjection::NONE &&
+        outputSRS->_native.type != NativeProjection::NONE &&
+        !fromECEF && !toECEF &&
+        _vdatum.get() == outputSRS->getVerticalDatum())
+    {
+        unsigned done = transformNative( _native, outputSRS->_native, x, y, count );
+
+        if (done < count &&
+            !transformXYPointArrays( getLocal(), x + done, y + done, count - done, outputSRS ))
+        {
+            return false;
+        }
+
+        // same clamp as transform()
+        if ( isProjected() && outputSRS->isGeographic() )
+        {
+            for( unsigned i=0; i<count; i++ )
+            {
+                x[i] = osg::clampBetween( x[i], -180.0, 180.0 );
+                y[i] = osg::clampBetween( y[i],  -90.0,  90.0 );
+            }
+        }
+        return true;
+    }
+
+    std::vector<osg::Vec3d> points(count);
+    for( unsigned i=0; i<count; i++ )
+    {
+        points[i].set( x[i], y[i], z ? z[i] : 0.0 );
+    }
+
+    if ( !transform(points, outputSRS) )
+        return false;
+
+    for( unsigned i=0; i<count; i++ )
+    {
+        x[i] = points[i].x();
+        y[i] = points[i].y();
+        if (z) z[i] = points[i].z();
+    }
+    return true;
+}
+
+
 bool 
 SpatialReference::transform2D(double x, double y,
                               const SpatialReference* outputSRS,
@@ -1013,6 +1305,42 @@ SpatialReference::transformXYPointArrays(
 }
 
 
+unsigned
+SpatialReference::transformNative(const NativeProjection& from,
+                                  const NativeProjection& to,
+                                  double*  x,
+                                  double*  y,
+                                  unsigned count)
+{
+    auto run = [&](const auto& fromKernel) -> unsigned
+    {
+        switch (to.type)
+        {
+        case NativeProjection::GEOGRAPHIC:
+            return runKernels(fromKernel, GeographicKernel(), x, y, count);
+        case NativeProjection::SPHERICAL_MERCATOR:
+            return runKernels(fromKernel, SphericalMercatorKernel(), x, y, count);
+        case NativeProjection::UTM:
+            return runKernels(fromKernel, UTMKernel(to.zone, to.south), x, y, count);
+        default:
+            return 0u;
+        }
+    };
+
+    switch (from.type)
+    {
+    case NativeProjection::GEOGRAPHIC:
+        return run(GeographicKernel());
+    case NativeProjection::SPHERICAL_MERCATOR:
+        return run(SphericalMercatorKernel());
+    case NativeProjection::UTM:
+        return run(UTMKernel(from.zone, from.south));
+    default:
+        return 0u;
+    }
+}
+
+
 bool
 SpatialReference::transformZ(std::vector<osg::Vec3d>& points,
                              const SpatialReference*  outputSRS,
@@ -1506,6 +1834,101 @@ SpatialReference::init()
         }
     }
 
+    // Recognize the definitions the built-in transform kernels support.
+    // Anything with extra parameters (axis order, prime meridian, datum
+    // shift, scaled units, ...) stays with OGR.
+    _native = NativeProjection();
+    if ( !_is_user_defined && !_is_cube && !_is_ltp && !isGeocentric() && !_proj4.empty() )
+    {
+        StringVector tokens;
+        StringTokenizer(_proj4, tokens, " \t\r\n", "", false, true);
+
+        StringTable params;
+        for (auto& token : tokens)
+        {
+            std::string::size_type eq = token.find('=');
+            params[token.substr(0, eq)] = eq != std::string::npos ? token.substr(eq + 1) : "";
+        }
+
+        auto param = [&](const std::string& name) {
+            auto i = params.find(name);
+            return i != params.end() ? i->second : std::string();
+        };
+        auto number = [&](const std::string& name, double defaultValue) {
+            auto i = params.find(name);
+            return i != params.end() ? as<double>(i->second, -DBL_MAX) : defaultValue;
+        };
+        auto onlyHas = [&](const std::set<std::string>& allowed) {
+            for (auto& p : params)
+                if (allowed.count(p.first) == 0)
+                    return false;
+            return true;
+        };
+
+        bool noDatumShift = true;
+        if (params.count("+towgs84"))
+        {
+            StringVector shift;
+            StringTokenizer(param("+towgs84"), shift, ",", "", false, true);
+            for (auto& value : shift)
+                noDatumShift = noDatumShift && as<double>(value, -1.0) == 0.0;
+        }
+
+        bool wgs84 =
+            (param("+datum") == "WGS84" || param("+ellps") == "WGS84") &&
+            (params.count("+datum") == 0 || param("+datum") == "WGS84") &&
+            (params.count("+ellps") == 0 || param("+ellps") == "WGS84") &&
+            noDatumShift;
+
+        const std::string proj = param("+proj");
+
+        if (isGeographic() &&
+            (proj == "longlat" || proj == "latlong") &&
+            wgs84 &&
+            osg::equivalent(unitMultiplier, osg::DegreesToRadians(1.0)) &&
+            onlyHas({ "+proj", "+datum", "+ellps", "+towgs84", "+no_defs", "+wktext", "+type" }))
+        {
+            _native.type = NativeProjection::GEOGRAPHIC;
+        }
+
+        else if (
+            _is_spherical_mercator &&
+            (proj == "merc" || proj == "webmerc") &&
+            number("+a", number("+R", 0.0)) == WGS84_A &&
+            number("+b", number("+R", 0.0)) == WGS84_A &&
+            number("+lat_ts", 0.0) == 0.0 &&
+            number("+lon_0", 0.0) == 0.0 &&
+            number("+x_0", 0.0) == 0.0 &&
+            number("+y_0", 0.0) == 0.0 &&
+            number("+k", number("+k_0", 1.0)) == 1.0 &&
+            param("+units") == "m" &&
+            _reportedLinearUnits == 1.0 &&
+            (params.count("+nadgrids") == 0 || param("+nadgrids") == "@null") &&
+            noDatumShift &&
+            onlyHas({ "+proj", "+a", "+b", "+R", "+lat_ts", "+lon_0", "+x_0", "+y_0", "+k", "+k_0",
+                      "+units", "+nadgrids", "+towgs84", "+no_defs", "+wktext", "+type" }))
+        {
+            _native.type = NativeProjection::SPHERICAL_MERCATOR;
+        }
+
+        else if (
+            proj == "utm" &&
+            wgs84 &&
+            param("+units") == "m" &&
+            _reportedLinearUnits == 1.0 &&
+            onlyHas({ "+proj", "+zone", "+south", "+datum", "+ellps", "+towgs84", "+units",
+                      "+no_defs", "+wktext", "+type" }))
+        {
+            int zone = as<int>(param("+zone"), 0);
+            if (zone >= 1 && zone <= 60)
+            {
+                _native.type = NativeProjection::UTM;
+                _native.zone = zone;
+                _native.south = params.count("+south") > 0;
+            }
+        }
+    }
+
     // Build a 'normalized' initialization key.
     if ( !_proj4.empty() )
     {
@@ -27,6 +27,7 @@
 
 #include <osg/Texture2D>
 #include <osg/Texture2DArray>
+#include <algorithm>
 
 #define LC "[TerrainTileModelFactory] "
 
@@ -137,10 +138,28 @@ void CreateTileManifest::setProgressive(bool value)
 
 //.........................................................................
 
+namespace
+{
+    // Pool for the per-layer fetches of a single tile. The loader thread
+    // building the tile works through its own fetches too, so the pool
+    // only adds concurrency and a busy pool never stalls a tile.
+    jobs::jobpool* getFetchPool()
+    {
+        return jobs::get_pool("oe.tilemodel");
+    }
+
+    bool canceled(ProgressCallback* progress)
+    {
+        return progress && progress->isCanceled();
+    }
+}
+
 TerrainTileModelFactory::TerrainTileModelFactory(const TerrainOptions& options) :
     _options(options)
 {
-    //nop
+    // at least one fetch thread per tile loader
+    jobs::jobpool* pool = getFetchPool();
+    pool->set_concurrency(std::max(pool->concurrency(), _options.concurrency().value()));
 }
 
 TerrainTileModel*
@@ -158,29 +177,62 @@ TerrainTileModelFactory::createTileModel(
         key,
         map->getDataModelRevision() );
 
-    // assemble all the components:
-    addColorLayers(model.get(), map, require, key, manifest, progress, false);
+    // assemble all the components. Each one writes to its own part of
+    // the model, so they load concurrently and the tile is ready as soon
+    // as the slowest one is.
+    std::vector<std::function<void(ProgressCallback*)>> components;
+
+    components.emplace_back([&](ProgressCallback* progress)
+        {
+            addColorLayers(model.get(), map, require, key, manifest, progress, false);
+        });
 
     if (require.elevationTextures)
     {
         unsigned border = (require.elevationBorder) ? 1u : 0u;
 
-        addElevation( model.get(), map, key, manifest, border, progress );
+        components.emplace_back([&, border](ProgressCallback* progress)
+            {
+                addElevation(model.get(), map, key, manifest, border, progress);
+            });
     }
 
     if (require.landCoverTextures)
     {
-        addLandCover(model.get(), map, key, require, manifest, progress);
+        components.emplace_back([&](ProgressCallback* progress)
+            {
+                addLandCover(model.get(), map, key, require, manifest, progress);
+            });
     }
 
     if (require.tileMesh)
     {
         if (key.getLOD() <= _options.maxLOD().value())
         {
-            addMesh(model.get(), map, key, require, manifest, progress);
+            components.emplace_back([&](ProgressCallback* progress)
+                {
+                    addMesh(model.get(), map, key, require, manifest, progress);
+                });
         }
     }
-    
+
+    // Each component reports to its own callback; they're merged back
+    // into "progress" after the join.
+    std::vector<osg::ref_ptr<ProgressCallback>> fetchProgress(components.size());
+    if (progress)
+    {
+        for (auto& p : fetchProgress)
+            p = new ProgressCallback(progress);
+    }
+
+    Threading::parallelFor(components.size(), getFetchPool(), [&](unsigned i)
+        {
+            if (!canceled(fetchProgress[i].get()))
+                components[i](fetchProgress[i].get());
+        });
+
+    for (auto& p : fetchProgress)
+        if (p.valid()) progress->merge(p.get());
 
     // done.
     return model.release();
@@ -371,11 +423,10 @@ TerrainTileModelFactory::addColorLayers(
 {
     OE_PROFILING_ZONE;
 
-    int order = 0;
-
     LayerVector layers;
     map->getLayers(layers);
 
+    LayerVector surfaceLayers;
     for (LayerVector::const_iterator i = layers.begin(); i != layers.end(); ++i)
     {
         Layer* layer = i->get();
@@ -390,20 +441,64 @@ TerrainTileModelFactory::addColorLayers(
         if (manifest.excludes(layer))
             continue;
 
-        ImageLayer* imageLayer = dynamic_cast<ImageLayer*>(layer);
-        if (imageLayer)
+        surfaceLayers.push_back(layer);
+    }
+
+    // Fetch the image layers concurrently. Each fetch fills a model of
+    // its own, and those merge below in map order.
+    std::vector<osg::ref_ptr<TerrainTileModel>> fetched(surfaceLayers.size());
+
+    // one callback per fetch, merged back into "progress" after the join
+    std::vector<osg::ref_ptr<ProgressCallback>> fetchProgress(surfaceLayers.size());
+    if (progress)
+    {
+        for (auto& p : fetchProgress)
+            p = new ProgressCallback(progress);
+    }
+
+    Threading::parallelFor(surfaceLayers.size(), getFetchPool(), [&](unsigned i)
         {
+            ImageLayer* imageLayer = dynamic_cast<ImageLayer*>(surfaceLayers[i].get());
+            ProgressCallback* fetchCallback = fetchProgress[i].get();
+            if (imageLayer == nullptr || canceled(fetchCallback))
+                return;
+
+            fetched[i] = new TerrainTileModel(model->key, model->revision);
+
             if (standalone)
             {
-                addStandaloneImageLayer(model, imageLayer, key, require, progress);
+                addStandaloneImageLayer(fetched[i].get(), imageLayer, key, require, fetchCallback);
             }
             else
             {
-                addImageLayer(model, imageLayer, key, require, progress);
+                addImageLayer(fetched[i].get(), imageLayer, key, require, fetchCallback);
             }
+        });
+
+    for (auto& p : fetchProgress)
+        if (p.valid()) progress->merge(p.get());
+
+    for (unsigned i = 0; i < surfaceLayers.size(); ++i)
+    {
+        if (fetched[i].valid())
+        {
+            for (unsigned index : fetched[i]->sharedLayerIndices)
+            {
+                model->sharedLayerIndices.push_back(model->colorLayers.size() + index);
+            }
+
+            for (auto& colorLayer : fetched[i]->colorLayers)
+            {
+                model->colorLayers.push_back(std::move(colorLayer));
+            }
+
+            model->requiresUpdateTraversal =
+                model->requiresUpdateTraversal || fetched[i]->requiresUpdateTraversal;
         }
-        else // non-image kind of TILE layer (e.g., splatting)
+        else if (dynamic_cast<ImageLayer*>(surfaceLayers[i].get()) == nullptr)
         {
+            // non-image kind of TILE layer (e.g., splatting)
+            Layer* layer = surfaceLayers[i].get();
             TerrainTileModel::ColorLayer colorModel;
             colorModel.layer = layer;
             colorModel.revision = layer->getRevision();
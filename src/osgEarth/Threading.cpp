@@ -20,6 +20,10 @@
 #include <cstdlib>
 #include <climits>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 
 #ifdef _WIN32
 #   include <Windows.h>
@@ -63,3 +67,60 @@ void osgEarth::setThreadName(const std::string& name)
     }
 #endif
 }
+
+void
+Threading::parallelFor(unsigned count, jobs::jobpool* pool, const std::function<void(unsigned)>& func)
+{
+    if (count == 0u)
+        return;
+
+    if (count == 1u || pool == nullptr || pool->concurrency() == 0u)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    // Shared with the jobs, which may outlive this call if they start
+    // after the caller has already done the remaining work.
+    struct State
+    {
+        std::function<void(unsigned)> func;
+        unsigned count = 0u;
+        std::atomic_uint next = { 0u };
+        unsigned done = 0u;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        void run()
+        {
+            for (unsigned i = next++; i < count; i = next++)
+            {
+                func(i);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++done == count)
+                    finished.notify_all();
+            }
+        }
+    };
+
+    auto state = std::make_shared<State>();
+    state->func = func;
+    state->count = count;
+
+    jobs::context context;
+    context.name = "oe.parallelFor";
+    context.pool = pool;
+
+    unsigned helpers = std::min(count - 1u, pool->concurrency());
+    for (unsigned i = 0; i < helpers; ++i)
+    {
+        jobs::dispatch([state]() { state->run(); }, context);
+    }
+
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done == state->count; });
+}
@@ -52,6 +52,7 @@ TileLayer::Options::getConfig() const
     conf.set("profile", _profile);
     conf.set("tile_size", _tileSize);
     conf.set("upsample", upsample());
+    conf.set("negative_cache_size", negativeCacheSize());
 
     return conf;
 }
@@ -71,6 +72,7 @@ TileLayer::Options::fromConfig(const Config& conf)
     conf.get( "min_valid_value", _minValidValue);
     conf.get( "max_valid_value", _maxValidValue);
     conf.get("upsample", upsample());
+    conf.get("negative_cache_size", negativeCacheSize());
 }
 
 //------------------------------------------------------------------------
@@ -333,6 +335,8 @@ TileLayer::openImplementation()
     if (_memCache.valid())
         _memCache->clear();
 
+    _negativeCache.setMaxSize(options().negativeCacheSize().get());
+
     return getStatus();
 }
 
@@ -404,6 +408,15 @@ TileLayer::setUpL2Cache(unsigned minSize)
     {
         _memCache = new MemCache(l2CacheSize);
         OE_INFO << LC << "L2 cache size = " << l2CacheSize << std::endl;
+
+        // Optional byte budget for the L2 cache.
+        char const* l2bytesEnv = ::getenv("OSGEARTH_L2_CACHE_MAX_BYTES");
+        if (l2bytesEnv)
+        {
+            std::size_t maxBytes = as<std::size_t>(std::string(l2bytesEnv), 0u);
+            _memCache->setMaxSizeInBytes(maxBytes);
+            OE_INFO << LC << "L2 cache byte budget set from environment = " << maxBytes << std::endl;
+        }
     }
 }
 
@@ -1001,5 +1014,24 @@ bool
 TileLayer::mayHaveData(const TileKey& key) const
 {
     return
-        key == getBestAvailableTileKey(key, true);
+        key == getBestAvailableTileKey(key, true) &&
+        !isKnownMissing(key);
+}
+
+bool
+TileLayer::isKnownMissing(const TileKey& key) const
+{
+    return _negativeCache.contains(key, getRevision());
+}
+
+void
+TileLayer::setKnownMissing(const TileKey& key)
+{
+    _negativeCache.insert(key, getRevision());
+}
+
+NegativeTileCache::Stats
+TileLayer::getNegativeCacheStats() const
+{
+    return _negativeCache.getStats();
 }
@@ -128,7 +128,10 @@ TransformFilter::push( Feature* input, FilterContext& context )
 FilterContext
 TransformFilter::push( FeatureList& input, FilterContext& incx )
 {
-    _bbox = osg::BoundingBoxd();
+    // only touch _bbox when localizing, so that non-localizing pushes
+    // can run concurrently (see isFeatureIndependent)
+    if ( _localize )
+        _bbox = osg::BoundingBoxd();
 
     // first transform all the points into the output SRS, collecting a bounding box as we go:
     bool ok = true;
@@ -0,0 +1,363 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/WriteBehindCacheBin>
+#include <osgEarth/DateTime>
+#include <osgEarth/Notify>
+#include <osgEarth/Metrics>
+
+using namespace osgEarth;
+
+#define LC "[WriteBehindCacheBin] "
+
+WriteBehindCacheBin::WriteBehindCacheBin(CacheBin* bin, unsigned maxQueueSize) :
+    CacheBin(bin ? bin->getID() : std::string(), bin ? bin->getEnableNodeCaching() : false),
+    _bin(bin),
+    _maxQueueSize(osg::maximum(maxQueueSize, 1u)),
+    _draining(false),
+    _totalFlushLatencyMs(0.0)
+{
+    OE_HARD_ASSERT(bin != nullptr);
+    setHashKeys(bin->getHashKeys());
+}
+
+WriteBehindCacheBin::~WriteBehindCacheBin()
+{
+    flush();
+}
+
+void
+WriteBehindCacheBin::flush()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _changed.wait(lock, [this]() { return _pending.empty() && !_draining; });
+}
+
+WriteBehindCacheBin::Stats
+WriteBehindCacheBin::getStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats stats = _stats;
+    stats.queueDepth = _pending.size();
+    stats.avgFlushLatencyMs = stats.flushed > 0 ? _totalFlushLatencyMs / (double)stats.flushed : 0.0;
+    return stats;
+}
+
+bool
+WriteBehindCacheBin::readPending(const std::string& key, ReadResult& out) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto i = _pending.find(key);
+    if (i == _pending.end())
+        return false;
+
+    if (i->second.removed)
+    {
+        // the wrapped bin may still hold the old record
+        out = ReadResult(ReadResult::RESULT_NOT_FOUND);
+        return true;
+    }
+
+    out = ReadResult(const_cast<osg::Object*>(i->second.object.get()), i->second.meta);
+    out.setLastModifiedTime(DateTime().asTimeStamp());
+    return true;
+}
+
+ReadResult
+WriteBehindCacheBin::readObject(const std::string& key, const osgDB::Options* dbo)
+{
+    ReadResult r;
+    if (readPending(key, r))
+        return r;
+    return _bin->readObject(key, dbo);
+}
+
+ReadResult
+WriteBehindCacheBin::readImage(const std::string& key, const osgDB::Options* dbo)
+{
+    ReadResult r;
+    if (readPending(key, r))
+        return !r.succeeded() || r.getImage() ? r : ReadResult(ReadResult::RESULT_NOT_FOUND);
+    return _bin->readImage(key, dbo);
+}
+
+ReadResult
+WriteBehindCacheBin::readString(const std::string& key, const osgDB::Options* dbo)
+{
+    ReadResult r;
+    if (readPending(key, r))
+        return !r.succeeded() || r.get<StringObject>() ? r : ReadResult("Empty string");
+    return _bin->readString(key, dbo);
+}
+
+bool
+WriteBehindCacheBin::write(
+    const std::string& key,
+    const osg::Object* object,
+    const Config& meta,
+    const osgDB::Options* dbo)
+{
+    if (!object)
+        return false;
+
+    // Layers hand the same image or heightfield back to their callers;
+    // serialize a private copy so later changes to it can't race the writer.
+    osg::ref_ptr<const osg::Object> copy = osg::clone(object, osg::CopyOp::DEEP_COPY_ALL);
+    if (!copy.valid())
+        return false;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    auto i = _pending.find(key);
+    if (i == _pending.end())
+    {
+        // backpressure: wait for room in the queue.
+        if (_pending.size() >= _maxQueueSize)
+        {
+            _stats.blocked++;
+            _changed.wait(lock, [this]() { return _pending.size() < _maxQueueSize; });
+        }
+
+        // the key may have been queued while we waited
+        i = _pending.find(key);
+    }
+
+    _stats.queued++;
+
+    Pending& p = i == _pending.end() ? _pending[key] : i->second;
+    p.object = copy;
+    p.meta = meta;
+    p.options = dbo;
+    p.removed = false;
+
+    if (p.queued)
+    {
+        // coalesce with the write that's already queued.
+        _stats.coalesced++;
+    }
+    else
+    {
+        // new, in flight or removed: queue it (again).
+        p.queued = true;
+        p.queuedTime = Clock::now();
+        _queue.push_back(key);
+    }
+
+    _stats.maxQueueDepth = osg::maximum(_stats.maxQueueDepth, (unsigned)_pending.size());
+
+    if (!_draining)
+    {
+        _draining = true;
+        jobs::context context;
+        context.name = "oe.cache.writebehind";
+        context.pool = jobs::get_pool("oe.cache.writebehind");
+
+        // the job keeps the bin alive until it is done with it
+        osg::ref_ptr<WriteBehindCacheBin> self(this);
+        jobs::dispatch([self]() { self->drain(); }, context);
+    }
+
+    return true;
+}
+
+void
+WriteBehindCacheBin::drain()
+{
+    OE_PROFILING_ZONE_NAMED("OE Write-behind Cache Flush");
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (!_queue.empty())
+    {
+        std::string key = std::move(_queue.front());
+        _queue.pop_front();
+
+        auto i = _pending.find(key);
+        if (i == _pending.end())
+            continue;
+
+        i->second.queued = false;
+
+        // let a remove() that's under way finish first, so the
+        // wrapped bin sees the operations in order
+        _changed.wait(lock, [&]()
+            {
+                i = _pending.find(key);
+                return i == _pending.end() || i->second.removing == 0u;
+            });
+
+        if (i == _pending.end() || i->second.queued)
+            continue;
+
+        Pending& p = i->second;
+        if (p.removed)
+        {
+            _pending.erase(i);
+            _changed.notify_all();
+            continue;
+        }
+
+        p.inFlight = true;
+
+        osg::ref_ptr<const osg::Object> object = p.object;
+        Config meta = p.meta;
+        osg::ref_ptr<const osgDB::Options> options = p.options;
+        Clock::time_point queuedTime = p.queuedTime;
+
+        lock.unlock();
+        bool ok = _bin->write(key, object.get(), meta, options.get());
+        lock.lock();
+
+        double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - queuedTime).count();
+        _totalFlushLatencyMs += latencyMs;
+        _stats.maxFlushLatencyMs = osg::maximum(_stats.maxFlushLatencyMs, latencyMs);
+        if (ok)
+            _stats.flushed++;
+        else
+            _stats.failed++;
+
+        if (!ok)
+        {
+            OE_DEBUG << LC << "Failed to write \"" << key << "\" to cache bin \"" << getID() << "\"" << std::endl;
+        }
+
+        // the map may have rehashed while unlocked
+        i = _pending.find(key);
+        if (i != _pending.end())
+        {
+            Pending& q = i->second;
+            q.inFlight = false;
+
+            if (q.removing > 0u || q.queued)
+            {
+                // remove() will finish the job, or a newer object is
+                // waiting in the queue
+            }
+            else
+            {
+                if (q.removed)
+                {
+                    // cleared while in flight; undo the write
+                    lock.unlock();
+                    _bin->remove(key);
+                    lock.lock();
+                }
+                _pending.erase(key);
+            }
+        }
+
+        _changed.notify_all();
+    }
+
+    _draining = false;
+    _changed.notify_all();
+}
+
+CacheBin::RecordStatus
+WriteBehindCacheBin::getRecordStatus(const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto i = _pending.find(key);
+        if (i != _pending.end())
+            return i->second.removed ? STATUS_NOT_FOUND : STATUS_OK;
+    }
+    return _bin->getRecordStatus(key);
+}
+
+bool
+WriteBehindCacheBin::remove(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // Leave a tombstone so that reads don't fall through to the wrapped
+    // bin until it has removed the record.
+    Pending& p = _pending[key];
+    p.object = nullptr;
+    p.removed = true;
+    p.removing++;
+
+    // wait for a write that's in progress, then undo it
+    _changed.wait(lock, [&]() { return !_pending[key].inFlight; });
+
+    lock.unlock();
+    bool ok = _bin->remove(key);
+    lock.lock();
+
+    auto i = _pending.find(key);
+    if (i != _pending.end())
+    {
+        Pending& q = i->second;
+        q.removing--;
+        if (q.removing == 0u && q.removed && !q.queued)
+            _pending.erase(i);
+    }
+    _changed.notify_all();
+
+    return ok;
+}
+
+bool
+WriteBehindCacheBin::touch(const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto i = _pending.find(key);
+        if (i != _pending.end())
+            return !i->second.removed;
+    }
+    return _bin->touch(key);
+}
+
+bool
+WriteBehindCacheBin::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto i = _pending.begin(); i != _pending.end(); )
+        {
+            if (i->second.inFlight || i->second.removing > 0u)
+            {
+                // the writer (or remove()) finishes with it
+                i->second.object = nullptr;
+                i->second.removed = true;
+                i->second.queued = false;
+                ++i;
+            }
+            else
+            {
+                i = _pending.erase(i);
+            }
+        }
+        _changed.notify_all();
+    }
+    return _bin->clear();
+}
+
+bool
+WriteBehindCacheBin::compact()
+{
+    flush();
+    return _bin->compact();
+}
+
+unsigned
+WriteBehindCacheBin::getStorageSize()
+{
+    return _bin->getStorageSize();
+}
@@ -0,0 +1,578 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "PackedFileCache"
+#include "PackedStore"
+#include <osgEarth/Cache>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Threading>
+#include <osgEarth/URI>
+#include <osgEarth/Registry>
+#include <osgEarth/Metrics>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <osgDB/Registry>
+#include <algorithm>
+#include <climits>
+#include <sstream>
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers;
+using namespace osgEarth::PackedFileCache;
+
+#define OSG_FORMAT "osgb"
+
+// number of writes/removes between checks for automatic compaction
+#define COMPACT_CHECK_PERIOD 256u
+
+#undef  LC
+#define LC "[PackedFileCache] "
+
+namespace
+{
+    /**
+     * Cache that packs records into large segment files.
+     */
+    class PackedFileCacheImpl : public Cache
+    {
+    public:
+        PackedFileCacheImpl() { } // unused
+        PackedFileCacheImpl( const PackedFileCacheImpl& rhs, const osg::CopyOp& op ) { } // unused
+        META_Object( osgEarth, PackedFileCacheImpl );
+
+        PackedFileCacheImpl( const CacheOptions& options );
+
+    public: // Cache interface
+
+        CacheBin* addBin( const std::string& binID ) override;
+
+        CacheBin* getOrCreateDefaultBin() override;
+
+    protected:
+        std::string _rootPath;
+        PackedFileCacheOptions _options;
+    };
+
+    /**
+     * Cache bin backed by one PackedStore.
+     */
+    class PackedFileCacheBin : public CacheBin
+    {
+    public:
+        PackedFileCacheBin(
+            const std::string& name,
+            const std::string& rootPath,
+            const PackedFileCacheOptions& options);
+
+        virtual ~PackedFileCacheBin();
+
+    public: // CacheBin interface
+
+        ReadResult readObject(const std::string& key, const osgDB::Options* dbo) override;
+
+        ReadResult readImage(const std::string& key, const osgDB::Options* dbo) override;
+
+        ReadResult readString(const std::string& key, const osgDB::Options* dbo) override;
+
+        bool write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo) override;
+
+        bool remove(const std::string& key) override;
+
+        bool touch(const std::string& key) override;
+
+        RecordStatus getRecordStatus(const std::string& key) override;
+
+        bool clear() override;
+
+        //! Starts a compaction in the background; returns false if one
+        //! is already running.
+        bool compact() override;
+
+        unsigned getStorageSize() override;
+
+    protected:
+        bool binValidForReading(bool silent =true);
+
+        bool binValidForWriting(bool silent =false);
+
+        const osgDB::Options* mergeOptions(const osgDB::Options* in);
+
+        ReadResult read(const std::string& key, osgDB::ReaderWriter* rw, bool image, const osgDB::Options* dbo);
+
+        void compactIfNeeded();
+
+        std::string _binPath;
+        std::string _compressorName;
+        osg::ref_ptr<osgDB::Options> _zlibOptions;
+        PackedFileCacheOptions _options;
+        bool _debug;
+
+        PackedStore _store;
+        std::atomic_bool _ok;
+        std::mutex _openMutex;
+
+        std::atomic_uint _changesSinceCheck;
+        std::atomic_bool _compacting;
+        std::shared_ptr<jobs::jobgroup> _compactJobs;
+
+        // serializers for objects and for images
+        osg::ref_ptr<osgDB::ReaderWriter> _rw;
+        osg::ref_ptr<osgDB::ReaderWriter> _imageRW;
+    };
+
+    void encodeMeta(const Config& meta, std::string& out)
+    {
+        out = meta.empty() ? std::string() : meta.toJSON(false);
+    }
+
+    void decodeMeta(const std::string& in, Config& meta)
+    {
+        if (!in.empty())
+            meta.fromJSON(in);
+    }
+}
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    PackedFileCacheImpl::PackedFileCacheImpl(const CacheOptions& options) :
+        Cache(options),
+        _options(options)
+    {
+        // read the root path from ENV is necessary:
+        if ( !_options.rootPath().isSet())
+        {
+            const char* cachePath = ::getenv(OSGEARTH_ENV_CACHE_PATH);
+            if ( cachePath )
+                _options.rootPath() = cachePath;
+        }
+
+        _rootPath = URI( *_options.rootPath(), options.referrer() ).full();
+
+        if (osgDB::makeDirectory(_rootPath) == false)
+        {
+            _status.set(Status::ResourceUnavailable, Stringify()
+                << "Failed to create or access folder \"" << _rootPath << "\"");
+            return;
+        }
+        OE_INFO << LC << "Opened a packed file cache at \"" << _rootPath << "\"\n";
+    }
+
+    CacheBin*
+    PackedFileCacheImpl::addBin( const std::string& name )
+    {
+        if (getStatus().isError())
+            return NULL;
+
+        return _bins.getOrCreate(name, new PackedFileCacheBin(name, _rootPath, _options));
+    }
+
+    CacheBin*
+    PackedFileCacheImpl::getOrCreateDefaultBin()
+    {
+        if (getStatus().isError())
+            return NULL;
+
+        static Mutex s_defaultBinMutex;
+        if ( !_defaultBin.valid() )
+        {
+            std::lock_guard<std::mutex> lock( s_defaultBinMutex );
+            if ( !_defaultBin.valid() ) // double-check
+            {
+                _defaultBin = new PackedFileCacheBin("__default", _rootPath, _options);
+            }
+        }
+        return _defaultBin.get();
+    }
+
+    //------------------------------------------------------------------------
+
+    PackedFileCacheBin::PackedFileCacheBin(
+        const std::string& binID,
+        const std::string& rootPath,
+        const PackedFileCacheOptions& options) :
+
+        CacheBin(binID, options.enableNodeCaching().get()),
+        _options(options),
+        _debug(false),
+        _ok(true),
+        _changesSinceCheck(0u),
+        _compacting(false),
+        _compactJobs(jobs::jobgroup::create())
+    {
+        _binPath = osgDB::concatPaths(rootPath, binID);
+
+        _rw = osgDB::Registry::instance()->getReaderWriterForExtension(OSG_FORMAT);
+        _imageRW = osgDB::Registry::instance()->getReaderWriterForExtension(_options.format().get());
+
+        _zlibOptions = Registry::instance()->cloneOrCreateOptions();
+
+        if (::getenv(OSGEARTH_ENV_DEFAULT_COMPRESSOR) != 0L)
+        {
+            _compressorName = ::getenv(OSGEARTH_ENV_DEFAULT_COMPRESSOR);
+        }
+        else
+        {
+            _compressorName = "zlib";
+        }
+
+        if (_compressorName.length() > 0)
+        {
+            _zlibOptions->setPluginStringData("Compressor", _compressorName);
+        }
+
+        _debug = ::getenv("OSGEARTH_CACHE_DEBUG") != 0L;
+    }
+
+    PackedFileCacheBin::~PackedFileCacheBin()
+    {
+        // let any background compaction finish before closing the store
+        _compactJobs->join();
+        _store.close();
+    }
+
+    bool
+    PackedFileCacheBin::binValidForReading(bool silent)
+    {
+        // the store is created on first use; reading does not create it.
+        if (!_store.isOpen() && _ok)
+        {
+            if (osgDB::fileExists(_binPath))
+                return binValidForWriting(silent);
+            return false;
+        }
+        return _ok && _store.isOpen() && _rw.valid();
+    }
+
+    bool
+    PackedFileCacheBin::binValidForWriting(bool silent)
+    {
+        if (!_store.isOpen() && _ok)
+        {
+            std::lock_guard<std::mutex> lock(_openMutex);
+            if (!_store.isOpen() && _ok) // double-check
+            {
+                std::string error;
+                std::uint64_t maxSegmentSize = (std::uint64_t)_options.maxSegmentSizeMB().get() * 1048576u;
+                if (!_store.open(_binPath, maxSegmentSize, error))
+                {
+                    // one-time error.
+                    if (!silent)
+                    {
+                        OE_WARN << LC << "FAILED to open cache bin at [" << _binPath << "]: " << error << std::endl;
+                    }
+                    _ok = false;
+                }
+            }
+        }
+        return _ok && _rw.valid();
+    }
+
+    const osgDB::Options*
+    PackedFileCacheBin::mergeOptions(const osgDB::Options* dbo)
+    {
+        if (!dbo)
+        {
+            return _zlibOptions.get();
+        }
+        else if (!_zlibOptions.valid())
+        {
+            return dbo;
+        }
+        else
+        {
+            osgDB::Options* merged = Registry::cloneOrCreateOptions(dbo);
+            if (_compressorName.length())
+            {
+                merged->setPluginStringData("Compressor", _compressorName);
+            }
+            return merged;
+        }
+    }
+
+    ReadResult
+    PackedFileCacheBin::read(const std::string& key, osgDB::ReaderWriter* rw, bool image, const osgDB::Options* readOptions)
+    {
+        OE_PROFILING_ZONE;
+
+        if (!binValidForReading() || !rw)
+            return ReadResult(ReadResult::RESULT_NOT_FOUND);
+
+        PackedStore::Record record;
+        if (!_store.get(key, record))
+            return ReadResult(ReadResult::RESULT_NOT_FOUND);
+
+        osg::ref_ptr<const osgDB::Options> dbo = mergeOptions(readOptions);
+
+        std::istringstream datastream(record.data);
+        osgDB::ReaderWriter::ReadResult r = image ?
+            rw->readImage(datastream, dbo.get()) :
+            rw->readObject(datastream, dbo.get());
+
+        if (!r.success())
+        {
+            return ReadResult(r.message());
+        }
+
+        Config meta;
+        decodeMeta(record.meta, meta);
+
+        ReadResult rr(image ? (osg::Object*)r.getImage() : r.getObject(), meta);
+        rr.setLastModifiedTime(record.timestamp);
+
+        if (_debug)
+            OE_NOTICE << LC << "Read \"" << key << "\" from cache bin [" << getID() << "]" << std::endl;
+
+        return rr;
+    }
+
+    ReadResult
+    PackedFileCacheBin::readImage(const std::string& key, const osgDB::Options* readOptions)
+    {
+        if (!_imageRW.valid())
+            return ReadResult(Stringify() << "Unknown image format \"" << _options.format().get() << "\"");
+
+        ReadResult rr = read(key, _imageRW.get(), true, readOptions);
+
+        // compressed cache data means there was an internal error
+        OE_SOFT_ASSERT_AND_RETURN(
+            rr.getImage() == nullptr || rr.getImage()->isCompressed() == false,
+            ReadResult());
+
+        return rr;
+    }
+
+    ReadResult
+    PackedFileCacheBin::readObject(const std::string& key, const osgDB::Options* readOptions)
+    {
+        return read(key, _rw.get(), false, readOptions);
+    }
+
+    ReadResult
+    PackedFileCacheBin::readString(const std::string& key, const osgDB::Options* readOptions)
+    {
+        ReadResult r = readObject(key, readOptions);
+        if ( r.succeeded() )
+        {
+            if ( r.get<StringObject>() )
+                return r;
+            else
+                return ReadResult("Empty string");
+        }
+        else
+        {
+            return r;
+        }
+    }
+
+    bool
+    PackedFileCacheBin::write(
+        const std::string& key,
+        const osg::Object* object,
+        const Config& meta,
+        const osgDB::Options* writeOptions)
+    {
+        OE_PROFILING_ZONE;
+
+        if ( !binValidForWriting() || !object)
+            return false;
+
+        bool isNode = dynamic_cast<const osg::Node*>(object) != nullptr;
+
+        // see FileSystemCacheBin::write
+        if (isNode && _options.enableNodeCaching() == false)
+            return true;
+
+        osg::ref_ptr<const osgDB::Options> dbo = mergeOptions(writeOptions);
+
+        std::stringstream datastream;
+        osgDB::ReaderWriter::WriteResult r;
+
+        const osg::Image* image = dynamic_cast<const osg::Image*>(object);
+        if (image)
+        {
+            if (image->isCompressed())
+            {
+                OE_SOFT_ASSERT(image->isCompressed() == false);
+                return false;
+            }
+            if (!_imageRW.valid())
+                return false;
+            r = _imageRW->writeImage(*image, datastream, dbo.get());
+        }
+        else if (isNode)
+        {
+            r = _rw->writeNode(*static_cast<const osg::Node*>(object), datastream, dbo.get());
+        }
+        else
+        {
+            r = _rw->writeObject(*object, datastream, dbo.get());
+        }
+
+        if (!r.success())
+        {
+            OE_WARN << LC << "FAILED to serialize \"" << key << "\" for cache bin \"" <<
+                getID() << "\"; msg = \"" << r.message() << "\"" << std::endl;
+            return false;
+        }
+
+        std::string metadata;
+        encodeMeta(meta, metadata);
+
+        if (!_store.put(key, datastream.str(), metadata))
+        {
+            OE_WARN << LC << "FAILED to write \"" << key << "\" to cache bin \"" << getID() << "\"" << std::endl;
+            return false;
+        }
+
+        if (_debug)
+            OE_INFO << LC << "Wrote \"" << key << "\" to cache bin " << getID() << std::endl;
+
+        compactIfNeeded();
+        return true;
+    }
+
+    CacheBin::RecordStatus
+    PackedFileCacheBin::getRecordStatus(const std::string& key)
+    {
+        if ( !binValidForReading() )
+            return STATUS_NOT_FOUND;
+
+        return _store.contains(key) ? STATUS_OK : STATUS_NOT_FOUND;
+    }
+
+    bool
+    PackedFileCacheBin::remove(const std::string& key)
+    {
+        if ( !binValidForReading() )
+            return false;
+
+        bool removed = _store.remove(key);
+        if (removed)
+            compactIfNeeded();
+        return removed;
+    }
+
+    bool
+    PackedFileCacheBin::touch(const std::string& key)
+    {
+        if ( !binValidForReading() )
+            return false;
+
+        return _store.touch(key);
+    }
+
+    bool
+    PackedFileCacheBin::clear()
+    {
+        if ( !binValidForReading() )
+            return false;
+
+        return _store.clear();
+    }
+
+    bool
+    PackedFileCacheBin::compact()
+    {
+        if ( !binValidForReading() )
+            return false;
+
+        bool expected = false;
+        if (!_compacting.compare_exchange_strong(expected, true))
+            return false;
+
+        // The destructor waits on the job group, so the bin outlives the job.
+        PackedFileCacheBin* bin = this;
+        auto compact_op = [bin]()
+        {
+            OE_PROFILING_ZONE_NAMED("OE Packed Cache Compact");
+
+            std::uint64_t reclaimed = bin->_store.compact();
+
+            if (bin->_debug)
+                OE_INFO << LC << "Compacted cache bin " << bin->getID() << "; reclaimed " << reclaimed << " bytes" << std::endl;
+
+            bin->_compacting = false;
+        };
+
+        jobs::context context;
+        context.name = "oe.packedcache.compact";
+        context.pool = jobs::get_pool("oe.packedcache");
+        context.group = _compactJobs;
+        jobs::dispatch(compact_op, context);
+
+        return true;
+    }
+
+    void
+    PackedFileCacheBin::compactIfNeeded()
+    {
+        float ratio = _options.compactRatio().get();
+        if (ratio <= 0.0f || ++_changesSinceCheck < COMPACT_CHECK_PERIOD)
+            return;
+
+        _changesSinceCheck = 0u;
+
+        // wait until there is at least one full segment's worth of data
+        std::uint64_t total = _store.getTotalBytes();
+        std::uint64_t minSize = (std::uint64_t)_options.maxSegmentSizeMB().get() * 1048576u;
+        if (total >= minSize && (double)_store.getDeadBytes() > (double)total * ratio)
+        {
+            compact();
+        }
+    }
+
+    unsigned
+    PackedFileCacheBin::getStorageSize()
+    {
+        if ( !binValidForReading() )
+            return 0u;
+
+        return (unsigned)std::min<std::uint64_t>(_store.getTotalBytes(), UINT_MAX);
+    }
+}
+
+//------------------------------------------------------------------------
+
+/**
+ * Cache driver that stores bins as packed segment files.
+ */
+class PackedFileCacheDriver : public CacheDriver
+{
+public:
+    PackedFileCacheDriver()
+    {
+        supportsExtension( "osgearth_cache_packed", "Packed file cache for osgEarth" );
+    }
+
+    virtual const char* className() const
+    {
+        return "Packed file cache for osgEarth";
+    }
+
+    virtual ReadResult readObject(const std::string& file_name, const Options* options) const
+    {
+        if ( !acceptsExtension(osgDB::getLowerCaseFileExtension( file_name )))
+            return ReadResult::FILE_NOT_HANDLED;
+
+        return ReadResult( new PackedFileCacheImpl( getCacheOptions(options) ) );
+    }
+};
+
+REGISTER_OSGPLUGIN(osgearth_cache_packed, PackedFileCacheDriver)
@@ -0,0 +1,1207 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "PackedStore"
+#include <osgEarth/Notify>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+using namespace osgEarth;
+using namespace osgEarth::PackedFileCache;
+
+#define LC "[PackedStore] "
+
+#define INDEX_FILE_NAME "index.pack"
+#define SEGMENT_PREFIX "segment_"
+#define SEGMENT_EXT ".pack"
+
+#define INDEX_MAGIC 0x4950454fu  // "OEPI"
+#define INDEX_VERSION 2u
+#define RECORD_MAGIC 0x5250454fu // "OEPR"
+
+#define MIN_INDEX_CAPACITY 4096u
+
+#define EMPTY_HASH 0u
+#define DELETED_HASH 1u
+
+//------------------------------------------------------------------------
+
+//! Header at the start of the index file
+struct PackedStore::Header
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t capacity;    // number of slots; power of two
+    std::uint64_t count;       // live slots
+    std::uint64_t used;        // live + deleted slots
+    std::uint64_t deadBytes;   // reclaimable bytes in the segments
+    std::uint32_t clean;       // 1 if the index was closed cleanly
+    std::uint32_t reserved[5];
+};
+
+//! One entry in the index's open-addressed hash table
+struct PackedStore::Slot
+{
+    std::uint64_t hash;
+    std::uint64_t check;       // second, independent hash of the key
+    std::uint32_t keyLength;
+    std::uint32_t segment;
+    std::uint32_t length;
+    std::uint32_t reserved;
+    std::uint64_t offset;
+    std::int64_t  timestamp;
+};
+
+//! What a slot stores to identify its key
+struct PackedStore::KeyHash
+{
+    std::uint64_t hash;
+    std::uint64_t check;
+    std::uint32_t length;
+};
+
+//! Location of a record within the segments
+struct PackedStore::Location
+{
+    std::uint32_t segment = 0u;
+    std::uint64_t offset = 0u;
+    std::uint32_t length = 0u;
+};
+
+namespace
+{
+    //! Header preceding each record in a segment
+    struct RecordHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t flags;
+        std::uint32_t keyLength;
+        std::uint32_t metaLength;
+        std::uint32_t dataLength;
+        std::uint32_t reserved;
+        std::int64_t  timestamp;
+    };
+
+    std::uint64_t nextPowerOf2(std::uint64_t n)
+    {
+        std::uint64_t p = 1u;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    PackedStore::KeyHash keyHashOf(const PackedStore::Slot& slot)
+    {
+        PackedStore::KeyHash k;
+        k.hash = slot.hash;
+        k.check = slot.check;
+        k.length = slot.keyLength;
+        return k;
+    }
+}
+
+namespace osgEarth { namespace PackedFileCache
+{
+    /**
+     * Segment file supporting positioned reads and writes from many threads.
+     * Deleted from disk when the last reference goes away if marked obsolete.
+     */
+    class SegmentFile
+    {
+    public:
+        SegmentFile(std::uint32_t id, const std::string& path) :
+            _id(id), _path(path), _size(0u), _obsolete(false) { }
+
+        ~SegmentFile()
+        {
+            close();
+            if (_obsolete)
+                ::remove(_path.c_str());
+        }
+
+        bool open()
+        {
+#ifdef _WIN32
+            _handle = ::CreateFileA(_path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (_handle == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER size;
+            if (!::GetFileSizeEx(_handle, &size))
+                return false;
+            _size = (std::uint64_t)size.QuadPart;
+#else
+            _fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (_fd < 0)
+                return false;
+            struct stat s;
+            if (::fstat(_fd, &s) != 0)
+                return false;
+            _size = (std::uint64_t)s.st_size;
+#endif
+            return true;
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (_handle != INVALID_HANDLE_VALUE)
+                ::CloseHandle(_handle);
+            _handle = INVALID_HANDLE_VALUE;
+#else
+            if (_fd >= 0)
+                ::close(_fd);
+            _fd = -1;
+#endif
+        }
+
+        bool readAt(std::uint64_t offset, char* buf, std::uint64_t length) const
+        {
+            while (length > 0)
+            {
+#ifdef _WIN32
+                OVERLAPPED ov = {};
+                ov.Offset = (DWORD)(offset & 0xffffffffu);
+                ov.OffsetHigh = (DWORD)(offset >> 32);
+                DWORD n = 0;
+                DWORD chunk = (DWORD)std::min<std::uint64_t>(length, 1u << 30);
+                if (!::ReadFile(_handle, buf, chunk, &n, &ov) || n == 0)
+                    return false;
+#else
+                ssize_t n = ::pread(_fd, buf, length, (off_t)offset);
+                if (n <= 0)
+                    return false;
+#endif
+                buf += n, offset += n, length -= n;
+            }
+            return true;
+        }
+
+        bool writeAt(std::uint64_t offset, const char* buf, std::uint64_t length)
+        {
+            while (length > 0)
+            {
+#ifdef _WIN32
+                OVERLAPPED ov = {};
+                ov.Offset = (DWORD)(offset & 0xffffffffu);
+                ov.OffsetHigh = (DWORD)(offset >> 32);
+                DWORD n = 0;
+                DWORD chunk = (DWORD)std::min<std::uint64_t>(length, 1u << 30);
+                if (!::WriteFile(_handle, buf, chunk, &n, &ov) || n == 0)
+                    return false;
+#else
+                ssize_t n = ::pwrite(_fd, buf, length, (off_t)offset);
+                if (n <= 0)
+                    return false;
+#endif
+                buf += n, offset += n, length -= n;
+            }
+            return true;
+        }
+
+        bool truncate(std::uint64_t size)
+        {
+#ifdef _WIN32
+            LARGE_INTEGER pos;
+            pos.QuadPart = (LONGLONG)size;
+            if (!::SetFilePointerEx(_handle, pos, nullptr, FILE_BEGIN) || !::SetEndOfFile(_handle))
+                return false;
+#else
+            if (::ftruncate(_fd, (off_t)size) != 0)
+                return false;
+#endif
+            _size = size;
+            return true;
+        }
+
+        std::uint32_t _id;
+        std::string _path;
+        std::atomic<std::uint64_t> _size;
+        std::atomic_bool _obsolete;
+
+    private:
+#ifdef _WIN32
+        HANDLE _handle = INVALID_HANDLE_VALUE;
+#else
+        int _fd = -1;
+#endif
+    };
+
+    /**
+     * Read/write memory mapping of an entire file.
+     */
+    class MappedFile
+    {
+    public:
+        ~MappedFile()
+        {
+            close();
+        }
+
+        bool open(const std::string& path)
+        {
+#ifdef _WIN32
+            _file = ::CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (_file == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER size;
+            if (!::GetFileSizeEx(_file, &size))
+                return false;
+            _size = (std::uint64_t)size.QuadPart;
+#else
+            _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (_fd < 0)
+                return false;
+            struct stat s;
+            if (::fstat(_fd, &s) != 0)
+                return false;
+            _size = (std::uint64_t)s.st_size;
+#endif
+            return _size == 0u || map();
+        }
+
+        //! Changes the size of the file and remaps it. Invalidates data().
+        bool resize(std::uint64_t size)
+        {
+            unmap();
+#ifdef _WIN32
+            LARGE_INTEGER pos;
+            pos.QuadPart = (LONGLONG)size;
+            if (!::SetFilePointerEx(_file, pos, nullptr, FILE_BEGIN) || !::SetEndOfFile(_file))
+                return false;
+#else
+            if (::ftruncate(_fd, (off_t)size) != 0)
+                return false;
+#endif
+            _size = size;
+            return map();
+        }
+
+        void sync()
+        {
+            if (_data)
+            {
+#ifdef _WIN32
+                ::FlushViewOfFile(_data, 0);
+                ::FlushFileBuffers(_file);
+#else
+                ::msync(_data, _size, MS_SYNC);
+#endif
+            }
+        }
+
+        void close()
+        {
+            unmap();
+#ifdef _WIN32
+            if (_file != INVALID_HANDLE_VALUE)
+                ::CloseHandle(_file);
+            _file = INVALID_HANDLE_VALUE;
+#else
+            if (_fd >= 0)
+                ::close(_fd);
+            _fd = -1;
+#endif
+        }
+
+        char* data() const { return _data; }
+        std::uint64_t size() const { return _size; }
+
+    private:
+        bool map()
+        {
+#ifdef _WIN32
+            _mapping = ::CreateFileMappingA(_file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+            if (_mapping == nullptr)
+                return false;
+            _data = (char*)::MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+#else
+            void* ptr = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+            _data = ptr == MAP_FAILED ? nullptr : (char*)ptr;
+#endif
+            return _data != nullptr;
+        }
+
+        void unmap()
+        {
+#ifdef _WIN32
+            if (_data)
+                ::UnmapViewOfFile(_data);
+            if (_mapping)
+                ::CloseHandle(_mapping);
+            _mapping = nullptr;
+#else
+            if (_data)
+                ::munmap(_data, _size);
+#endif
+            _data = nullptr;
+        }
+
+        char* _data = nullptr;
+        std::uint64_t _size = 0u;
+#ifdef _WIN32
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#else
+        int _fd = -1;
+#endif
+    };
+} }
+
+//------------------------------------------------------------------------
+
+PackedStore::PackedStore() :
+    _maxSegmentSize(0u),
+    _open(false),
+    _nextSegmentId(0u),
+    _rollover(false)
+{
+    //nop
+}
+
+PackedStore::~PackedStore()
+{
+    close();
+}
+
+PackedStore::KeyHash
+PackedStore::hashKey(const std::string& key)
+{
+    // Both hashes must be stable across runs since the index is persistent.
+    // The primary is FNV-1a; the check is an unrelated multiplicative hash
+    // finished with the splitmix64 mixer.
+    std::uint64_t h = 14695981039346656037ull;
+    std::uint64_t c = 0x9e3779b97f4a7c15ull;
+    for (unsigned char ch : key)
+    {
+        h ^= ch;
+        h *= 1099511628211ull;
+        c = (c + ch) * 0xbf58476d1ce4e5b9ull;
+        c ^= c >> 29;
+    }
+    c ^= c >> 30;
+    c *= 0xbf58476d1ce4e5b9ull;
+    c ^= c >> 27;
+    c *= 0x94d049bb133111ebull;
+    c ^= c >> 31;
+
+    KeyHash k;
+    // reserve the empty and deleted markers
+    k.hash = h > DELETED_HASH ? h : h + 2u;
+    k.check = c;
+    k.length = (std::uint32_t)key.size();
+    return k;
+}
+
+std::string
+PackedStore::segmentFileName(std::uint32_t id) const
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), SEGMENT_PREFIX "%08u" SEGMENT_EXT, id);
+    return osgDB::concatPaths(_path, buf);
+}
+
+PackedStore::Header*
+PackedStore::header() const
+{
+    return reinterpret_cast<Header*>(_index->data());
+}
+
+bool
+PackedStore::open(const std::string& path, std::uint64_t maxSegmentSize, std::string& error)
+{
+    close();
+
+    // Readers that got past isOpen() before a previous close() wait here
+    // and then find the new index (or none).
+    std::lock_guard<std::mutex> compactLock(_compactMutex);
+    std::lock_guard<std::mutex> appendLock(_appendMutex);
+    ScopedWriteLock lock(_indexMutex);
+
+    _path = path;
+    _maxSegmentSize = std::max<std::uint64_t>(maxSegmentSize, 1024u);
+
+    if (!osgDB::makeDirectory(_path))
+    {
+        error = "Failed to create folder \"" + _path + "\"";
+        return false;
+    }
+
+    // Find the existing segments, in order.
+    std::vector<std::uint32_t> ids;
+    for (auto& name : osgDB::getDirectoryContents(_path))
+    {
+        unsigned id;
+        if (name.size() == strlen(SEGMENT_PREFIX) + 8 + strlen(SEGMENT_EXT) &&
+            sscanf(name.c_str(), SEGMENT_PREFIX "%08u" SEGMENT_EXT, &id) == 1)
+        {
+            ids.push_back(id);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+
+    for (auto id : ids)
+    {
+        auto segment = std::make_shared<SegmentFile>(id, segmentFileName(id));
+        if (!segment->open())
+        {
+            error = "Failed to open segment \"" + segment->_path + "\"";
+            _segments.clear();
+            return false;
+        }
+        _segments.push_back(segment);
+        _nextSegmentId = id + 1u;
+    }
+
+    _index.reset(new MappedFile());
+    if (!_index->open(osgDB::concatPaths(_path, INDEX_FILE_NAME)))
+    {
+        error = "Failed to map index in \"" + _path + "\"";
+        closeIndex();
+        return false;
+    }
+
+    bool valid =
+        _index->size() >= sizeof(Header) &&
+        header()->magic == INDEX_MAGIC &&
+        header()->version == INDEX_VERSION &&
+        header()->clean == 1u &&
+        _index->size() == sizeof(Header) + header()->capacity * sizeof(Slot);
+
+    if (!valid)
+    {
+        if (!_segments.empty())
+        {
+            OE_INFO << LC << "Rebuilding index for \"" << _path << "\"" << std::endl;
+        }
+
+        if (!rebuildIndex())
+        {
+            error = "Failed to rebuild index in \"" + _path + "\"";
+            closeIndex();
+            return false;
+        }
+    }
+
+    // mark the index dirty until we close it cleanly.
+    header()->clean = 0u;
+    _index->sync();
+
+    _open = true;
+    return true;
+}
+
+void
+PackedStore::close()
+{
+    _open = false;
+
+    std::lock_guard<std::mutex> compactLock(_compactMutex);
+    std::lock_guard<std::mutex> appendLock(_appendMutex);
+    ScopedWriteLock lock(_indexMutex);
+
+    closeIndex();
+}
+
+void
+PackedStore::closeIndex()
+{
+    // caller holds all three locks. Every accessor re-checks _index
+    // under its lock, since it may have passed isOpen() before this ran.
+    if (_index)
+    {
+        if (_index->data())
+        {
+            header()->clean = 1u;
+            _index->sync();
+        }
+        _index.reset();
+    }
+    _segments.clear();
+    _nextSegmentId = 0u;
+    _rollover = false;
+}
+
+bool
+PackedStore::createIndex(std::uint64_t capacity)
+{
+    capacity = nextPowerOf2(std::max<std::uint64_t>(capacity, MIN_INDEX_CAPACITY));
+
+    if (!_index->resize(sizeof(Header) + capacity * sizeof(Slot)))
+        return false;
+
+    ::memset(_index->data(), 0, _index->size());
+
+    Header* h = header();
+    h->magic = INDEX_MAGIC;
+    h->version = INDEX_VERSION;
+    h->capacity = capacity;
+    return true;
+}
+
+bool
+PackedStore::rebuildIndex()
+{
+    if (!createIndex(MIN_INDEX_CAPACITY))
+        return false;
+
+    std::uint64_t totalBytes = 0u;
+    std::uint64_t liveBytes = 0u;
+
+    std::string key;
+    for (auto& segment : _segments)
+    {
+        std::uint64_t offset = 0u;
+        std::uint64_t size = segment->_size;
+        RecordHeader rh;
+
+        while (offset + sizeof(RecordHeader) <= size)
+        {
+            if (!segment->readAt(offset, (char*)&rh, sizeof(RecordHeader)) ||
+                rh.magic != RECORD_MAGIC)
+            {
+                break;
+            }
+
+            std::uint64_t length = sizeof(RecordHeader) + (std::uint64_t)rh.keyLength + rh.metaLength + rh.dataLength;
+            if (offset + length > size || length > 0xffffffffu)
+                break;
+
+            key.resize(rh.keyLength);
+            if (rh.keyLength > 0 && !segment->readAt(offset + sizeof(RecordHeader), &key[0], rh.keyLength))
+                break;
+
+            KeyHash hash = hashKey(key);
+            Slot* slot = findSlot(hash);
+            if (slot)
+            {
+                liveBytes -= slot->length;
+            }
+
+            if ((rh.flags & FLAG_TOMBSTONE) != 0)
+            {
+                if (slot)
+                    eraseSlot(slot);
+            }
+            else
+            {
+                if (!slot)
+                {
+                    if (!growIndex())
+                        return false;
+                    slot = insertSlot(hash);
+                }
+                slot->segment = segment->_id;
+                slot->offset = offset;
+                slot->length = (std::uint32_t)length;
+                slot->timestamp = rh.timestamp;
+                liveBytes += length;
+            }
+
+            offset += length;
+        }
+
+        if (offset < size)
+        {
+            // A partial record at the end of a segment (e.g. from a crash
+            // during a write). Drop it so new appends start on a boundary.
+            OE_WARN << LC << "Truncating damaged segment \"" << segment->_path
+                << "\" at offset " << offset << std::endl;
+            segment->truncate(offset);
+        }
+
+        totalBytes += segment->_size;
+    }
+
+    header()->deadBytes = totalBytes - liveBytes;
+    return true;
+}
+
+bool
+PackedStore::growIndex()
+{
+    Header* h = header();
+
+    // keep the load factor (including deleted slots) under 3/4
+    if ((h->used + 1u) * 4u <= h->capacity * 3u)
+        return true;
+
+    std::vector<Slot> live;
+    live.reserve(h->count);
+    Slot* slots = reinterpret_cast<Slot*>(_index->data() + sizeof(Header));
+    for (std::uint64_t i = 0; i < h->capacity; ++i)
+    {
+        if (slots[i].hash > DELETED_HASH)
+            live.push_back(slots[i]);
+    }
+
+    // double if mostly live; otherwise just sweep out the deleted slots.
+    std::uint64_t capacity = h->capacity;
+    if ((live.size() + 1u) * 2u > capacity)
+        capacity *= 2u;
+
+    std::uint64_t deadBytes = h->deadBytes;
+
+    if (!createIndex(capacity))
+        return false;
+
+    header()->deadBytes = deadBytes;
+
+    for (auto& s : live)
+    {
+        Slot* slot = insertSlot(keyHashOf(s));
+        *slot = s;
+    }
+    return true;
+}
+
+PackedStore::Slot*
+PackedStore::findSlot(const KeyHash& hash) const
+{
+    const Header* h = header();
+    Slot* slots = reinterpret_cast<Slot*>(_index->data() + sizeof(Header));
+    std::uint64_t mask = h->capacity - 1u;
+
+    for (std::uint64_t i = hash.hash & mask, n = 0; n < h->capacity; i = (i + 1u) & mask, ++n)
+    {
+        if (slots[i].hash == hash.hash &&
+            slots[i].check == hash.check &&
+            slots[i].keyLength == hash.length)
+        {
+            return &slots[i];
+        }
+        if (slots[i].hash == EMPTY_HASH)
+            return nullptr;
+    }
+    return nullptr;
+}
+
+PackedStore::Slot*
+PackedStore::insertSlot(const KeyHash& hash)
+{
+    Slot* existing = findSlot(hash);
+    if (existing)
+        return existing;
+
+    Header* h = header();
+    Slot* slots = reinterpret_cast<Slot*>(_index->data() + sizeof(Header));
+    std::uint64_t mask = h->capacity - 1u;
+
+    for (std::uint64_t i = hash.hash & mask; ; i = (i + 1u) & mask)
+    {
+        if (slots[i].hash <= DELETED_HASH)
+        {
+            if (slots[i].hash == EMPTY_HASH)
+                h->used++;
+            h->count++;
+            ::memset(&slots[i], 0, sizeof(Slot));
+            slots[i].hash = hash.hash;
+            slots[i].check = hash.check;
+            slots[i].keyLength = hash.length;
+            return &slots[i];
+        }
+    }
+}
+
+void
+PackedStore::eraseSlot(Slot* slot)
+{
+    slot->hash = DELETED_HASH;
+    header()->count--;
+}
+
+PackedStore::SegmentPtr
+PackedStore::getSegment(std::uint32_t id) const
+{
+    for (auto& segment : _segments)
+        if (segment->_id == id)
+            return segment;
+    return nullptr;
+}
+
+PackedStore::SegmentPtr
+PackedStore::getWriteSegment(std::uint64_t bytes)
+{
+    // caller holds _appendMutex
+    SegmentPtr active;
+    {
+        ScopedReadLock lock(_indexMutex);
+        if (!_segments.empty())
+            active = _segments.back();
+    }
+
+    if (!active || _rollover ||
+        (active->_size > 0u && active->_size + bytes > _maxSegmentSize))
+    {
+        auto segment = std::make_shared<SegmentFile>(_nextSegmentId, segmentFileName(_nextSegmentId));
+        if (!segment->open())
+        {
+            OE_WARN << LC << "Failed to create segment \"" << segment->_path << "\"" << std::endl;
+            return nullptr;
+        }
+        _nextSegmentId++;
+        _rollover = false;
+
+        ScopedWriteLock lock(_indexMutex);
+        _segments.push_back(segment);
+        active = segment;
+    }
+
+    return active;
+}
+
+bool
+PackedStore::append(const std::string& record, Location& out)
+{
+    // caller holds _appendMutex
+    SegmentPtr segment = getWriteSegment(record.size());
+    if (!segment)
+        return false;
+
+    std::uint64_t offset = segment->_size;
+    if (!segment->writeAt(offset, record.data(), record.size()))
+    {
+        OE_WARN << LC << "Failed to write to segment \"" << segment->_path << "\"" << std::endl;
+        return false;
+    }
+    segment->_size = offset + record.size();
+
+    out.segment = segment->_id;
+    out.offset = offset;
+    out.length = (std::uint32_t)record.size();
+    return true;
+}
+
+void
+PackedStore::encode(
+    const std::string& key,
+    const std::string& data,
+    const std::string& meta,
+    std::time_t timestamp,
+    std::uint32_t flags,
+    std::string& out)
+{
+    RecordHeader rh;
+    rh.magic = RECORD_MAGIC;
+    rh.flags = flags;
+    rh.keyLength = (std::uint32_t)key.size();
+    rh.metaLength = (std::uint32_t)meta.size();
+    rh.dataLength = (std::uint32_t)data.size();
+    rh.reserved = 0u;
+    rh.timestamp = (std::int64_t)timestamp;
+
+    out.reserve(sizeof(RecordHeader) + key.size() + meta.size() + data.size());
+    out.assign((const char*)&rh, sizeof(RecordHeader));
+    out.append(key);
+    out.append(meta);
+    out.append(data);
+}
+
+bool
+PackedStore::readRecord(
+    const SegmentPtr& segment,
+    const Location& location,
+    const std::string& key,
+    Record* out) const
+{
+    std::string buf;
+    buf.resize(location.length);
+    if (location.length < sizeof(RecordHeader) ||
+        !segment->readAt(location.offset, &buf[0], location.length))
+    {
+        return false;
+    }
+
+    RecordHeader rh;
+    ::memcpy(&rh, buf.data(), sizeof(RecordHeader));
+
+    if (rh.magic != RECORD_MAGIC ||
+        (rh.flags & FLAG_TOMBSTONE) != 0 ||
+        sizeof(RecordHeader) + (std::uint64_t)rh.keyLength + rh.metaLength + rh.dataLength != location.length ||
+        buf.compare(sizeof(RecordHeader), rh.keyLength, key) != 0)
+    {
+        // corrupt record or a (very unlikely) hash collision
+        return false;
+    }
+
+    if (out)
+    {
+        std::size_t pos = sizeof(RecordHeader) + rh.keyLength;
+        out->meta.assign(buf, pos, rh.metaLength);
+        out->data.assign(buf, pos + rh.metaLength, rh.dataLength);
+    }
+    return true;
+}
+
+bool
+PackedStore::put(const std::string& key, const std::string& data, const std::string& meta)
+{
+    if (!isOpen())
+        return false;
+
+    std::time_t now = ::time(nullptr);
+
+    std::string record;
+    encode(key, data, meta, now, 0u, record);
+
+    KeyHash hash = hashKey(key);
+
+    std::lock_guard<std::mutex> appendLock(_appendMutex);
+    if (!_index)
+        return false;
+
+    Location location;
+    if (!append(record, location))
+        return false;
+
+    ScopedWriteLock lock(_indexMutex);
+
+    if (!growIndex())
+        return false;
+
+    Slot* slot = findSlot(hash);
+    if (slot)
+        header()->deadBytes += slot->length;
+    else
+        slot = insertSlot(hash);
+
+    slot->segment = location.segment;
+    slot->offset = location.offset;
+    slot->length = location.length;
+    slot->timestamp = now;
+    return true;
+}
+
+bool
+PackedStore::get(const std::string& key, Record& out) const
+{
+    if (!isOpen())
+        return false;
+
+    Location location;
+    SegmentPtr segment;
+    std::int64_t timestamp;
+    {
+        ScopedReadLock lock(_indexMutex);
+        if (!_index)
+            return false;
+
+        Slot* slot = findSlot(hashKey(key));
+        if (!slot)
+            return false;
+
+        location.segment = slot->segment;
+        location.offset = slot->offset;
+        location.length = slot->length;
+        timestamp = slot->timestamp;
+        segment = getSegment(location.segment);
+    }
+
+    // The read happens outside the lock. If compaction retires this
+    // segment in the meantime, our reference keeps the file open.
+    if (!segment || !readRecord(segment, location, key, &out))
+        return false;
+
+    out.timestamp = (std::time_t)timestamp;
+    return true;
+}
+
+bool
+PackedStore::contains(const std::string& key, std::time_t* timestamp) const
+{
+    if (!isOpen())
+        return false;
+
+    ScopedReadLock lock(_indexMutex);
+    if (!_index)
+        return false;
+
+    Slot* slot = findSlot(hashKey(key));
+    if (slot && timestamp)
+        *timestamp = (std::time_t)slot->timestamp;
+    return slot != nullptr;
+}
+
+bool
+PackedStore::remove(const std::string& key)
+{
+    if (!isOpen())
+        return false;
+
+    KeyHash hash = hashKey(key);
+
+    std::lock_guard<std::mutex> appendLock(_appendMutex);
+
+    if (!contains(key))
+        return false;
+
+    std::string record;
+    encode(key, std::string(), std::string(), ::time(nullptr), FLAG_TOMBSTONE, record);
+
+    Location location;
+    if (!append(record, location))
+        return false;
+
+    ScopedWriteLock lock(_indexMutex);
+    header()->deadBytes += location.length;
+
+    Slot* slot = findSlot(hash);
+    if (slot)
+    {
+        header()->deadBytes += slot->length;
+        eraseSlot(slot);
+    }
+    return true;
+}
+
+bool
+PackedStore::touch(const std::string& key)
+{
+    if (!isOpen())
+        return false;
+
+    // The append lock keeps compaction from moving the record while we
+    // update it.
+    std::lock_guard<std::mutex> appendLock(_appendMutex);
+    ScopedWriteLock lock(_indexMutex);
+    if (!_index)
+        return false;
+
+    Slot* slot = findSlot(hashKey(key));
+    if (!slot)
+        return false;
+
+    slot->timestamp = (std::int64_t)::time(nullptr);
+
+    // Also stamp the record itself, so the time survives an index rebuild.
+    SegmentPtr segment = getSegment(slot->segment);
+    if (segment)
+    {
+        segment->writeAt(
+            slot->offset + offsetof(RecordHeader, timestamp),
+            (const char*)&slot->timestamp,
+            sizeof(slot->timestamp));
+    }
+    return true;
+}
+
+bool
+PackedStore::clear()
+{
+    if (!isOpen())
+        return false;
+
+    std::lock_guard<std::mutex> compactLock(_compactMutex);
+    std::lock_guard<std::mutex> appendLock(_appendMutex);
+    ScopedWriteLock lock(_indexMutex);
+    if (!_index)
+        return false;
+
+    for (auto& segment : _segments)
+        segment->_obsolete = true;
+    _segments.clear();
+
+    if (!createIndex(MIN_INDEX_CAPACITY))
+        return false;
+
+    header()->clean = 0u;
+    _index->sync();
+    return true;
+}
+
+std::uint64_t
+PackedStore::compact()
+{
+    if (!isOpen())
+        return 0u;
+
+    std::lock_guard<std::mutex> compactLock(_compactMutex);
+
+    // close() needs the compaction lock, so the index stays put from here.
+    if (!_index || getDeadBytes() == 0u)
+        return 0u;
+
+    // Seal the active segment so that every existing segment is immutable;
+    // new writes (including our copies) go to a fresh segment.
+    std::uint32_t firstNewId;
+    {
+        std::lock_guard<std::mutex> appendLock(_appendMutex);
+        _rollover = true;
+        firstNewId = _nextSegmentId;
+    }
+
+    // Snapshot the live records that sit in the old segments.
+    std::vector<std::pair<KeyHash, Location>> live;
+    std::uint64_t bytesBefore = 0u;
+    {
+        ScopedReadLock lock(_indexMutex);
+
+        for (auto& segment : _segments)
+            bytesBefore += segment->_size;
+
+        const Header* h = header();
+        const Slot* slots = reinterpret_cast<const Slot*>(_index->data() + sizeof(Header));
+        for (std::uint64_t i = 0; i < h->capacity; ++i)
+        {
+            if (slots[i].hash > DELETED_HASH && slots[i].segment < firstNewId)
+            {
+                Location location;
+                location.segment = slots[i].segment;
+                location.offset = slots[i].offset;
+                location.length = slots[i].length;
+                live.emplace_back(keyHashOf(slots[i]), location);
+            }
+        }
+    }
+
+    // Copy each record that is still current into the active segment.
+    std::string buf;
+    for (auto& entry : live)
+    {
+        const Location& from = entry.second;
+
+        SegmentPtr segment;
+        {
+            ScopedReadLock lock(_indexMutex);
+            segment = getSegment(from.segment);
+        }
+
+        buf.resize(from.length);
+        if (!segment || !segment->readAt(from.offset, &buf[0], from.length))
+        {
+            OE_WARN << LC << "Compaction failed to read a record; stopping" << std::endl;
+            return 0u;
+        }
+
+        // All changes to record locations hold the append lock, so the
+        // slot cannot move between the check and the update below.
+        std::lock_guard<std::mutex> appendLock(_appendMutex);
+        {
+            ScopedReadLock lock(_indexMutex);
+            Slot* slot = findSlot(entry.first);
+            if (!slot || slot->segment != from.segment || slot->offset != from.offset)
+                continue; // overwritten or removed since the snapshot
+
+            // carry over a touch() that landed after the read above
+            ::memcpy(&buf[offsetof(RecordHeader, timestamp)], &slot->timestamp, sizeof(slot->timestamp));
+        }
+
+        Location to;
+        if (!append(buf, to))
+        {
+            OE_WARN << LC << "Compaction failed to write a record; stopping" << std::endl;
+            return 0u;
+        }
+
+        ScopedWriteLock lock(_indexMutex);
+        Slot* slot = findSlot(entry.first);
+        if (slot)
+        {
+            slot->segment = to.segment;
+            slot->offset = to.offset;
+        }
+    }
+
+    // Retire the old segments; each file is deleted once the last reader
+    // holding a reference to it lets go.
+    std::lock_guard<std::mutex> appendLock(_appendMutex);
+    ScopedWriteLock lock(_indexMutex);
+
+    std::vector<SegmentPtr> keep;
+    for (auto& segment : _segments)
+    {
+        if (segment->_id < firstNewId)
+            segment->_obsolete = true;
+        else
+            keep.push_back(segment);
+    }
+    _segments.swap(keep);
+
+    // Recount the dead space from scratch.
+    std::uint64_t totalBytes = 0u, liveBytes = 0u;
+    for (auto& segment : _segments)
+        totalBytes += segment->_size;
+
+    Header* h = header();
+    const Slot* slots = reinterpret_cast<const Slot*>(_index->data() + sizeof(Header));
+    for (std::uint64_t i = 0; i < h->capacity; ++i)
+        if (slots[i].hash > DELETED_HASH)
+            liveBytes += slots[i].length;
+
+    h->deadBytes = totalBytes - liveBytes;
+    _index->sync();
+
+    return bytesBefore > totalBytes ? bytesBefore - totalBytes : 0u;
+}
+
+std::uint64_t
+PackedStore::getNumRecords() const
+{
+    if (!isOpen())
+        return 0u;
+    ScopedReadLock lock(_indexMutex);
+    return _index ? header()->count : 0u;
+}
+
+std::uint64_t
+PackedStore::getTotalBytes() const
+{
+    if (!isOpen())
+        return 0u;
+    ScopedReadLock lock(_indexMutex);
+    std::uint64_t total = 0u;
+    for (auto& segment : _segments)
+        total += segment->_size;
+    return total;
+}
+
+std::uint64_t
+PackedStore::getDeadBytes() const
+{
+    if (!isOpen())
+        return 0u;
+    ScopedReadLock lock(_indexMutex);
+    return _index ? header()->deadBytes : 0u;
+}
+
+unsigned
+PackedStore::getNumSegments() const
+{
+    if (!isOpen())
+        return 0u;
+    ScopedReadLock lock(_indexMutex);
+    return (unsigned)_segments.size();
+}
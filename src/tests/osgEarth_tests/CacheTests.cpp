@@ -24,8 +24,16 @@
 #include <osgEarth/GeoData>
 #include <osgEarth/Registry>
 #include <osgEarth/MemCache>
+#include <osgEarth/Containers>
+#include <osgEarth/WriteBehindCacheBin>
+#include <osgEarth/NegativeTileCache>
+#include <osgEarth/TileKey>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 using namespace osgEarth;
+using namespace osgEarth::Util;
 
 TEST_CASE( "Cache" ) {
 
@@ -83,3 +91,313 @@ TEST_CASE( "Cache" ) {
         REQUIRE(r2.failed());
     }  
 }
+
+TEST_CASE( "Sharded MemCache" ) {
+
+    osg::ref_ptr<Cache> cache = new MemCache(64, true);
+    osg::ref_ptr<CacheBin> bin = cache->addBin("test_bin");
+    REQUIRE(bin.valid());
+
+    std::string value("What is the sound of one hand clapping?");
+    REQUIRE(bin->write("key", new StringObject(value), 0L));
+
+    ReadResult r = bin->readString("key", 0L);
+    REQUIRE(r.succeeded());
+    REQUIRE(r.getString().compare(value) == 0);
+
+    REQUIRE(bin->remove("key"));
+    REQUIRE(bin->readString("key", 0L).failed());
+}
+
+TEST_CASE( "MemCache byte budget" ) {
+
+    // 64x64 RGBA = 16KB of pixels per image
+    auto makeImage = []() {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(64, 64, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        return image;
+    };
+
+    SECTION("Per-bin budget")
+    {
+        osg::ref_ptr<MemCache> cache = new MemCache(1000u);
+        cache->setMaxBinSizeInBytes(100u * 1024u);
+        osg::ref_ptr<CacheBin> bin = cache->addBin("images");
+
+        for (int i = 0; i < 20; ++i)
+            REQUIRE(bin->write(std::to_string(i), makeImage(), Config(), 0L));
+
+        REQUIRE(cache->getSizeInBytes() <= 100u * 1024u);
+        REQUIRE(cache->getSizeInBytes() > 0u);
+
+        // most recent entry survives, oldest is gone
+        REQUIRE(bin->readImage("19", 0L).succeeded());
+        REQUIRE(bin->readImage("0", 0L).failed());
+    }
+
+    SECTION("Cache-wide budget")
+    {
+        osg::ref_ptr<MemCache> cache = new MemCache(1000u);
+        cache->setMaxSizeInBytes(200u * 1024u);
+        osg::ref_ptr<CacheBin> bin1 = cache->addBin("one");
+        osg::ref_ptr<CacheBin> bin2 = cache->addBin("two");
+
+        for (int i = 0; i < 20; ++i)
+        {
+            REQUIRE(bin1->write(std::to_string(i), makeImage(), Config(), 0L));
+            REQUIRE(bin2->write(std::to_string(i), makeImage(), Config(), 0L));
+        }
+
+        CacheStats stats = cache->getStats();
+        REQUIRE(stats._cost <= 200u * 1024u);
+        REQUIRE(stats._maxCost == 200u * 1024u);
+        REQUIRE(stats._entries < 40u);
+        REQUIRE(bin1->readImage("19", 0L).succeeded());
+        REQUIRE(bin2->readImage("19", 0L).succeeded());
+
+        // shrinking the budget evicts immediately
+        cache->setMaxSizeInBytes(50u * 1024u);
+        REQUIRE(cache->getSizeInBytes() <= 50u * 1024u);
+    }
+}
+
+TEST_CASE( "ShardedLRUCache" ) {
+
+    ShardedLRUCache<int, int> cache(64, 4);
+    REQUIRE(cache.getNumShards() == 4);
+
+    SECTION("Insert and get")
+    {
+        cache.insert(1, 10);
+        ShardedLRUCache<int, int>::Record rec;
+        REQUIRE(cache.get(1, rec));
+        REQUIRE(rec.value() == 10);
+        REQUIRE(cache.has(1));
+        cache.erase(1);
+        REQUIRE(!cache.has(1));
+    }
+
+    SECTION("Size stays bounded and recently used entries survive")
+    {
+        ShardedLRUCache<int, int>::Record rec;
+        cache.insert(0, 0);
+        for (int i = 1; i < 1000; ++i)
+        {
+            cache.insert(i, i);
+            cache.get(0, rec);
+        }
+        REQUIRE(cache.getStats()._entries <= 64);
+        REQUIRE(cache.get(0, rec));
+    }
+
+    SECTION("Erased slots are reused before evicting")
+    {
+        ShardedLRUCache<int, int> single(8, 1);
+        for (int i = 0; i < 8; ++i)
+            single.insert(i, i);
+        single.erase(5);
+        single.insert(100, 100);
+
+        REQUIRE(single.getStats()._entries == 8);
+        for (int i = 0; i < 8; ++i)
+            REQUIRE(single.has(i) == (i != 5));
+        REQUIRE(single.has(100));
+    }
+}
+
+namespace CacheTests
+{
+    // Runs "numThreads" threads that each do "count" mixed reads and writes
+    // against the cache and returns the elapsed time in seconds.
+    template<typename CACHE>
+    double hammer(CACHE& cache, unsigned numThreads, unsigned count)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&cache, t, count]()
+            {
+                typename CACHE::Record rec;
+                unsigned seed = t + 1;
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    seed = seed * 1103515245u + 12345u;
+                    int key = (seed >> 16) % 2048;
+                    if (!cache.get(key, rec))
+                        cache.insert(key, key);
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Cache bin that takes a while to write, like a slow disk.
+    struct SlowCacheBin : public CacheBin
+    {
+        osg::ref_ptr<CacheBin> _bin;
+        std::atomic_uint _writes;
+
+        SlowCacheBin(CacheBin* bin) : CacheBin(bin->getID()), _bin(bin), _writes(0u) { }
+
+        ReadResult readObject(const std::string& key, const osgDB::Options* dbo) override { return _bin->readObject(key, dbo); }
+        ReadResult readImage(const std::string& key, const osgDB::Options* dbo) override { return _bin->readImage(key, dbo); }
+        ReadResult readString(const std::string& key, const osgDB::Options* dbo) override { return _bin->readString(key, dbo); }
+        RecordStatus getRecordStatus(const std::string& key) override { return _bin->getRecordStatus(key); }
+        bool remove(const std::string& key) override { return _bin->remove(key); }
+        bool touch(const std::string& key) override { return _bin->touch(key); }
+
+        bool write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo) override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++_writes;
+            return _bin->write(key, object, meta, dbo);
+        }
+    };
+}
+
+TEST_CASE( "WriteBehindCacheBin" ) {
+
+    osg::ref_ptr<MemCache> cache = new MemCache(1000u);
+    osg::ref_ptr<CacheTests::SlowCacheBin> slow = new CacheTests::SlowCacheBin(cache->addBin("slow"));
+    osg::ref_ptr<WriteBehindCacheBin> bin = new WriteBehindCacheBin(slow.get(), 4u);
+
+    SECTION("Pending writes are readable and reach the wrapped bin")
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            REQUIRE(bin->write(std::to_string(i), new StringObject(std::to_string(i)), 0L));
+            REQUIRE(bin->readString(std::to_string(i), 0L).getString() == std::to_string(i));
+        }
+
+        bin->flush();
+
+        for (int i = 0; i < 16; ++i)
+            REQUIRE(slow->readString(std::to_string(i), 0L).getString() == std::to_string(i));
+
+        WriteBehindCacheBin::Stats stats = bin->getStats();
+        REQUIRE(stats.queueDepth == 0u);
+        REQUIRE(stats.maxQueueDepth <= 4u);
+        REQUIRE(stats.flushed == 16u);
+        REQUIRE(stats.maxFlushLatencyMs > 0.0);
+    }
+
+    SECTION("Writes to a queued key are coalesced")
+    {
+        // occupy the writer so the next writes stay queued
+        REQUIRE(bin->write("busy", new StringObject("busy"), 0L));
+        for (int i = 0; i < 10; ++i)
+            REQUIRE(bin->write("key", new StringObject(std::to_string(i)), 0L));
+
+        REQUIRE(bin->readString("key", 0L).getString() == "9");
+        bin->flush();
+
+        REQUIRE(slow->readString("key", 0L).getString() == "9");
+        REQUIRE(slow->_writes < 11u);
+    }
+
+    SECTION("The queue holds copies")
+    {
+        REQUIRE(bin->getEnableNodeCaching() == slow->getEnableNodeCaching());
+
+        osg::ref_ptr<StringObject> value = new StringObject("before");
+        REQUIRE(bin->write("key", value.get(), 0L));
+        value->setString("after");
+
+        REQUIRE(bin->readString("key", 0L).getString() == "before");
+        bin->flush();
+        REQUIRE(slow->readString("key", 0L).getString() == "before");
+    }
+
+    SECTION("Removing a queued key")
+    {
+        REQUIRE(bin->write("busy", new StringObject("busy"), 0L));
+        REQUIRE(bin->write("gone", new StringObject("gone"), 0L));
+        bin->remove("gone");
+        REQUIRE(bin->getRecordStatus("gone") == CacheBin::STATUS_NOT_FOUND);
+        bin->flush();
+        REQUIRE(slow->readString("gone", 0L).failed());
+    }
+
+    SECTION("Removing a key while it is being written")
+    {
+        REQUIRE(slow->write("key", new StringObject("old"), 0L));
+        REQUIRE(bin->write("key", new StringObject("new"), 0L));
+
+        // give the writer time to pick it up; the slow write takes longer
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        REQUIRE(bin->remove("key"));
+
+        // the old record must not show through
+        REQUIRE(bin->readString("key", 0L).failed());
+        REQUIRE(bin->getRecordStatus("key") == CacheBin::STATUS_NOT_FOUND);
+        bin->flush();
+        REQUIRE(slow->readString("key", 0L).failed());
+        REQUIRE(bin->readString("key", 0L).failed());
+    }
+}
+
+TEST_CASE( "NegativeTileCache" ) {
+
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    NegativeTileCache cache(100);
+
+    for (unsigned i = 0; i < 100; ++i)
+        cache.insert(TileKey(10, i, i, profile.get()), 1);
+
+    SECTION("Recorded keys are found") {
+        for (unsigned i = 0; i < 100; ++i)
+            REQUIRE(cache.contains(TileKey(10, i, i, profile.get()), 1));
+    }
+
+    SECTION("Other keys are never reported, despite filter false positives") {
+        for (unsigned i = 0; i < 10000; ++i)
+            REQUIRE(cache.contains(TileKey(11, i, i, profile.get()), 1) == false);
+        REQUIRE(cache.getStats().rejected > 0u);
+    }
+
+    SECTION("A new revision invalidates everything") {
+        REQUIRE(cache.contains(TileKey(10, 5, 5, profile.get()), 2) == false);
+        cache.insert(TileKey(10, 200, 200, profile.get()), 2);
+        REQUIRE(cache.contains(TileKey(10, 5, 5, profile.get()), 2) == false);
+        REQUIRE(cache.getStats().entries == 1u);
+    }
+
+    SECTION("The oldest keys are evicted at capacity") {
+        cache.insert(TileKey(10, 100, 100, profile.get()), 1);
+        REQUIRE(cache.getStats().entries == 100u);
+        REQUIRE(cache.contains(TileKey(10, 0, 0, profile.get()), 1) == false);
+        REQUIRE(cache.contains(TileKey(10, 100, 100, profile.get()), 1));
+    }
+
+    SECTION("The size is fixed after first use") {
+        cache.setMaxSize(10);
+        REQUIRE(cache.getMaxSize() == 100u);
+        REQUIRE(cache.contains(TileKey(10, 5, 5, profile.get()), 1));
+
+        // the same size only clears it
+        cache.setMaxSize(100);
+        REQUIRE(cache.getStats().entries == 0u);
+    }
+}
+
+TEST_CASE( "LRUCache contention benchmark", "[.benchmark]" ) {
+
+    const unsigned count = 200000;
+
+    for (unsigned numThreads = 1; numThreads <= 64; numThreads *= 2)
+    {
+        LRUCache<int, int> lru(true, 1024);
+        ShardedLRUCache<int, int> sharded(1024);
+
+        double lruSeconds = CacheTests::hammer(lru, numThreads, count);
+        double shardedSeconds = CacheTests::hammer(sharded, numThreads, count);
+
+        OE_NOTICE << "threads=" << numThreads
+            << ", LRUCache ops/sec=" << (unsigned)(numThreads*count / lruSeconds)
+            << ", ShardedLRUCache ops/sec=" << (unsigned)(numThreads*count / shardedSeconds)
+            << std::endl;
+    }
+}
@@ -0,0 +1,137 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ElevationPack>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/Map>
+#include <cstdio>
+
+using namespace osgEarth;
+
+namespace ElevationPackTests
+{
+    const std::string filename("osgearth_tests_elevation.pack");
+
+    // Heightfield whose value encodes the sample position and tile
+    osg::HeightField* createHeightField(unsigned size, float base)
+    {
+        osg::HeightField* hf = new osg::HeightField();
+        hf->allocate(size, size);
+        for (unsigned r = 0; r < size; ++r)
+            for (unsigned c = 0; c < size; ++c)
+                hf->setHeight(c, r, base + (float)(r * size + c) * 0.01f);
+        return hf;
+    }
+}
+
+TEST_CASE("ElevationPack")
+{
+    const unsigned size = 257;
+    ::remove(ElevationPackTests::filename.c_str());
+
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+
+    TileKey full(1, 0, 0, profile.get());
+    TileKey partial(1, 1, 0, profile.get());
+    TileKey missing(1, 2, 0, profile.get());
+
+    osg::ref_ptr<osg::HeightField> fullHF = ElevationPackTests::createHeightField(size, 100.0f);
+    osg::ref_ptr<osg::HeightField> partialHF = ElevationPackTests::createHeightField(size, 200.0f);
+    partialHF->setHeight(10, 10, NO_DATA_VALUE);
+
+    {
+        ElevationPack::Writer writer;
+        REQUIRE(writer.open(ElevationPackTests::filename, profile.get(), size).isOK());
+        REQUIRE(writer.write(partial, partialHF.get()).isOK());
+        REQUIRE(writer.write(full, fullHF.get()).isOK());
+        REQUIRE(writer.close().isOK());
+    }
+
+    SECTION("Round trip")
+    {
+        Status status;
+        osg::ref_ptr<ElevationPack> pack = ElevationPack::open(ElevationPackTests::filename, status);
+        REQUIRE(status.isOK());
+        REQUIRE(pack->getNumTiles() == 2u);
+        REQUIRE(pack->getTileSize() == size);
+        REQUIRE(pack->getProfile()->isHorizEquivalentTo(profile.get()));
+
+        REQUIRE(pack->hasTile(full));
+        REQUIRE(pack->hasTile(partial));
+        REQUIRE_FALSE(pack->hasTile(missing));
+        REQUIRE(pack->isComplete(full));
+        REQUIRE_FALSE(pack->isComplete(partial));
+
+        GeoHeightField hf = pack->getHeightField(partial);
+        REQUIRE(hf.valid());
+        REQUIRE(hf.getHeightField()->getFloatArray()->asVector() == partialHF->getFloatArray()->asVector());
+
+        // views point into the mapping, so two views share the same memory
+        GeoImage view1 = pack->getImageView(full);
+        GeoImage view2 = pack->getImageView(full);
+        REQUIRE(view1.valid());
+        REQUIRE(view1.getImage()->data() == view2.getImage()->data());
+        REQUIRE(memcmp(view1.getImage()->data(), fullHF->getFloatArray()->getDataPointer(), sizeof(float) * size * size) == 0);
+    }
+
+    SECTION("Layer")
+    {
+        osg::ref_ptr<ElevationPackLayer> layer = new ElevationPackLayer();
+        layer->setURL(ElevationPackTests::filename);
+        REQUIRE(layer->open().isOK());
+
+        REQUIRE(layer->createHeightImageView(full).valid());
+        REQUIRE_FALSE(layer->createHeightImageView(partial).valid());
+
+        GeoHeightField hf = layer->createHeightField(full, nullptr);
+        REQUIRE(hf.valid());
+        REQUIRE(hf.getHeightField()->getHeight(5, 7) == fullHF->getHeight(5, 7));
+
+        // the pool uses the view for the complete tile, centered at (-135, 45)
+        osg::ref_ptr<Map> map = new Map();
+        map->addLayer(layer.get());
+
+        GeoPoint p(profile->getSRS(), -135.0, 45.0, 0.0);
+        ElevationSample sample = map->getElevationPool()->getSample(p, Distance(full.getResolution(size).second, Units::DEGREES), nullptr, nullptr);
+        REQUIRE(sample.hasData());
+        REQUIRE(sample.elevation().getValue() == Approx(fullHF->getHeight(128, 128)).margin(1e-3));
+
+        // only the view path shares the pack's mapped memory
+        osg::ref_ptr<ElevationTexture> tex;
+        REQUIRE(map->getElevationPool()->getTile(full, false, tex, nullptr, nullptr));
+        REQUIRE(tex.valid());
+        GeoImage view = layer->createHeightImageView(full);
+        REQUIRE(tex->getImage(0)->data() == view.getImage()->data());
+
+        // the lazily built heightfield is georeferenced like the tile
+        const osg::HeightField* texHF = tex->getHeightField();
+        REQUIRE(texHF != nullptr);
+        REQUIRE(texHF->getOrigin().x() == Approx(full.getExtent().xMin()));
+        REQUIRE(texHF->getOrigin().y() == Approx(full.getExtent().yMin()));
+        REQUIRE(texHF->getXInterval() == Approx(full.getExtent().width() / (double)(size - 1)));
+        REQUIRE(texHF->getYInterval() == Approx(full.getExtent().height() / (double)(size - 1)));
+    }
+
+    ::remove(ElevationPackTests::filename.c_str());
+}
@@ -0,0 +1,507 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Map>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/Composite>
+#include <osgEarth/HeightFieldUtils>
+#include <osgEarth/GDAL>
+#include <osgEarth/Notify>
+#include <osgEarth/Progress>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using namespace osgEarth;
+
+namespace ElevationPoolTests
+{
+    // Map containing the Mt. Rainier DEM, which covers [-122..-121, 46..47].
+    Map* createMap()
+    {
+        Map* map = new Map();
+        GDALElevationLayer* layer = new GDALElevationLayer();
+        layer->setURL("../data/terrain/mt_rainier_90m.tif");
+        map->addLayer(layer);
+        return map;
+    }
+
+    // Points scattered around (x, y) within +/- spread degrees.
+    std::vector<osg::Vec3d> createPoints(unsigned count, double x, double y, double spread, unsigned seed)
+    {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<double> d(-spread, spread);
+        std::vector<osg::Vec3d> points;
+        points.reserve(count);
+        for (unsigned i = 0; i < count; ++i)
+            points.emplace_back(x + d(gen), y + d(gen), 0.0);
+        return points;
+    }
+}
+
+TEST_CASE("ElevationPool batch sampling matches per-point sampling")
+{
+    osg::ref_ptr<Map> map = ElevationPoolTests::createMap();
+    REQUIRE(map->getLayerAt(0)->getStatus().isOK());
+
+    ElevationPool* pool = map->getElevationPool();
+    Distance resolution(90.0, Units::METERS);
+
+    // Includes points outside the DEM so fallback tiles are exercised too
+    std::vector<osg::Vec3d> points = ElevationPoolTests::createPoints(2000, -121.5, 46.5, 0.6, 1);
+
+    SECTION("Vec3d input")
+    {
+        std::vector<osg::Vec3d> batch = points;
+        int count = pool->sampleMapCoords(batch.begin(), batch.end(), resolution, nullptr, nullptr);
+        REQUIRE(count > 0);
+
+        int scalarCount = 0;
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            std::vector<osg::Vec3d> one(1, points[i]);
+            if (pool->sampleMapCoords(one.begin(), one.end(), resolution, nullptr, nullptr) > 0)
+                ++scalarCount;
+            REQUIRE(batch[i].z() == Approx(one[0].z()).margin(1e-3));
+        }
+        REQUIRE(count == scalarCount);
+    }
+
+    SECTION("Vec4d input")
+    {
+        std::vector<osg::Vec4d> batch;
+        for (auto& p : points)
+            batch.emplace_back(p.x(), p.y(), 0.0, 90.0);
+        batch[7].w() = FLT_MAX; // skipped point
+
+        std::vector<osg::Vec4d> input = batch;
+        int count = pool->sampleMapCoords(batch.begin(), batch.end(), nullptr, nullptr);
+        REQUIRE(count > 0);
+        REQUIRE(batch[7].z() == 0.0);
+
+        for (unsigned i = 0; i < input.size(); ++i)
+        {
+            std::vector<osg::Vec4d> one(1, input[i]);
+            pool->sampleMapCoords(one.begin(), one.end(), nullptr, nullptr);
+            REQUIRE(batch[i].z() == Approx(one[0].z()).margin(1e-3));
+        }
+    }
+
+    SECTION("Longitudes wrap around")
+    {
+        std::vector<osg::Vec3d> batch = points;
+        pool->sampleMapCoords(batch.begin(), batch.end(), resolution, nullptr, nullptr);
+
+        std::vector<osg::Vec3d> wrapped = points;
+        for (auto& p : wrapped)
+            p.x() += 360.0;
+        int count = pool->sampleMapCoords(wrapped.begin(), wrapped.end(), resolution, nullptr, nullptr);
+        REQUIRE(count > 0);
+
+        for (unsigned i = 0; i < points.size(); ++i)
+            REQUIRE(wrapped[i].z() == Approx(batch[i].z()).margin(1e-3));
+    }
+}
+
+TEST_CASE("ElevationPool sampling benchmark", "[.benchmark]")
+{
+    osg::ref_ptr<Map> map = ElevationPoolTests::createMap();
+    ElevationPool* pool = map->getElevationPool();
+    Distance resolution(90.0, Units::METERS);
+
+    const unsigned count = 1000000;
+
+    struct Set { const char* name; double spread; };
+    Set sets[2] = { { "clustered", 0.01 }, { "scattered", 0.5 } };
+
+    for (auto& set : sets)
+    {
+        std::vector<osg::Vec3d> points = ElevationPoolTests::createPoints(count, -121.5, 46.5, set.spread, 2);
+
+        // warm up the tile caches so both runs measure sampling only
+        pool->sampleMapCoords(points.begin(), points.end(), resolution, nullptr, nullptr);
+
+        auto t0 = std::chrono::steady_clock::now();
+        pool->sampleMapCoords(points.begin(), points.end(), resolution, nullptr, nullptr);
+        auto t1 = std::chrono::steady_clock::now();
+
+        // chunks below the batch threshold take the scalar path
+        const unsigned chunk = 16;
+        for (unsigned i = 0; i < count; i += chunk)
+            pool->sampleMapCoords(points.begin() + i, points.begin() + std::min(i + chunk, count), resolution, nullptr, nullptr);
+        auto t2 = std::chrono::steady_clock::now();
+
+        double batchSeconds = std::chrono::duration<double>(t1 - t0).count();
+        double scalarSeconds = std::chrono::duration<double>(t2 - t1).count();
+
+        OE_NOTICE << set.name
+            << ": batch points/sec=" << (unsigned)(count / batchSeconds)
+            << ", scalar points/sec=" << (unsigned)(count / scalarSeconds)
+            << std::endl;
+    }
+}
+
+namespace ElevationPoolTests
+{
+    // Counts progress reports, and asks to cancel after the first one if requested.
+    struct TestProgress : public ProgressCallback
+    {
+        TestProgress(bool cancelEarly) : _cancelEarly(cancelEarly) { }
+
+        bool reportProgress(double current, double total, unsigned, unsigned, const std::string&) override
+        {
+            ++_reports;
+            _last = std::max(_last, current / total);
+            return _cancelEarly;
+        }
+
+        bool _cancelEarly;
+        std::atomic_int _reports{ 0 };
+        double _last = 0.0;
+    };
+}
+
+TEST_CASE("ElevationPool parallel sampling")
+{
+    osg::ref_ptr<Map> map = ElevationPoolTests::createMap();
+    REQUIRE(map->getLayerAt(0)->getStatus().isOK());
+
+    ElevationPool* pool = map->getElevationPool();
+    Distance resolution(90.0, Units::METERS);
+
+    jobs::get_pool("oe.elevationpool")->set_concurrency(4);
+
+    std::vector<osg::Vec3d> points = ElevationPoolTests::createPoints(100000, -121.5, 46.5, 0.6, 3);
+
+    SECTION("Results match the serial path in input order")
+    {
+        std::vector<osg::Vec3d> serial = points;
+        int serialCount = pool->sampleMapCoords(serial.begin(), serial.end(), resolution, nullptr, nullptr);
+
+        std::vector<osg::Vec3d> parallel = points;
+        osg::ref_ptr<ElevationPoolTests::TestProgress> progress = new ElevationPoolTests::TestProgress(false);
+        int parallelCount = pool->sampleMapCoordsParallel(parallel.begin(), parallel.end(), resolution, nullptr, progress.get());
+
+        REQUIRE(parallelCount == serialCount);
+        REQUIRE(progress->_reports > 0);
+        REQUIRE(progress->_last == 1.0);
+
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            REQUIRE(parallel[i].x() == points[i].x());
+            REQUIRE(parallel[i].y() == points[i].y());
+            REQUIRE(parallel[i].z() == serial[i].z());
+        }
+    }
+
+    SECTION("Cancelation")
+    {
+        osg::ref_ptr<ElevationPoolTests::TestProgress> progress = new ElevationPoolTests::TestProgress(true);
+        int count = pool->sampleMapCoordsParallel(points.begin(), points.end(), resolution, nullptr, progress.get());
+        REQUIRE(count == -1);
+        REQUIRE(progress->isCanceled());
+    }
+}
+
+TEST_CASE("ElevationPool parallel sampling benchmark", "[.benchmark]")
+{
+    osg::ref_ptr<Map> map = ElevationPoolTests::createMap();
+    ElevationPool* pool = map->getElevationPool();
+    Distance resolution(90.0, Units::METERS);
+
+    std::vector<osg::Vec3d> points = ElevationPoolTests::createPoints(4000000, -121.5, 46.5, 0.5, 4);
+
+    // warm up the tile caches so every run measures sampling only
+    pool->sampleMapCoords(points.begin(), points.end(), resolution, nullptr, nullptr);
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned threads = 1; threads <= cores; threads *= 2)
+    {
+        jobs::get_pool("oe.elevationpool")->set_concurrency(threads);
+
+        auto t0 = std::chrono::steady_clock::now();
+        pool->sampleMapCoordsParallel(points.begin(), points.end(), resolution, nullptr, nullptr);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        OE_NOTICE << "threads=" << threads
+            << ", points/sec=" << (unsigned)(points.size() / seconds)
+            << std::endl;
+    }
+}
+
+TEST_CASE("CompositeElevationLayer fetches in parallel")
+{
+    auto createComposite = [](bool parallel)
+    {
+        CompositeElevationLayer* composite = new CompositeElevationLayer();
+        composite->options().parallelFetch() = parallel;
+
+        GDALElevationLayer* base = new GDALElevationLayer();
+        base->setURL("../data/terrain/mt_rainier_90m.tif");
+        composite->addLayer(base);
+
+        // an offset layer on top of the base layer
+        GDALElevationLayer* offset = new GDALElevationLayer();
+        offset->setURL("../data/terrain/mt_rainier_90m.tif");
+        offset->setOffset(true);
+        composite->addLayer(offset);
+
+        return composite;
+    };
+
+    osg::ref_ptr<CompositeElevationLayer> serial = createComposite(false);
+    osg::ref_ptr<CompositeElevationLayer> parallel = createComposite(true);
+    REQUIRE(serial->open().isOK());
+    REQUIRE(parallel->open().isOK());
+
+    GeoPoint p(serial->getProfile()->getSRS(), -121.76, 46.85);
+    TileKey key = serial->getProfile()->createTileKey(p.x(), p.y(), 9);
+
+    GeoHeightField a = serial->createHeightField(key, nullptr);
+    GeoHeightField b = parallel->createHeightField(key, nullptr);
+    REQUIRE(a.valid());
+    REQUIRE(b.valid());
+    REQUIRE(a.getHeightField()->getFloatArray()->asVector() == b.getHeightField()->getFloatArray()->asVector());
+}
+
+TEST_CASE("GDALElevationLayer windowed reads match single-pixel reads")
+{
+    // At LOD 9 the source window under a 257-post tile is small enough to
+    // read in one piece; under a 9-post tile it is not, so that tile reads
+    // single pixels. Every 32nd post of the first lands on a post of the second.
+    auto createLayer = [](unsigned tileSize, RasterInterpolation interp)
+    {
+        GDALElevationLayer* layer = new GDALElevationLayer();
+        layer->setURL("../data/terrain/mt_rainier_90m.tif");
+        layer->options().tileSize() = tileSize;
+        layer->options().interpolation() = interp;
+        REQUIRE(layer->open().isOK());
+        return layer;
+    };
+
+    for (auto interp : { INTERP_AVERAGE, INTERP_BILINEAR })
+    {
+        osg::ref_ptr<ElevationLayer> windowed = createLayer(257, interp);
+        osg::ref_ptr<ElevationLayer> single = createLayer(9, interp);
+
+        // one tile inside the DEM and one over its edge
+        for (double x : { -121.76, -122.1 })
+        {
+            TileKey key = windowed->getProfile()->createTileKey(x, 46.85, 9);
+
+            GeoHeightField a = windowed->createHeightField(key, nullptr);
+            GeoHeightField b = single->createHeightField(key, nullptr);
+            REQUIRE(a.valid());
+            REQUIRE(b.valid());
+
+            for (unsigned r = 0; r < 9; ++r)
+                for (unsigned c = 0; c < 9; ++c)
+                    REQUIRE(a.getHeightField()->getHeight(c * 32, r * 32) == b.getHeightField()->getHeight(c, r));
+        }
+    }
+}
+
+TEST_CASE("ElevationLayerVector compositing")
+{
+    auto createLayer = [](bool offset)
+    {
+        GDALElevationLayer* layer = new GDALElevationLayer();
+        layer->setURL("../data/terrain/mt_rainier_90m.tif");
+        layer->setOffset(offset);
+        REQUIRE(layer->open().isOK());
+        return layer;
+    };
+
+    osg::ref_ptr<ElevationLayer> base = createLayer(false);
+    osg::ref_ptr<ElevationLayer> copy = createLayer(false);
+    osg::ref_ptr<ElevationLayer> offset = createLayer(true);
+
+    // a tile inside the DEM, at a size that forces resampling
+    TileKey key = base->getProfile()->createTileKey(-121.76, 46.6, 9);
+    const unsigned size = 100;
+
+    auto populate = [&](const ElevationLayerVector& layers, std::vector<float>& resolutions)
+    {
+        osg::ref_ptr<osg::HeightField> hf = HeightFieldUtils::createReferenceHeightField(
+            key.getExtent(), size, size, 0u, false, NO_DATA_VALUE);
+        resolutions.assign(size * size, FLT_MAX);
+        REQUIRE(layers.populateHeightField(hf.get(), &resolutions, key, nullptr, INTERP_BILINEAR, nullptr));
+        return hf;
+    };
+
+    ElevationLayerVector single;
+    single.push_back(base);
+    std::vector<float> singleRes;
+    osg::ref_ptr<osg::HeightField> expected = populate(single, singleRes);
+
+    SECTION("Higher-priority layer wins")
+    {
+        ElevationLayerVector stacked;
+        stacked.push_back(base);
+        stacked.push_back(copy);
+        std::vector<float> res;
+        osg::ref_ptr<osg::HeightField> hf = populate(stacked, res);
+        REQUIRE(hf->getFloatArray()->asVector() == expected->getFloatArray()->asVector());
+        REQUIRE(res == singleRes);
+    }
+
+    SECTION("Offset layers add to the resolved height")
+    {
+        ElevationLayerVector stacked;
+        stacked.push_back(base);
+        stacked.push_back(offset);
+        std::vector<float> res;
+        osg::ref_ptr<osg::HeightField> hf = populate(stacked, res);
+        for (unsigned i = 0; i < size * size; ++i)
+        {
+            float h = expected->getFloatArray()->at(i);
+            REQUIRE(hf->getFloatArray()->at(i) == (osg::equivalent(h, 0.0f) ? h : h + h));
+        }
+    }
+}
+
+namespace ElevationPoolTests
+{
+    // The western half of the Mt. Rainier DEM, [-122..-121.5, 46..47].
+    const char* westRainierVRT =
+        "<VRTDataset rasterXSize=\"600\" rasterYSize=\"1201\">"
+        "<SRS>EPSG:4326</SRS>"
+        "<GeoTransform>-122.00041666666667, 0.00083333333333333339, 0, 47.000416666666666, 0, -0.00083333333333333339</GeoTransform>"
+        "<VRTRasterBand dataType=\"Int16\" band=\"1\">"
+        "<NoDataValue>-32768</NoDataValue>"
+        "<SimpleSource>"
+        "<SourceFilename relativeToVRT=\"0\">../data/terrain/mt_rainier_90m.tif</SourceFilename>"
+        "<SourceBand>1</SourceBand>"
+        "<SrcRect xOff=\"0\" yOff=\"0\" xSize=\"600\" ySize=\"1201\"/>"
+        "<DstRect xOff=\"0\" yOff=\"0\" xSize=\"600\" ySize=\"1201\"/>"
+        "</SimpleSource>"
+        "</VRTRasterBand>"
+        "</VRTDataset>";
+}
+
+TEST_CASE("ElevationLayerVector compositing matches per-point compositing")
+{
+    // Lowest priority first:
+    // - the whole DEM in EGM96, capped at LOD 6 so it falls back to a
+    //   coarse tile that is much larger than the requested one;
+    // - the western half of the DEM in small tiles;
+    // - the same western half as an offset layer.
+    osg::ref_ptr<GDALElevationLayer> coarse = new GDALElevationLayer();
+    coarse->setURL("../data/terrain/mt_rainier_90m.tif");
+    coarse->setVerticalDatum("egm96");
+    coarse->setMaxDataLevel(6);
+
+    osg::ref_ptr<GDALElevationLayer> west = new GDALElevationLayer();
+    west->options().connection() = ElevationPoolTests::westRainierVRT;
+    west->options().tileSize() = 65;
+
+    osg::ref_ptr<GDALElevationLayer> offset = new GDALElevationLayer();
+    offset->options().connection() = ElevationPoolTests::westRainierVRT;
+    offset->setOffset(true);
+
+    ElevationLayerVector layers;
+    for (auto layer : { coarse.get(), west.get(), offset.get() })
+    {
+        REQUIRE(layer->open().isOK());
+        layers.push_back(layer);
+    }
+
+    // a tile that straddles the edge of the western half
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    TileKey key = profile->createTileKey(-121.5, 46.6, 9);
+    const unsigned size = 100;
+
+    osg::ref_ptr<osg::HeightField> hf = HeightFieldUtils::createReferenceHeightField(
+        key.getExtent(), size, size, 0u, false, NO_DATA_VALUE);
+    REQUIRE(layers.populateHeightField(hf.get(), nullptr, key, nullptr, INTERP_BILINEAR, nullptr));
+
+    // The heightfield each layer would contribute, falling back to
+    // parent keys the same way populateHeightField does.
+    std::vector<GeoHeightField> fields;
+    for (auto& layer : layers)
+    {
+        TileKey layerKey = layer->getBestAvailableTileKey(key.mapResolution(size, layer->getTileSize()));
+        GeoHeightField field = layer->createHeightField(layerKey, nullptr);
+        while (!field.valid() && !layer->isOffset() && layerKey.makeParent() && layer->isKeyInLegalRange(layerKey))
+        {
+            field = layer->createHeightField(layerKey, nullptr);
+        }
+        REQUIRE(field.valid());
+        fields.push_back(field);
+    }
+
+    const SpatialReference* srs = key.getProfile()->getSRS();
+    const double dx = key.getExtent().width() / (double)(size - 1);
+    const double dy = key.getExtent().height() / (double)(size - 1);
+    unsigned resolvedBy[2] = { 0u, 0u };
+
+    for (unsigned r = 0; r < size; ++r)
+    {
+        for (unsigned c = 0; c < size; ++c)
+        {
+            double x = key.getExtent().xMin() + dx * (double)c;
+            double y = key.getExtent().yMin() + dy * (double)r;
+
+            // highest-priority layer with data wins...
+            int resolved = -1;
+            float expected = NO_DATA_VALUE;
+            for (int i = (int)layers.size() - 1; i >= 0 && resolved < 0; --i)
+            {
+                float h;
+                if (!layers[i]->isOffset() &&
+                    fields[i].getElevation(srs, x, y, INTERP_BILINEAR, srs, h) &&
+                    h != NO_DATA_VALUE)
+                {
+                    expected = h;
+                    resolved = i;
+                }
+            }
+
+            // posts no layer covers are filled in afterwards; skip those
+            if (resolved < 0)
+                continue;
+
+            // ...then the offset layers above it add to it.
+            for (int i = (int)layers.size() - 1; i > resolved; --i)
+            {
+                float h;
+                if (layers[i]->isOffset() &&
+                    fields[i].getElevation(srs, x, y, INTERP_BILINEAR, srs, h) &&
+                    h != NO_DATA_VALUE && !osg::equivalent(h, 0.0f))
+                {
+                    expected += h;
+                }
+            }
+
+            ++resolvedBy[resolved];
+            REQUIRE(hf->getHeight(c, r) == Approx(expected).margin(1e-3));
+        }
+    }
+
+    // both contenders must have taken part
+    REQUIRE(resolvedBy[0] > 0u);
+    REQUIRE(resolvedBy[1] > 0u);
+}
@@ -0,0 +1,154 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/FeatureRasterizer>
+#include <osgEarth/Geometry>
+#include <osgEarth/LineSymbol>
+#include <osgEarth/PolygonSymbol>
+#include <osgEarth/Notify>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace FeatureRasterizerTests
+{
+    double random(double a, double b)
+    {
+        return a + (b - a) * (double)std::rand() / (double)RAND_MAX;
+    }
+
+    // Synthetic OSM-like data over the extent: a few large landuse polygons,
+    // many small buildings, and random-walk roads.
+    void createOSMLike(const GeoExtent& extent, unsigned numBuildings, unsigned seed,
+        FeatureList& landuse, FeatureList& buildings, FeatureList& roads)
+    {
+        std::srand(seed);
+        const SpatialReference* srs = extent.getSRS();
+        const double size = extent.width();
+
+        for (unsigned i = 0; i < 20; ++i)
+        {
+            osg::ref_ptr<Polygon> poly = new Polygon();
+            double cx = random(extent.xMin(), extent.xMax()), cy = random(extent.yMin(), extent.yMax());
+            double radius = random(0.05, 0.2) * size;
+            for (int v = 0; v < 24; ++v)
+            {
+                double a = osg::PI * 2.0 * (double)v / 24.0;
+                double r = radius * random(0.7, 1.0);
+                poly->push_back(osg::Vec3d(cx + r * cos(a), cy + r * sin(a), 0.0));
+            }
+            landuse.push_back(new Feature(poly.get(), srs));
+        }
+
+        for (unsigned i = 0; i < numBuildings; ++i)
+        {
+            osg::ref_ptr<Polygon> poly = new Polygon();
+            double x = random(extent.xMin(), extent.xMax()), y = random(extent.yMin(), extent.yMax());
+            double w = random(0.001, 0.004) * size, h = random(0.001, 0.004) * size;
+            poly->push_back(osg::Vec3d(x, y, 0.0));
+            poly->push_back(osg::Vec3d(x + w, y, 0.0));
+            poly->push_back(osg::Vec3d(x + w, y + h, 0.0));
+            poly->push_back(osg::Vec3d(x, y + h, 0.0));
+            buildings.push_back(new Feature(poly.get(), srs));
+        }
+
+        for (unsigned i = 0; i < numBuildings / 20; ++i)
+        {
+            osg::ref_ptr<LineString> line = new LineString();
+            double x = random(extent.xMin(), extent.xMax()), y = random(extent.yMin(), extent.yMax());
+            double heading = random(0.0, osg::PI * 2.0);
+            for (int v = 0; v < 20; ++v)
+            {
+                line->push_back(osg::Vec3d(x, y, 0.0));
+                heading += random(-0.4, 0.4);
+                x += cos(heading) * 0.01 * size;
+                y += sin(heading) * 0.01 * size;
+            }
+            roads.push_back(new Feature(line.get(), srs));
+        }
+    }
+
+    GeoImage render(const GeoExtent& extent, unsigned size, unsigned numBuildings, unsigned threads)
+    {
+        FeatureList landuse, buildings, roads;
+        createOSMLike(extent, numBuildings, 42, landuse, buildings, roads);
+
+        Style landuseStyle, buildingStyle, roadStyle;
+        landuseStyle.getOrCreate<PolygonSymbol>()->fill()->color() = Color(0.6f, 0.8f, 0.5f, 1.0f);
+        buildingStyle.getOrCreate<PolygonSymbol>()->fill()->color() = Color(0.7f, 0.6f, 0.6f, 1.0f);
+        roadStyle.getOrCreate<LineSymbol>()->stroke()->color() = Color::White;
+        roadStyle.getOrCreate<LineSymbol>()->stroke()->width() = 3.0f;
+        roadStyle.getOrCreate<LineSymbol>()->stroke()->widthUnits() = Units::PIXELS;
+
+        FeatureRasterizer rasterizer(size, size, extent, Color::Transparent);
+        rasterizer.setNumThreads(threads);
+        rasterizer.render(landuse, landuseStyle);
+        rasterizer.render(buildings, buildingStyle);
+        rasterizer.render(roads, roadStyle);
+        return rasterizer.finalize();
+    }
+}
+
+TEST_CASE("FeatureRasterizer renders the same with multiple threads")
+{
+    using namespace FeatureRasterizerTests;
+
+    GeoExtent extent(SpatialReference::get("wgs84"), 10.0, 45.0, 10.05, 45.05);
+
+    GeoImage single = render(extent, 512, 2000, 1);
+    GeoImage multi = render(extent, 512, 2000, 4);
+    REQUIRE(single.valid());
+    REQUIRE(multi.valid());
+
+    const osg::Image* a = single.getImage();
+    const osg::Image* b = multi.getImage();
+    REQUIRE(a->getTotalSizeInBytes() == b->getTotalSizeInBytes());
+    REQUIRE(std::memcmp(a->data(), b->data(), a->getTotalSizeInBytes()) == 0);
+}
+
+TEST_CASE("FeatureRasterizer benchmark", "[.benchmark]")
+{
+    using namespace FeatureRasterizerTests;
+
+    GeoExtent extent(SpatialReference::get("wgs84"), 10.0, 45.0, 10.05, 45.05);
+    const unsigned size = 1024;
+    const unsigned numBuildings = 50000;
+    const int runs = 3;
+
+    for (unsigned threads : { 1u, 2u, 4u, 8u })
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i)
+            render(extent, size, numBuildings, threads);
+        auto t1 = std::chrono::steady_clock::now();
+
+        OE_NOTICE << "FeatureRasterizer " << size << "px, " << numBuildings << " buildings, threads=" << threads
+            << ": ms/tile=" << std::chrono::duration<double, std::milli>(t1 - t0).count() / runs
+            << std::endl;
+    }
+}
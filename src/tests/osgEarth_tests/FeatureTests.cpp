@@ -23,9 +23,15 @@
 #include <osgEarth/catch.hpp>
 
 #include <osgEarth/Feature>
+#include <osgEarth/FeatureBatch>
+#include <osgEarth/CompiledExpression>
+#include <osgEarth/Filter>
 #include <osgEarth/GeometryUtils>
+#include <osgEarth/OGRFeatureSource>
+#include <thread>
 
 using namespace osgEarth;
+using namespace osgEarth::Util;
 
 TEST_CASE("Feature::splitAcrossDateLine doesn't modify features that don't cross the dateline") {
     osg::ref_ptr< Feature > feature = new Feature(GeometryUtils::geometryFromWKT("POLYGON((-81 26, -40.5 45, -40.5 75.5, -81 60))"), osgEarth::SpatialReference::create("wgs84"));
@@ -109,3 +115,278 @@ TEST_CASE("Feature handles attributes correctly.") {
         REQUIRE(feature->getBool("bool") == false);
     }
 }
+
+TEST_CASE("FeatureBatch stores features by column") {
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+
+    FeatureList features;
+    for (int i = 0; i < 200; ++i)
+    {
+        osg::ref_ptr<Feature> f = new Feature(new Point(), wgs84, Style(), (FeatureID)(1000 + i));
+        f->getGeometry()->push_back(osg::Vec3d(i, i, 0));
+        f->set("name", std::string(i % 2 ? "odd" : "even"));
+        f->set("height", (double)i * 0.5);
+        f->set("floors", i);
+        f->set("flag", i % 3 == 0);
+        if (i % 10 == 0)
+            f->setNull("name");
+        if (i == 150)
+            f->set("extra", std::string("late"));
+        features.push_back(f);
+    }
+
+    osg::ref_ptr<FeatureBatch> batch = new FeatureBatch(features);
+    REQUIRE(batch->size() == features.size());
+    REQUIRE(batch->getNumColumns() == 5);
+
+    SECTION("Schema") {
+        REQUIRE(batch->getColumnType(batch->getColumnIndex("NAME")) == ATTRTYPE_STRING);
+        REQUIRE(batch->getColumnType(batch->getColumnIndex("height")) == ATTRTYPE_DOUBLE);
+        REQUIRE(batch->getColumnType(batch->getColumnIndex("floors")) == ATTRTYPE_INT);
+        REQUIRE(batch->getColumnType(batch->getColumnIndex("flag")) == ATTRTYPE_BOOL);
+        REQUIRE(batch->getColumnIndex("missing") == -1);
+    }
+
+    SECTION("Round trip") {
+        FeatureList output;
+        batch->toFeatureList(output);
+        REQUIRE(output.size() == features.size());
+        for (unsigned i = 0; i < output.size(); ++i)
+        {
+            const Feature* a = features[i].get();
+            const Feature* b = output[i].get();
+            REQUIRE(a->getFID() == b->getFID());
+            REQUIRE(a->getAttrs().size() == b->getAttrs().size());
+            REQUIRE(a->isSet("name") == b->isSet("name"));
+            REQUIRE(a->getString("name") == b->getString("name"));
+            REQUIRE(a->getDouble("height") == b->getDouble("height"));
+            REQUIRE(a->getInt("floors") == b->getInt("floors"));
+            REQUIRE(a->getBool("flag") == b->getBool("flag"));
+            REQUIRE(a->hasAttr("extra") == b->hasAttr("extra"));
+            REQUIRE(b->getGeometry() != a->getGeometry());
+            REQUIRE(b->getGeometry()->front() == a->getGeometry()->front());
+        }
+    }
+
+    SECTION("Cursor and eval") {
+        osg::ref_ptr<FeatureCursor> cursor = batch->createCursor();
+        NumericExpression expr("[height] * [floors]");
+        unsigned row = 0;
+        while (cursor->hasMore())
+        {
+            Feature* f = cursor->nextFeature();
+            REQUIRE(f->eval(expr, (Session*)nullptr) == batch->eval(expr, row));
+            ++row;
+        }
+        REQUIRE(row == batch->size());
+    }
+
+    SECTION("Mixed types") {
+        osg::ref_ptr<Feature> f = new Feature(new Point(), wgs84);
+        f->set("floors", 2.5);
+        f->set("flag", std::string("maybe"));
+        REQUIRE(batch->add(f.get()));
+        REQUIRE(batch->getColumnType(batch->getColumnIndex("floors")) == ATTRTYPE_DOUBLE);
+        REQUIRE(batch->getColumnType(batch->getColumnIndex("flag")) == ATTRTYPE_STRING);
+        REQUIRE(batch->getDouble(batch->size() - 1, batch->getColumnIndex("floors")) == 2.5);
+        REQUIRE(batch->getInt(7, batch->getColumnIndex("floors")) == 7);
+        REQUIRE(batch->getString(batch->size() - 1, batch->getColumnIndex("flag")) == "maybe");
+    }
+
+    SECTION("Uses less memory than features") {
+        std::size_t featureBytes = 0;
+        for (auto& f : features)
+            featureBytes += f->getAttrs().size() * sizeof(AttributeTable::container_t::value_type);
+        REQUIRE(batch->getMemoryUsage() < featureBytes);
+    }
+}
+
+TEST_CASE("Compiled expressions match Feature::eval") {
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+
+    FeatureList features;
+    for (int i = 0; i < 50; ++i)
+    {
+        osg::ref_ptr<Feature> f = new Feature(new Point(), wgs84);
+        f->set("name", std::string(i % 2 ? "odd" : "even"));
+        f->set("height", (double)i * 0.5);
+        f->set("floors", i);
+        features.push_back(f);
+    }
+    osg::ref_ptr<FeatureBatch> batch = new FeatureBatch(features);
+
+    SECTION("NumericExpression") {
+        NumericExpression expr("max([height] * 2, [floors] + 3) - [height] % 4 / 2");
+        CompiledNumericExpression compiled(expr, batch->getSchema());
+
+        std::vector<double> fromList, fromBatch;
+        compiled.eval(features, fromList);
+        compiled.eval(*batch, fromBatch);
+        REQUIRE(fromList.size() == features.size());
+        REQUIRE(fromBatch.size() == features.size());
+
+        for (unsigned i = 0; i < features.size(); ++i)
+        {
+            double expected = features[i]->eval(expr, (Session*)nullptr);
+            REQUIRE(fromList[i] == expected);
+            REQUIRE(fromBatch[i] == expected);
+            REQUIRE(compiled.eval(features[i].get()) == expected);
+        }
+    }
+
+    SECTION("NumericExpression precedence and constants") {
+        REQUIRE(NumericExpression("1 + 2 * 3").eval() == 7.0);
+        REQUIRE(NumericExpression("(1 + 2) * 3").eval() == 9.0);
+        REQUIRE(NumericExpression("min(4, 2) + max(1, 5)").eval() == 7.0);
+
+        NumericExpression expr("2 * (3 + 4)");
+        osg::ref_ptr<Feature> f = new Feature(new Point(), wgs84);
+        REQUIRE(CompiledNumericExpression(expr).eval(f.get()) == 14.0);
+    }
+
+    SECTION("NumericExpression NaN evaluates as 0") {
+        NumericExpression expr("[height] / [floors]");
+        CompiledNumericExpression compiled(expr, batch->getSchema());
+
+        std::vector<double> fromList, fromBatch;
+        compiled.eval(features, fromList);
+        compiled.eval(*batch, fromBatch);
+
+        // the first feature is 0/0
+        REQUIRE(features[0]->eval(expr, (Session*)nullptr) == 0.0);
+        REQUIRE(compiled.eval(features[0].get()) == 0.0);
+        REQUIRE(fromList[0] == 0.0);
+        REQUIRE(fromBatch[0] == 0.0);
+    }
+
+    SECTION("StringExpression") {
+        StringExpression expr("[name]-[floors]:[name]");
+        CompiledStringExpression compiled(expr);
+
+        std::vector<std::string> fromList, fromBatch;
+        compiled.eval(features, fromList);
+        compiled.eval(*batch, fromBatch);
+
+        for (unsigned i = 0; i < features.size(); ++i)
+        {
+            std::string expected = features[i]->eval(expr, (Session*)nullptr);
+            REQUIRE(fromList[i] == expected);
+            REQUIRE(fromBatch[i] == expected);
+        }
+    }
+}
+
+namespace
+{
+    // Doubles every feature's "value"; drops features whose value is odd
+    struct DoubleValueFilter : public FeatureFilter
+    {
+        bool isFeatureIndependent() const override { return true; }
+
+        FilterContext push(FeatureList& input, FilterContext& context) override
+        {
+            FeatureList output;
+            for (auto& f : input)
+            {
+                if (f->getInt("value") % 2 == 0)
+                {
+                    f->set("value", f->getInt("value") * 2);
+                    output.push_back(f);
+                }
+            }
+            output.swap(input);
+            return context;
+        }
+    };
+
+    // Numbers the features in list order
+    struct SequenceFilter : public FeatureFilter
+    {
+        FilterContext push(FeatureList& input, FilterContext& context) override
+        {
+            int n = 0;
+            for (auto& f : input)
+                f->set("seq", n++);
+            return context;
+        }
+    };
+}
+
+TEST_CASE("FeatureFilterChain partitions feature-independent filters") {
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+
+    FeatureList features;
+    for (int i = 0; i < 10000; ++i)
+    {
+        osg::ref_ptr<Feature> f = new Feature(new Point(), wgs84, Style(), (FeatureID)i);
+        f->set("value", i);
+        features.push_back(f);
+    }
+
+    FeatureFilterChain chain;
+    chain.push_back(new DoubleValueFilter());
+    chain.push_back(new DoubleValueFilter());
+    chain.push_back(new SequenceFilter());
+    chain.setParallelPartitionSize(100u);
+
+    FilterContext context;
+    chain.push(features, context);
+
+    REQUIRE(features.size() == 5000u);
+    for (unsigned i = 0; i < features.size(); ++i)
+    {
+        REQUIRE(features[i]->getFID() == (FeatureID)(i * 2));
+        REQUIRE(features[i]->getInt("value") == (long long)(i * 8));
+        REQUIRE(features[i]->getInt("seq") == (long long)i);
+    }
+}
+
+TEST_CASE("OGRFeatureSource cursors share pooled handles") {
+    osg::ref_ptr<OGRFeatureSource> source = new OGRFeatureSource();
+    source->setURL("../data/world.shp");
+    REQUIRE(source->open().isOK());
+
+    // 10 degree bands of latitude
+    auto count = [&](int band) {
+        Query query;
+        query.bounds() = Bounds(-180.0, -90.0 + band * 10.0, 0.0, 180.0, -80.0 + band * 10.0, 0.0);
+        unsigned n = 0;
+        osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(query);
+        while (cursor.valid() && cursor->hasMore())
+        {
+            cursor->nextFeature();
+            ++n;
+        }
+        return n;
+    };
+
+    std::vector<unsigned> expected(18);
+    for (int band = 0; band < 18; ++band)
+        expected[band] = count(band);
+
+    // nested cursors each need their own handle
+    {
+        osg::ref_ptr<FeatureCursor> outer = source->createFeatureCursor();
+        REQUIRE(outer.valid());
+        REQUIRE(count(9) == expected[9]);
+        REQUIRE(outer->hasMore());
+    }
+
+    // reused handles from several threads give the same results
+    std::vector<unsigned> results(4 * 18 * 5);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (unsigned i = 0; i < 18 * 5; ++i)
+                results[t * 18 * 5 + i] = count(i % 18);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (unsigned i = 0; i < results.size(); ++i)
+        REQUIRE(results[i] == expected[(i % (18 * 5)) % 18]);
+
+    source->close();
+}
@@ -0,0 +1,121 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/GeoData>
+#include <osgEarth/HeightFieldUtils>
+#include <osgEarth/ImageUtils>
+
+using namespace osgEarth;
+
+TEST_CASE("GeoImage reprojection")
+{
+    // UTM zone 33N source whose red channel is its column and green
+    // channel its row, normalized. Two layers take the manual path.
+    const SpatialReference* utm = SpatialReference::get("+proj=utm +zone=33 +datum=WGS84 +units=m +no_defs");
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+    REQUIRE(utm != nullptr);
+
+    const int s = 128, t = 96;
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(s, t, 2, GL_RGBA, GL_FLOAT);
+    image->setInternalTextureFormat(GL_RGBA32F_ARB);
+    ImageUtils::PixelWriter write(image.get());
+    for (int r = 0; r < 2; ++r)
+        for (int y = 0; y < t; ++y)
+            for (int x = 0; x < s; ++x)
+                write(osg::Vec4f((float)x / (s - 1), (float)y / (t - 1), 0.0f, 1.0f), x, y, r);
+
+    GeoExtent srcExtent(utm, 300000.0, 4900000.0, 700000.0, 5200000.0);
+    GeoImage geoImage(image.get(), srcExtent);
+
+    GeoExtent destExtent = srcExtent.transform(wgs84);
+    const unsigned width = 211, height = 157;
+    GeoImage result = geoImage.reproject(wgs84, &destExtent, width, height, true);
+    REQUIRE(result.valid());
+    REQUIRE(result.getImage()->s() == (int)width);
+    REQUIRE(result.getImage()->t() == (int)height);
+
+    SECTION("interpolated coordinates stay within 1/8 source pixel of exact")
+    {
+        ImageUtils::PixelReader read(result.getImage());
+        const double dx = destExtent.width() / width, dy = destExtent.height() / height;
+        const double xfac = (s - 1) / srcExtent.width(), yfac = (t - 1) / srcExtent.height();
+        unsigned checked = 0;
+
+        for (unsigned r = 0; r < height; ++r)
+        {
+            for (unsigned c = 0; c < width; ++c)
+            {
+                osg::Vec3d p;
+                REQUIRE(wgs84->transform(
+                    osg::Vec3d(destExtent.xMin() + (c + 0.5) * dx, destExtent.yMin() + (r + 0.5) * dy, 0.0), utm, p));
+
+                double px = (p.x() - srcExtent.xMin()) * xfac;
+                double py = (p.y() - srcExtent.yMin()) * yfac;
+
+                // skip the edges, where the interpolated point may fall outside the source
+                if (px < 1.0 || px > s - 2.0 || py < 1.0 || py > t - 2.0)
+                    continue;
+
+                for (int layer = 0; layer < 2; ++layer)
+                {
+                    osg::Vec4f color = read(c, r, layer);
+                    REQUIRE(std::abs(color.r() * (s - 1) - px) <= 0.13);
+                    REQUIRE(std::abs(color.g() * (t - 1) - py) <= 0.13);
+                }
+                ++checked;
+            }
+        }
+
+        REQUIRE(checked > width * height / 2);
+    }
+}
+
+TEST_CASE("GeoHeightField::createSubSample matches direct sampling")
+{
+    osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+    hf->allocate(65, 65);
+    for (unsigned r = 0; r < 65; ++r)
+        for (unsigned c = 0; c < 65; ++c)
+            hf->setHeight(c, r, (float)((c * 37 + r * 101) % 257));
+
+    GeoExtent extent(SpatialReference::get("wgs84"), 0.0, 0.0, 1.0, 1.0);
+    GeoHeightField geoHF(hf.get(), extent);
+
+    GeoExtent subExtent(extent.getSRS(), 0.25, 0.5, 0.5, 0.75);
+    GeoHeightField sub = geoHF.createSubSample(subExtent, 33, 40, INTERP_BILINEAR);
+    REQUIRE(sub.valid());
+
+    const osg::HeightField* out = sub.getHeightField();
+    for (unsigned r = 0; r < 40; ++r)
+    {
+        for (unsigned c = 0; c < 33; ++c)
+        {
+            float expected = HeightFieldUtils::getHeightAtNormalizedLocation(
+                hf.get(), 0.25 + 0.25 * c / 32.0, 0.5 + 0.25 * r / 39.0, INTERP_BILINEAR);
+            REQUIRE(out->getHeight(c, r) == Approx(expected).epsilon(1e-5));
+        }
+    }
+}
@@ -25,6 +25,8 @@
 #include <osgEarth/ImageLayer>
 #include <osgEarth/Registry>
 #include <osgEarth/GDAL>
+#include <osgEarth/Composite>
+#include <cstring>
 
 using namespace osgEarth;
 
@@ -67,4 +69,38 @@ TEST_CASE("Attribution works")
 
     REQUIRE(status.isOK());
     REQUIRE(layer->getAttribution() == attribution);
-}
\ No newline at end of file
+}
+
+TEST_CASE("CompositeImageLayer fetches in parallel")
+{
+    auto createComposite = [](bool parallel)
+    {
+        CompositeImageLayer* composite = new CompositeImageLayer();
+        composite->options().parallelFetch() = parallel;
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            GDALImageLayer* layer = new GDALImageLayer();
+            layer->setURL("../data/world.tif");
+            layer->setOpacity(0.25f * (float)(i + 1));
+            composite->addLayer(layer);
+        }
+        return composite;
+    };
+
+    osg::ref_ptr<CompositeImageLayer> serial = createComposite(false);
+    osg::ref_ptr<CompositeImageLayer> parallel = createComposite(true);
+    REQUIRE(serial->open().isOK());
+    REQUIRE(parallel->open().isOK());
+
+    // mixing order must not depend on which fetch finishes first
+    for (unsigned x = 0; x < 2; ++x)
+    {
+        TileKey key(1, x, 0, serial->getProfile());
+        GeoImage a = serial->createImage(key);
+        GeoImage b = parallel->createImage(key);
+        REQUIRE(a.valid());
+        REQUIRE(b.valid());
+        REQUIRE(a.getImage()->getTotalSizeInBytes() == b.getImage()->getTotalSizeInBytes());
+        REQUIRE(memcmp(a.getImage()->data(), b.getImage()->data(), a.getImage()->getTotalSizeInBytes()) == 0);
+    }
+}
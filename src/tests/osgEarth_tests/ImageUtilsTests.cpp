@@ -0,0 +1,252 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ImageUtils>
+#include <osgEarth/SIMD>
+#include <osgEarth/Notify>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using namespace osgEarth;
+
+namespace ImageUtilsTests
+{
+    osg::Image* createImage(int s, int t, GLenum format, GLenum type)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(s, t, 1, format, type);
+        image->setInternalTextureFormat(format);
+        return image;
+    }
+
+    // Random bytes; RGBA8/BGRA8 images with the same seed hold the same data
+    osg::Image* createBytes(int s, int t, GLenum format, unsigned seed)
+    {
+        osg::Image* image = createImage(s, t, format, GL_UNSIGNED_BYTE);
+        std::srand(seed);
+        for (unsigned i = 0; i < image->getTotalSizeInBytes(); ++i)
+            image->data()[i] = (unsigned char)(std::rand() & 0xff);
+        return image;
+    }
+
+    // The same heights in a GL_RED float image (which has a fast path)
+    // and the red channel of a GL_RGB float image (which does not)
+    void createHeights(int s, int t, unsigned seed, osg::ref_ptr<osg::Image>& red, osg::ref_ptr<osg::Image>& rgb)
+    {
+        red = createImage(s, t, GL_RED, GL_FLOAT);
+        rgb = createImage(s, t, GL_RGB, GL_FLOAT);
+        std::srand(seed);
+        for (int i = 0; i < s * t; ++i)
+        {
+            float h = (float)(std::rand() % 100000) * 0.037f - 500.0f;
+            ((float*)red->data())[i] = h;
+            ((float*)rgb->data())[3 * i] = h;
+            ((float*)rgb->data())[3 * i + 1] = 0.0f;
+            ((float*)rgb->data())[3 * i + 2] = 0.0f;
+        }
+    }
+}
+
+TEST_CASE("ImageUtils fast paths match the generic path")
+{
+    using namespace ImageUtilsTests;
+
+    SECTION("resizeImage, float heights")
+    {
+        osg::ref_ptr<osg::Image> red, rgb;
+        createHeights(257, 131, 7, red, rgb);
+
+        for (bool bilinear : { true, false })
+        {
+            osg::ref_ptr<osg::Image> fast, generic;
+            REQUIRE(ImageUtils::resizeImage(red.get(), 100, 300, fast, 0, bilinear));
+            REQUIRE(ImageUtils::resizeImage(rgb.get(), 100, 300, generic, 0, bilinear));
+
+            for (int i = 0; i < 100 * 300; ++i)
+                REQUIRE(((float*)fast->data())[i] == Approx(((float*)generic->data())[3 * i]).epsilon(1e-6));
+        }
+    }
+
+    SECTION("resizeImage, RGBA8 matches float to within rounding")
+    {
+        osg::ref_ptr<osg::Image> bytes = createBytes(64, 48, GL_RGBA, 11);
+        osg::ref_ptr<osg::Image> floats = ImageUtils::convert(bytes.get(), GL_RGBA, GL_FLOAT);
+        REQUIRE(floats.valid());
+
+        osg::ref_ptr<osg::Image> fast, generic;
+        REQUIRE(ImageUtils::resizeImage(bytes.get(), 150, 37, fast));
+        REQUIRE(ImageUtils::resizeImage(floats.get(), 150, 37, generic));
+
+        for (int i = 0; i < 150 * 37 * 4; ++i)
+            REQUIRE(std::abs((float)fast->data()[i] - ((float*)generic->data())[i] * 255.0f) <= 0.51f);
+    }
+
+    SECTION("mix, float heights")
+    {
+        osg::ref_ptr<osg::Image> red1, rgb1, red2, rgb2;
+        createHeights(33, 17, 1, red1, rgb1);
+        createHeights(33, 17, 2, red2, rgb2);
+
+        REQUIRE(ImageUtils::mix(red1.get(), red2.get(), 0.3f));
+        REQUIRE(ImageUtils::mix(rgb1.get(), rgb2.get(), 0.3f));
+
+        for (int i = 0; i < 33 * 17; ++i)
+            REQUIRE(((float*)red1->data())[i] == Approx(((float*)rgb1->data())[3 * i]).epsilon(1e-6));
+    }
+
+    SECTION("mix, RGBA8 matches float to within rounding")
+    {
+        osg::ref_ptr<osg::Image> dest = createBytes(33, 17, GL_RGBA, 3);
+        osg::ref_ptr<osg::Image> src = createBytes(33, 17, GL_RGBA, 4);
+        osg::ref_ptr<osg::Image> destf = ImageUtils::convert(dest.get(), GL_RGBA, GL_FLOAT);
+        osg::ref_ptr<osg::Image> srcf = ImageUtils::convert(src.get(), GL_RGBA, GL_FLOAT);
+
+        REQUIRE(ImageUtils::mix(dest.get(), src.get(), 0.6f));
+        REQUIRE(ImageUtils::mix(destf.get(), srcf.get(), 0.6f));
+
+        for (int i = 0; i < 33 * 17 * 4; ++i)
+            REQUIRE(std::abs((float)dest->data()[i] - ((float*)destf->data())[i] * 255.0f) <= 0.51f);
+    }
+
+    SECTION("convert round trips")
+    {
+        osg::ref_ptr<osg::Image> rgba = createBytes(31, 9, GL_RGBA, 5);
+
+        osg::ref_ptr<osg::Image> rgb = ImageUtils::convert(rgba.get(), GL_RGB, GL_UNSIGNED_BYTE);
+        osg::ref_ptr<osg::Image> floats = ImageUtils::convert(rgba.get(), GL_RGBA, GL_FLOAT);
+        REQUIRE(floats.valid());
+        osg::ref_ptr<osg::Image> back = ImageUtils::convert(floats.get(), GL_RGBA, GL_UNSIGNED_BYTE);
+        REQUIRE(rgb.valid());
+        REQUIRE(back.valid());
+
+        for (int i = 0; i < 31 * 9; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+                REQUIRE(rgb->data()[3 * i + c] == rgba->data()[4 * i + c]);
+            for (int c = 0; c < 4; ++c)
+                REQUIRE(back->data()[4 * i + c] == rgba->data()[4 * i + c]);
+        }
+    }
+}
+
+TEST_CASE("PixelReader and PixelWriter rows match single pixels")
+{
+    using namespace ImageUtilsTests;
+
+    struct Format { GLenum format, type; };
+    Format formats[] = {
+        { GL_RGBA, GL_UNSIGNED_BYTE },
+        { GL_BGR, GL_UNSIGNED_BYTE },
+        { GL_LUMINANCE_ALPHA, GL_UNSIGNED_SHORT },
+        { GL_RED, GL_FLOAT } };
+
+    for (auto& f : formats)
+    {
+        osg::ref_ptr<osg::Image> image = createImage(37, 5, f.format, f.type);
+        std::srand(f.format);
+        for (unsigned i = 0; i < image->getTotalSizeInBytes(); ++i)
+            image->data()[i] = (unsigned char)(std::rand() & 0xff);
+
+        ImageUtils::PixelReader read(image.get());
+        std::vector<osg::Vec4f> row(30);
+        std::vector<float> reds(30);
+
+        // compare bits, since random float data may hold NaNs
+        read.readRow(row.data(), 5, 3, 30);
+        read.readRow(reds.data(), 5, 3, 30);
+        for (int s = 0; s < 30; ++s)
+        {
+            osg::Vec4f pixel = read(s + 5, 3);
+            REQUIRE(std::memcmp(&row[s], &pixel, sizeof(pixel)) == 0);
+            REQUIRE(std::memcmp(&reds[s], &pixel[0], sizeof(float)) == 0);
+        }
+
+        // writing a row matches writing its pixels one at a time
+        osg::ref_ptr<osg::Image> byRow = createImage(37, 5, f.format, f.type);
+        osg::ref_ptr<osg::Image> byPixel = createImage(37, 5, f.format, f.type);
+        std::memset(byRow->data(), 0, byRow->getTotalSizeInBytes());
+        std::memset(byPixel->data(), 0, byPixel->getTotalSizeInBytes());
+
+        ImageUtils::PixelWriter writeRow(byRow.get()), writePixel(byPixel.get());
+        writeRow.writeRow(row.data(), 7, 1, 30);
+        for (int s = 0; s < 30; ++s)
+            writePixel(row[s], s + 7, 1);
+
+        REQUIRE(std::memcmp(byRow->data(), byPixel->data(), byRow->getTotalSizeInBytes()) == 0);
+    }
+}
+
+TEST_CASE("SIMD storeBytes rounds halves up like the scalar code")
+{
+    using namespace osgEarth::Util::SIMD;
+
+    const float in[8] = { 0.5f, 1.5f, 2.5f, 254.5f, -0.5f, 127.5f, 128.5f, 255.5f };
+    const unsigned char expected[8] = { 1, 2, 3, 255, 0, 128, 129, 255 };
+
+    unsigned char out[8];
+    float4::load(in).storeBytes(out);
+    float4::load(in + 4).storeBytes(out + 4);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        REQUIRE(out[i] == expected[i]);
+
+        // the scalar tails of the SIMD loops
+        if (in[i] >= 0.0f && in[i] < 255.0f)
+            REQUIRE(out[i] == (unsigned char)(in[i] + 0.5f));
+    }
+}
+
+TEST_CASE("ImageUtils fast path benchmark", "[.benchmark]")
+{
+    using namespace ImageUtilsTests;
+
+    // BGRA8 has the same layout as RGBA8 but takes the generic path
+    const int size = 2048;
+    const int runs = 5;
+    const double megapixels = (double)size * size * runs / 1e6;
+
+    for (GLenum format : { GL_RGBA, GL_BGRA })
+    {
+        osg::ref_ptr<osg::Image> dest = createBytes(size, size, format, 1);
+        osg::ref_ptr<osg::Image> src = createBytes(size, size, format, 2);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i)
+            ImageUtils::mix(dest.get(), src.get(), 0.5f);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i)
+        {
+            osg::ref_ptr<osg::Image> output;
+            ImageUtils::resizeImage(src.get(), size - 1, size - 1, output);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        OE_NOTICE << (format == GL_RGBA ? "RGBA8 (fast)" : "BGRA8 (generic)")
+            << ": mix MP/sec=" << (unsigned)(megapixels / std::chrono::duration<double>(t1 - t0).count())
+            << ", resize MP/sec=" << (unsigned)(megapixels / std::chrono::duration<double>(t2 - t1).count())
+            << std::endl;
+    }
+}
@@ -0,0 +1,186 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/MBTiles>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/Notify>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace osgEarth;
+
+namespace MBTilesTests
+{
+    const std::string filename("osgearth_tests_mbtiles_read.mbtiles");
+
+    // Deletes the database when a test ends. Declare it before the
+    // driver so the file is closed first.
+    struct RemoveDatabase
+    {
+        ~RemoveDatabase() { ::remove(filename.c_str()); }
+    };
+
+    // Writes a level of noisy RGBA tiles to a new MBTiles database and
+    // returns the keys that were written.
+    std::vector<TileKey> createDatabase(unsigned lod, unsigned writeBatchSize = 0u)
+    {
+        ::remove(filename.c_str());
+
+        osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+
+        MBTiles::Options options;
+        options.url() = URI(filename);
+        options.format() = "png";
+        options.writeBatchSize() = writeBatchSize;
+
+        MBTiles::Driver driver;
+        DataExtentList dataExtents;
+        Status status = driver.open("test", options, true, options.format(), profile, dataExtents, nullptr);
+        REQUIRE(status.isOK());
+
+        osg::ref_ptr<osg::Image> image = ImageUtils::createEmptyImage(256, 256);
+        unsigned char* ptr = image->data();
+        unsigned seed = 1u;
+        for (unsigned i = 0; i < image->getTotalSizeInBytes(); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            ptr[i] = (unsigned char)(seed >> 16);
+        }
+
+        std::vector<TileKey> keys;
+        unsigned tilesWide, tilesHigh;
+        profile->getNumTiles(lod, tilesWide, tilesHigh);
+        for (unsigned x = 0; x < tilesWide; ++x)
+        {
+            for (unsigned y = 0; y < tilesHigh; ++y)
+            {
+                TileKey key(lod, x, y, profile.get());
+                REQUIRE(driver.write(key, image.get(), nullptr).isOK());
+                keys.push_back(key);
+            }
+        }
+
+        REQUIRE(driver.close().isOK());
+        return keys;
+    }
+
+    // Reads "count" tiles from the driver using "numThreads" threads and
+    // returns the number of successful reads.
+    unsigned readConcurrently(const MBTiles::Driver& driver, const std::vector<TileKey>& keys, unsigned numThreads, unsigned count)
+    {
+        std::atomic_uint next(0u);
+        std::atomic_uint succeeded(0u);
+
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                for (unsigned i = next++; i < count; i = next++)
+                {
+                    ReadResult r = driver.read(keys[i % keys.size()], nullptr, nullptr);
+                    if (r.succeeded() && r.getImage())
+                        ++succeeded;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        return succeeded;
+    }
+}
+
+TEST_CASE("MBTiles concurrent reads")
+{
+    MBTilesTests::RemoveDatabase cleanup;
+    std::vector<TileKey> keys = MBTilesTests::createDatabase(2);
+
+    MBTiles::Options options;
+    options.url() = URI(MBTilesTests::filename);
+    options.maxReadConnections() = 4u;
+
+    MBTiles::Driver driver;
+    osg::ref_ptr<const Profile> profile;
+    DataExtentList dataExtents;
+    Status status = driver.open("test", options, false, options.format(), profile, dataExtents, nullptr);
+    REQUIRE(status.isOK());
+
+    unsigned count = keys.size() * 4;
+    REQUIRE(MBTilesTests::readConcurrently(driver, keys, 8, count) == count);
+}
+
+TEST_CASE("MBTiles batched writes")
+{
+    MBTilesTests::RemoveDatabase cleanup;
+    std::vector<TileKey> keys = MBTilesTests::createDatabase(2, 5u);
+
+    MBTiles::Options options;
+    options.url() = URI(MBTilesTests::filename);
+
+    MBTiles::Driver driver;
+    osg::ref_ptr<const Profile> profile;
+    DataExtentList dataExtents;
+    Status status = driver.open("test", options, false, options.format(), profile, dataExtents, nullptr);
+    REQUIRE(status.isOK());
+
+    for (auto& key : keys)
+    {
+        ReadResult r = driver.read(key, nullptr, nullptr);
+        REQUIRE(r.succeeded());
+    }
+}
+
+TEST_CASE("MBTiles concurrent read benchmark", "[.benchmark]")
+{
+    MBTilesTests::RemoveDatabase cleanup;
+    std::vector<TileKey> keys = MBTilesTests::createDatabase(4);
+
+    MBTiles::Options options;
+    options.url() = URI(MBTilesTests::filename);
+
+    MBTiles::Driver driver;
+    osg::ref_ptr<const Profile> profile;
+    DataExtentList dataExtents;
+    Status status = driver.open("benchmark", options, false, options.format(), profile, dataExtents, nullptr);
+    REQUIRE(status.isOK());
+
+    const unsigned count = 4096;
+    unsigned maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        auto start = std::chrono::steady_clock::now();
+        unsigned succeeded = MBTilesTests::readConcurrently(driver, keys, numThreads, count);
+        auto end = std::chrono::steady_clock::now();
+        REQUIRE(succeeded == count);
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        OE_NOTICE << "MBTiles read: threads=" << numThreads
+            << ", tiles/sec=" << (unsigned)((double)count / seconds) << std::endl;
+    }
+}
@@ -0,0 +1,231 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/MVT>
+
+#ifdef OSGEARTH_HAVE_MVT
+
+#include <osgEarth/Geometry>
+#include <osgDB/Registry>
+#include <cstdint>
+#include <sstream>
+
+using namespace osgEarth;
+
+namespace MVTTests
+{
+    // Just enough of the protobuf encoding to write a vector tile
+    struct Writer
+    {
+        std::string buf;
+
+        void varint(std::uint64_t v)
+        {
+            for (; v >= 0x80; v >>= 7)
+                buf.push_back((char)((v & 0x7f) | 0x80));
+            buf.push_back((char)v);
+        }
+
+        void key(unsigned field, unsigned type) { varint((field << 3) | type); }
+
+        void number(unsigned field, std::uint64_t v) { key(field, 0); varint(v); }
+
+        void bytes(unsigned field, const std::string& v) { key(field, 2); varint(v.size()); buf += v; }
+
+        void fixed64(unsigned field, double v)
+        {
+            key(field, 1);
+            buf.append((const char*)&v, 8);
+        }
+
+        void packed(unsigned field, const std::vector<std::uint32_t>& values)
+        {
+            Writer w;
+            for (auto v : values)
+                w.varint(v);
+            bytes(field, w.buf);
+        }
+    };
+
+    std::uint32_t zz(int v) { return ((std::uint32_t)v << 1) ^ (std::uint32_t)(v >> 31); }
+
+    std::uint32_t command(unsigned id, unsigned count) { return (count << 3) | id; }
+
+    std::string feature(unsigned type, const std::vector<std::uint32_t>& tags, const std::vector<std::uint32_t>& geometry)
+    {
+        Writer f;
+        f.packed(2, tags);
+        f.number(3, type);
+        f.packed(4, geometry);
+        return f.buf;
+    }
+
+    // Two layers at the default extent of 4096:
+    //   roads:     one line with a name, a lane count and an other_tags height
+    //   buildings: a square polygon and two points, one outside the tile
+    std::string createTile()
+    {
+        Writer roads;
+        roads.number(15, 2);
+        roads.bytes(1, "roads");
+        roads.bytes(2, feature(2, { 0, 0, 1, 1, 2, 2 }, {
+            command(1, 1), zz(0), zz(0),
+            command(2, 1), zz(4096), zz(4096) }));
+        roads.bytes(3, "name");
+        roads.bytes(3, "lanes");
+        roads.bytes(3, "other_tags");
+        Writer v0; v0.bytes(1, "Main St"); roads.bytes(4, v0.buf);
+        Writer v1; v1.number(4, 2); roads.bytes(4, v1.buf);
+        Writer v2; v2.bytes(1, "height=>12"); roads.bytes(4, v2.buf);
+
+        Writer buildings;
+        buildings.number(15, 2);
+        buildings.bytes(1, "buildings");
+        buildings.bytes(3, "height");
+        Writer v3; v3.fixed64(3, 20.0); buildings.bytes(4, v3.buf);
+        buildings.bytes(2, feature(3, { 0, 0 }, {
+            command(1, 1), zz(1024), zz(1024),
+            command(2, 3), zz(2048), zz(0), zz(0), zz(2048), zz(-2048), zz(0),
+            command(7, 1) }));
+        buildings.bytes(2, feature(1, { }, { command(1, 1), zz(2048), zz(2048) }));
+        buildings.bytes(2, feature(1, { }, { command(1, 1), zz(-100), zz(-100) }));
+
+        Writer tile;
+        tile.bytes(3, roads.buf);
+        tile.bytes(3, buildings.buf);
+        return tile.buf;
+    }
+}
+
+TEST_CASE("MVT tiles decode")
+{
+    using namespace MVTTests;
+
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    TileKey key(0, 0, 0, profile.get());
+    std::string tile = createTile();
+
+    SECTION("Features, attributes and geometry")
+    {
+        FeatureList features;
+        REQUIRE(MVT::readTile(tile.data(), tile.size(), key, features));
+
+        // the point outside the tile is dropped
+        REQUIRE(features.size() == 3u);
+
+        Feature* road = features[0].get();
+        REQUIRE(road->getString("mvt_layer") == "roads");
+        REQUIRE(road->getString("name") == "Main St");
+        REQUIRE(road->getInt("lanes") == 2);
+        REQUIRE(road->getDouble("height") == 12.0);
+        LineString* line = dynamic_cast<LineString*>(road->getGeometry());
+        REQUIRE(line);
+        REQUIRE(line->size() == 2u);
+        REQUIRE((*line)[0] == osg::Vec3d(-180.0, 90.0, 0.0));
+        REQUIRE((*line)[1] == osg::Vec3d(0.0, -90.0, 0.0));
+
+        Feature* building = features[1].get();
+        REQUIRE(building->getString("mvt_layer") == "buildings");
+        REQUIRE(building->getDouble("height") == 20.0);
+        Polygon* poly = dynamic_cast<Polygon*>(building->getGeometry());
+        REQUIRE(poly);
+        Bounds b = poly->getBounds();
+        REQUIRE(b.xMin() == -135.0);
+        REQUIRE(b.xMax() == -45.0);
+        REQUIRE(b.yMin() == -45.0);
+        REQUIRE(b.yMax() == 45.0);
+
+        REQUIRE(dynamic_cast<PointSet*>(features[2]->getGeometry()));
+    }
+
+    SECTION("Compressed tiles")
+    {
+        osg::ref_ptr<osgDB::BaseCompressor> compressor =
+            osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+        REQUIRE(compressor.valid());
+
+        std::ostringstream out;
+        REQUIRE(compressor->compress(out, tile));
+        std::string compressed = out.str();
+
+        FeatureList features;
+        REQUIRE(MVT::readTile(compressed.data(), compressed.size(), key, features));
+        REQUIRE(features.size() == 3u);
+
+        std::istringstream in(compressed);
+        REQUIRE(MVT::readTile(in, key, features));
+        REQUIRE(features.size() == 3u);
+    }
+
+    SECTION("Only the requested layers and attributes")
+    {
+        MVT::ReadOptions options;
+        options.layers = { "Buildings" }; // names match case-insensitively
+
+        FeatureList features;
+        REQUIRE(MVT::readTile(tile.data(), tile.size(), key, features, options));
+        REQUIRE(features.size() == 2u);
+        for (auto& f : features)
+            REQUIRE(f->getString("mvt_layer") == "buildings");
+
+        options.layers.clear();
+        options.attributes = { "NAME" };
+        REQUIRE(MVT::readTile(tile.data(), tile.size(), key, features, options));
+        REQUIRE(features.size() == 3u);
+        REQUIRE(features[0]->getString("name") == "Main St");
+        REQUIRE(features[0]->hasAttr("lanes") == false);
+        REQUIRE(features[0]->hasAttr("height") == false);
+        REQUIRE(features[1]->hasAttr("height") == false);
+    }
+
+    SECTION("Cursor decodes the same features")
+    {
+        FeatureList expected;
+        REQUIRE(MVT::readTile(tile.data(), tile.size(), key, expected));
+
+        osg::ref_ptr<FeatureCursor> cursor = MVT::createFeatureCursor(tile.data(), tile.size(), key);
+        REQUIRE(cursor.valid());
+
+        FeatureList features;
+        cursor->fill(features);
+        REQUIRE(features.size() == expected.size());
+        for (unsigned i = 0; i < features.size(); ++i)
+        {
+            REQUIRE(features[i]->getAttrs().size() == expected[i]->getAttrs().size());
+            REQUIRE(features[i]->getGeometry()->asVector() == expected[i]->getGeometry()->asVector());
+        }
+    }
+
+    SECTION("Truncated tiles fail cleanly")
+    {
+        for (std::size_t size = 0; size < tile.size(); size += 3)
+        {
+            FeatureList features;
+            MVT::readTile(tile.data(), size, key, features);
+            REQUIRE(features.size() <= 3u);
+        }
+    }
+}
+
+#endif // OSGEARTH_HAVE_MVT
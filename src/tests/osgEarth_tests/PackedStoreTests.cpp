@@ -0,0 +1,312 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthDrivers/cache_packed/PackedStore>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace osgEarth;
+using namespace osgEarth::PackedFileCache;
+
+namespace PackedStoreTests
+{
+    const std::string path("osgearth_tests_packedstore");
+
+    // Small segments, so a few hundred records span several files
+    const std::uint64_t segmentSize = 16u * 1024u;
+
+    // Deletes the store's files when a test ends. Declare it before the
+    // store so the files are closed first.
+    struct RemoveStore
+    {
+        RemoveStore() { remove(); }
+        ~RemoveStore() { remove(); }
+        void remove()
+        {
+            for (auto& name : osgDB::getDirectoryContents(path))
+                if (name != "." && name != "..")
+                    ::remove(osgDB::concatPaths(path, name).c_str());
+            ::remove(path.c_str());
+        }
+    };
+
+    std::string key(int i)
+    {
+        return "key_" + std::to_string(i);
+    }
+
+    // Value that identifies its key and version, padded to a few hundred bytes
+    std::string value(int i, int version)
+    {
+        return key(i) + "@" + std::to_string(version) + std::string(200 + (i % 50), (char)('a' + i % 26));
+    }
+
+    void open(PackedStore& store)
+    {
+        std::string error;
+        REQUIRE(store.open(path, segmentSize, error));
+        REQUIRE(store.isOpen());
+    }
+}
+
+TEST_CASE("PackedStore")
+{
+    using namespace PackedStoreTests;
+
+    RemoveStore cleanup;
+    PackedStore store;
+    open(store);
+
+    SECTION("Put, get and remove")
+    {
+        PackedStore::Record record;
+        REQUIRE(store.get("missing", record) == false);
+
+        REQUIRE(store.put("a", "data", "meta"));
+        REQUIRE(store.get("a", record));
+        REQUIRE(record.data == "data");
+        REQUIRE(record.meta == "meta");
+        REQUIRE(record.timestamp > 0);
+
+        std::time_t timestamp = 0;
+        REQUIRE(store.contains("a", &timestamp));
+        REQUIRE(timestamp == record.timestamp);
+
+        REQUIRE(store.put("a", "new data", ""));
+        REQUIRE(store.get("a", record));
+        REQUIRE(record.data == "new data");
+        REQUIRE(record.meta.empty());
+        REQUIRE(store.getNumRecords() == 1u);
+        REQUIRE(store.getDeadBytes() > 0u);
+
+        REQUIRE(store.touch("a"));
+        REQUIRE(store.touch("b") == false);
+
+        REQUIRE(store.remove("a"));
+        REQUIRE(store.remove("a") == false);
+        REQUIRE(store.get("a", record) == false);
+        REQUIRE(store.contains("a") == false);
+        REQUIRE(store.getNumRecords() == 0u);
+
+        REQUIRE(store.put("", "empty key", ""));
+        REQUIRE(store.get("", record));
+        REQUIRE(record.data == "empty key");
+    }
+
+    SECTION("Records survive reopening")
+    {
+        for (int i = 0; i < 500; ++i)
+            REQUIRE(store.put(key(i), value(i, 0), key(i)));
+        for (int i = 0; i < 500; i += 3)
+            REQUIRE(store.remove(key(i)));
+        REQUIRE(store.getNumSegments() > 1u);
+
+        std::uint64_t numRecords = store.getNumRecords();
+        std::uint64_t deadBytes = store.getDeadBytes();
+
+        auto check = [&]()
+        {
+            REQUIRE(store.getNumRecords() == numRecords);
+            REQUIRE(store.getDeadBytes() == deadBytes);
+            PackedStore::Record record;
+            for (int i = 0; i < 500; ++i)
+            {
+                bool removed = (i % 3) == 0;
+                REQUIRE(store.get(key(i), record) == !removed);
+                if (!removed)
+                {
+                    REQUIRE(record.data == value(i, 0));
+                    REQUIRE(record.meta == key(i));
+                }
+            }
+        };
+
+        store.close();
+        REQUIRE(store.isOpen() == false);
+        open(store);
+        check();
+
+        // without the index, the store replays the segments
+        store.close();
+        REQUIRE(::remove(osgDB::concatPaths(path, "index.pack").c_str()) == 0);
+        open(store);
+        check();
+    }
+
+    SECTION("Compaction keeps live records and their timestamps")
+    {
+        for (int i = 0; i < 400; ++i)
+            REQUIRE(store.put(key(i), value(i, 0), ""));
+        for (int i = 0; i < 400; i += 2)
+            REQUIRE(store.put(key(i), value(i, 1), ""));
+        for (int i = 0; i < 400; i += 5)
+            REQUIRE(store.remove(key(i)));
+
+        // touch one record once the clock has moved on, so its time
+        // differs from the one it was written with
+        std::time_t written = 0, touched = 0;
+        REQUIRE(store.contains(key(1), &written));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        REQUIRE(store.touch(key(1)));
+        REQUIRE(store.contains(key(1), &touched));
+        REQUIRE(touched > written);
+
+        std::uint64_t totalBytes = store.getTotalBytes();
+        REQUIRE(store.getDeadBytes() > 0u);
+
+        REQUIRE(store.compact() > 0u);
+        REQUIRE(store.getDeadBytes() == 0u);
+        REQUIRE(store.getTotalBytes() < totalBytes);
+        REQUIRE(store.compact() == 0u);
+
+        auto check = [&]()
+        {
+            PackedStore::Record record;
+            for (int i = 0; i < 400; ++i)
+            {
+                bool removed = (i % 5) == 0;
+                REQUIRE(store.get(key(i), record) == !removed);
+                if (!removed)
+                    REQUIRE(record.data == value(i, (i % 2) == 0 ? 1 : 0));
+            }
+            std::time_t timestamp = 0;
+            REQUIRE(store.contains(key(1), &timestamp));
+            REQUIRE(timestamp == touched);
+        };
+
+        check();
+
+        // a rebuilt index gets the timestamps from the compacted records
+        store.close();
+        REQUIRE(::remove(osgDB::concatPaths(path, "index.pack").c_str()) == 0);
+        open(store);
+        check();
+    }
+
+    SECTION("Clear")
+    {
+        for (int i = 0; i < 100; ++i)
+            REQUIRE(store.put(key(i), value(i, 0), ""));
+        REQUIRE(store.clear());
+        REQUIRE(store.getNumRecords() == 0u);
+        REQUIRE(store.getTotalBytes() == 0u);
+        REQUIRE(store.contains(key(0)) == false);
+        REQUIRE(store.put(key(0), value(0, 0), ""));
+        REQUIRE(store.contains(key(0)));
+    }
+}
+
+TEST_CASE("PackedStore concurrent readers")
+{
+    using namespace PackedStoreTests;
+
+    RemoveStore cleanup;
+    PackedStore store;
+    open(store);
+
+    const int count = 300;
+    for (int i = 0; i < count; ++i)
+        REQUIRE(store.put(key(i), value(i, 0), ""));
+
+    SECTION("Reads see whole records while writes and compaction run")
+    {
+        std::atomic_bool done(false);
+        std::atomic_uint reads(0u), errors(0u);
+
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < 6; ++t)
+        {
+            readers.emplace_back([&, t]()
+            {
+                PackedStore::Record record;
+                for (unsigned n = t; !done; n += 7)
+                {
+                    int i = n % count;
+                    if (store.get(key(i), record))
+                    {
+                        // any version is fine, but never another key's record
+                        if (record.data.compare(0, key(i).size() + 1, key(i) + "@") != 0)
+                            ++errors;
+                        ++reads;
+                    }
+                }
+            });
+        }
+
+        for (int version = 1; version < 4; ++version)
+        {
+            for (int i = 0; i < count; ++i)
+                REQUIRE(store.put(key(i), value(i, version), ""));
+            store.compact();
+        }
+
+        done = true;
+        for (auto& reader : readers)
+            reader.join();
+
+        REQUIRE(errors == 0u);
+        REQUIRE(reads > 0u);
+
+        PackedStore::Record record;
+        for (int i = 0; i < count; ++i)
+        {
+            REQUIRE(store.get(key(i), record));
+            REQUIRE(record.data == value(i, 3));
+        }
+    }
+
+    SECTION("Closing while reads are in flight")
+    {
+        std::atomic_bool started(false);
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < 4; ++t)
+        {
+            readers.emplace_back([&]()
+            {
+                PackedStore::Record record;
+                for (int n = 0; n < 20000; ++n)
+                {
+                    store.get(key(n % count), record);
+                    store.contains(key(n % count));
+                    started = true;
+                }
+            });
+        }
+
+        while (!started)
+            std::this_thread::yield();
+        store.close();
+
+        for (auto& reader : readers)
+            reader.join();
+
+        PackedStore::Record record;
+        REQUIRE(store.get(key(0), record) == false);
+        REQUIRE(store.getNumRecords() == 0u);
+    }
+}
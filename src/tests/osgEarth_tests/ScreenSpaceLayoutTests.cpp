@@ -0,0 +1,194 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ScreenSpaceLayoutImpl>
+#include <osgEarth/Notify>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <unordered_set>
+
+using namespace osgEarth;
+using namespace osgEarth::Internal;
+
+namespace ScreenSpaceLayoutTests
+{
+    // The search the declutter pass used before the grid: every box placed so far
+    struct BruteForce
+    {
+        std::vector<ScreenSpaceGrid::Box> _boxes;
+
+        void reset(float, float, float, float) { _boxes.clear(); }
+
+        bool isClear(const osg::Node* parent, const osg::BoundingBox& box) const
+        {
+            for (auto& used : _boxes)
+            {
+                bool isClear =
+                    box.xMin() > used.second.xMax() ||
+                    box.xMax() < used.second.xMin() ||
+                    box.yMin() > used.second.yMax() ||
+                    box.yMax() < used.second.yMin();
+
+                if (!isClear && parent != used.first)
+                    return false;
+            }
+            return true;
+        }
+
+        void insert(const osg::Node* parent, const osg::BoundingBox& box)
+        {
+            _boxes.emplace_back(parent, box);
+        }
+    };
+
+    struct Leaf
+    {
+        const osg::Node* parent;
+        osg::BoundingBox box;
+    };
+
+    float random(float a, float b)
+    {
+        return a + (b - a) * (float)std::rand() / (float)RAND_MAX;
+    }
+
+    // Label-and-icon pairs sharing a parent, scattered over (and a little
+    // beyond) a 1920x1080 window, plus a few degenerate boxes
+    void createLeaves(unsigned count, unsigned seed, std::vector<osg::ref_ptr<osg::Node>>& parents, std::vector<Leaf>& leaves)
+    {
+        std::srand(seed);
+        parents.clear();
+        leaves.clear();
+
+        for (unsigned i = 0; i < count; i += 2)
+        {
+            osg::Node* parent = new osg::Node();
+            parents.emplace_back(parent);
+
+            float x = std::floor(random(-100.0f, 2020.0f));
+            float y = std::floor(random(-100.0f, 1180.0f));
+            float w = std::floor(random(20.0f, 160.0f));
+
+            leaves.push_back({ parent, osg::BoundingBox(x - 13, y - 9, 0, x + 13, y + 9, 0) });
+            leaves.push_back({ parent, osg::BoundingBox(x + 12, y - 9, 0, x + 12 + w, y + 9, 0) });
+        }
+
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        const float inf = std::numeric_limits<float>::infinity();
+        leaves[count / 3].box.set(nan, 10, 0, nan, 20, 0);
+        leaves[count / 2].box.set(500, 500, 0, 400, 600, 0);
+        leaves[count / 4].box.set(-inf, 700, 0, inf, 705, 0);
+        leaves[10].parent = nullptr;
+    }
+
+    // The occupancy part of DeclutterImplementation::sortImplementation
+    template<typename INDEX>
+    void declutter(INDEX& index, const std::vector<Leaf>& leaves, std::vector<char>& visible)
+    {
+        std::unordered_set<const osg::Node*> culledParents;
+        visible.assign(leaves.size(), 0);
+        index.reset(0.0f, 0.0f, 1920.0f, 1080.0f);
+
+        for (unsigned i = 0; i < leaves.size(); ++i)
+        {
+            const Leaf& leaf = leaves[i];
+
+            if (leaf.parent != nullptr && culledParents.count(leaf.parent) > 0)
+                continue;
+
+            if (index.isClear(leaf.parent, leaf.box))
+            {
+                if (leaf.parent)
+                    index.insert(leaf.parent, leaf.box);
+                visible[i] = 1;
+            }
+            else if (leaf.parent)
+            {
+                culledParents.insert(leaf.parent);
+            }
+        }
+    }
+}
+
+TEST_CASE("ScreenSpaceGrid declutters like a brute-force search")
+{
+    using namespace ScreenSpaceLayoutTests;
+
+    std::vector<osg::ref_ptr<osg::Node>> parents;
+    std::vector<Leaf> leaves;
+    ScreenSpaceGrid grid;
+    BruteForce brute;
+
+    for (unsigned count : { 100u, 2000u, 20000u })
+    {
+        createLeaves(count, count, parents, leaves);
+
+        std::vector<char> expected, actual;
+        declutter(brute, leaves, expected);
+        declutter(grid, leaves, actual);
+
+        REQUIRE(actual == expected);
+    }
+
+    SECTION("Touching boxes overlap")
+    {
+        osg::ref_ptr<osg::Node> a = new osg::Node(), b = new osg::Node();
+        grid.reset(0.0f, 0.0f, 1920.0f, 1080.0f);
+        grid.insert(a.get(), osg::BoundingBox(0, 0, 0, 64, 10, 0));
+        REQUIRE(grid.isClear(b.get(), osg::BoundingBox(64, 10, 0, 100, 20, 0)) == false);
+        REQUIRE(grid.isClear(b.get(), osg::BoundingBox(64.5f, 10, 0, 100, 20, 0)) == true);
+        REQUIRE(grid.isClear(a.get(), osg::BoundingBox(0, 0, 0, 10, 10, 0)) == true);
+    }
+}
+
+TEST_CASE("ScreenSpaceGrid declutter benchmark", "[.benchmark]")
+{
+    using namespace ScreenSpaceLayoutTests;
+
+    std::vector<osg::ref_ptr<osg::Node>> parents;
+    std::vector<Leaf> leaves;
+    std::vector<char> visible;
+    ScreenSpaceGrid grid;
+    BruteForce brute;
+    const int frames = 10;
+
+    for (unsigned count : { 1000u, 5000u, 20000u, 50000u })
+    {
+        createLeaves(count, 1, parents, leaves);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i)
+            declutter(brute, leaves, visible);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i)
+            declutter(grid, leaves, visible);
+        auto t2 = std::chrono::steady_clock::now();
+
+        OE_NOTICE << count << " leaves"
+            << ": brute force ms/frame=" << std::chrono::duration<double, std::milli>(t1 - t0).count() / frames
+            << ", grid ms/frame=" << std::chrono::duration<double, std::milli>(t2 - t1).count() / frames
+            << std::endl;
+    }
+}
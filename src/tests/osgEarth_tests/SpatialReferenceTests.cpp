@@ -144,6 +144,110 @@ TEST_CASE("SphMercator/WGS84 transform") {
     REQUIRE(vec_eq(temp2, osg::Vec3d(-180, -85, 0)));
 }
 
+TEST_CASE("Built-in transform kernels") {
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+    const SpatialReference* sm = SpatialReference::get("spherical-mercator");
+    const SpatialReference* utm10n = SpatialReference::get("+proj=utm +zone=10 +datum=WGS84 +units=m +no_defs");
+    const SpatialReference* utm56s = SpatialReference::get("+proj=utm +zone=56 +south +datum=WGS84 +units=m +no_defs");
+    osg::Vec3d out;
+
+    SECTION("Known values") {
+        REQUIRE(wgs84->transform(osg::Vec3d(-180, -85, 0), sm, out));
+        REQUIRE(osg::equivalent(out.x(), -20037508.3428, 1e-3));
+        REQUIRE(osg::equivalent(out.y(), -19971868.8804, 1e-3));
+
+        REQUIRE(wgs84->transform(osg::Vec3d(-122.3321, 47.6062, 0), utm10n, out));
+        REQUIRE(osg::equivalent(out.x(), 550200.213, 1e-2));
+        REQUIRE(osg::equivalent(out.y(), 5272748.592, 1e-2));
+
+        REQUIRE(wgs84->transform(osg::Vec3d(151.2093, -33.8688, 0), utm56s, out));
+        REQUIRE(osg::equivalent(out.x(), 334368.634, 1e-2));
+        REQUIRE(osg::equivalent(out.y(), 6250948.345, 1e-2));
+    }
+
+    SECTION("Agrees with OGR") {
+        // same projection as UTM 10N, spelled so that it goes through OGR
+        const SpatialReference* tmerc = SpatialReference::get(
+            "+proj=tmerc +lat_0=0 +lon_0=-123 +k=0.9996 +x_0=500000 +y_0=0 +datum=WGS84 +units=m +no_defs");
+
+        std::vector<osg::Vec3d> a, b;
+        for (double lat = -80.0; lat <= 84.0; lat += 4.1)
+            for (double lon = -140.0; lon <= -106.0; lon += 1.7)
+                a.push_back(osg::Vec3d(lon, lat, 0));
+        b = a;
+
+        REQUIRE(wgs84->transform(a, utm10n));
+        REQUIRE(wgs84->transform(b, tmerc));
+        for (unsigned i = 0; i < a.size(); ++i)
+            REQUIRE((a[i] - b[i]).length() < 1e-3);
+
+        REQUIRE(utm10n->transform(a, sm));
+        REQUIRE(tmerc->transform(b, sm));
+        for (unsigned i = 0; i < a.size(); ++i)
+            REQUIRE((a[i] - b[i]).length() < 1e-3);
+    }
+
+    SECTION("transformArrays") {
+        // the last point is outside the kernel's range and goes to OGR
+        std::vector<osg::Vec3d> points = {
+            { -122.0, 46.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 179.5, -60.0, 0.0 }, { 190.0, 10.0, 0.0 } };
+        std::vector<double> x, y;
+        for (auto& p : points)
+            x.push_back(p.x()), y.push_back(p.y());
+
+        REQUIRE(wgs84->transform(points, sm));
+        REQUIRE(wgs84->transformArrays(x.data(), y.data(), nullptr, (unsigned)x.size(), sm));
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            REQUIRE(osg::equivalent(x[i], points[i].x(), 1e-6));
+            REQUIRE(osg::equivalent(y[i], points[i].y(), 1e-6));
+        }
+
+        REQUIRE(sm->transformArrays(x.data(), y.data(), nullptr, (unsigned)x.size(), wgs84));
+        REQUIRE(osg::equivalent(x[0], -122.0, 1e-9));
+        REQUIRE(osg::equivalent(y[0], 46.0, 1e-9));
+    }
+
+    SECTION("ECEF agrees with OGR") {
+        const SpatialReference* ecef = wgs84->getGeocentricSRS();
+
+        // spelled so that it goes through OGR, which only gets X and Y;
+        // so the heights are all zero
+        const SpatialReference* geocent = SpatialReference::get("+proj=geocent +datum=WGS84 +units=m +no_defs");
+
+        std::vector<osg::Vec3d> points;
+        std::vector<double> x, y, z;
+        for (double lat = -89.0; lat <= 89.0; lat += 7.3)
+            for (double lon = -179.0; lon <= 179.0; lon += 11.9)
+                points.push_back(osg::Vec3d(lon, lat, 0)), x.push_back(lon), y.push_back(lat), z.push_back(0.0);
+
+        REQUIRE(wgs84->transformArrays(x.data(), y.data(), z.data(), (unsigned)x.size(), ecef));
+        REQUIRE(wgs84->transform(points, geocent));
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            REQUIRE(std::abs(x[i] - points[i].x()) < 1e-3);
+            REQUIRE(std::abs(y[i] - points[i].y()) < 1e-3);
+        }
+
+        // UTM to ECEF and back, with heights, matches the Vec3d path
+        std::vector<osg::Vec3d> utm = { { 550200.0, 5272748.0, 100.0 }, { 400000.0, 4000000.0, -50.0 } };
+        std::vector<osg::Vec3d> expected = utm;
+        REQUIRE(utm10n->transform(expected, ecef));
+
+        x.clear(), y.clear(), z.clear();
+        for (auto& p : utm)
+            x.push_back(p.x()), y.push_back(p.y()), z.push_back(p.z());
+
+        REQUIRE(utm10n->transformArrays(x.data(), y.data(), z.data(), (unsigned)x.size(), ecef));
+        for (unsigned i = 0; i < utm.size(); ++i)
+            REQUIRE((osg::Vec3d(x[i], y[i], z[i]) - expected[i]).length() < 1e-3);
+
+        REQUIRE(ecef->transformArrays(x.data(), y.data(), z.data(), (unsigned)x.size(), utm10n));
+        for (unsigned i = 0; i < utm.size(); ++i)
+            REQUIRE((osg::Vec3d(x[i], y[i], z[i]) - utm[i]).length() < 1e-3);
+    }
+}
+
 TEST_CASE("Vertical Datum Tests") {
     const SpatialReference* wgs84 = SpatialReference::get("wgs84");
     const SpatialReference* wgs84_egm96 = SpatialReference::get("wgs84", "egm96");
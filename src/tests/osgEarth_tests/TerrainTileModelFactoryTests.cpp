@@ -0,0 +1,115 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TerrainTileModelFactory>
+#include <osgEarth/Map>
+#include <osgEarth/GDAL>
+#include <osgEarth/Progress>
+
+using namespace osgEarth;
+
+namespace TerrainTileModelFactoryTests
+{
+    // Elevation plus six image layers; the third one is shared.
+    Map* createMap()
+    {
+        Map* map = new Map();
+
+        GDALElevationLayer* elevation = new GDALElevationLayer();
+        elevation->setURL("../data/terrain/mt_rainier_90m.tif");
+        map->addLayer(elevation);
+
+        for (unsigned i = 0; i < 6; ++i)
+        {
+            GDALImageLayer* layer = new GDALImageLayer();
+            layer->setName("image" + std::to_string(i));
+            layer->setURL("../data/world.tif");
+            layer->setShared(i == 2);
+            map->addLayer(layer);
+        }
+        return map;
+    }
+}
+
+TEST_CASE("TerrainTileModelFactory loads layers concurrently")
+{
+    osg::ref_ptr<Map> map = TerrainTileModelFactoryTests::createMap();
+
+    ImageLayerVector imageLayers;
+    map->getLayers(imageLayers);
+    REQUIRE(imageLayers.size() == 6u);
+
+    osg::ref_ptr<TerrainTileModelFactory> factory = new TerrainTileModelFactory(TerrainOptions());
+    TerrainEngineRequirements require;
+    require.elevationTextures = true;
+    TileKey key(1, 0, 0, map->getProfile());
+
+    SECTION("Color layers keep the map order")
+    {
+        for (int run = 0; run < 5; ++run)
+        {
+            osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(
+                map.get(), key, CreateTileManifest(), require, nullptr);
+
+            REQUIRE(model.valid());
+            REQUIRE(model->colorLayers.size() == imageLayers.size());
+            for (unsigned i = 0; i < imageLayers.size(); ++i)
+            {
+                REQUIRE(model->colorLayers[i].layer.get() == imageLayers[i].get());
+                REQUIRE(model->colorLayers[i].texture != nullptr);
+            }
+            REQUIRE(model->sharedLayerIndices == std::vector<unsigned>{ 2u });
+            REQUIRE(model->elevation.texture != nullptr);
+        }
+    }
+
+    SECTION("Only the layers in the manifest")
+    {
+        CreateTileManifest manifest;
+        manifest.insert(imageLayers[4].get());
+        manifest.insert(imageLayers[1].get());
+
+        osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(
+            map.get(), key, manifest, require, nullptr);
+
+        REQUIRE(model->colorLayers.size() == 2u);
+        REQUIRE(model->colorLayers[0].layer.get() == imageLayers[1].get());
+        REQUIRE(model->colorLayers[1].layer.get() == imageLayers[4].get());
+        REQUIRE(model->sharedLayerIndices.empty());
+        REQUIRE(model->elevation.texture == nullptr);
+    }
+
+    SECTION("Canceled tiles load nothing")
+    {
+        osg::ref_ptr<ProgressCallback> progress = new ProgressCallback();
+        progress->cancel();
+
+        osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(
+            map.get(), key, CreateTileManifest(), require, progress.get());
+
+        REQUIRE(model.valid());
+        REQUIRE(model->colorLayers.empty());
+        REQUIRE(model->elevation.texture == nullptr);
+    }
+}